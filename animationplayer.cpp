@@ -0,0 +1,157 @@
+#include "animationplayer.h"
+#include "tracer.h"
+#include <QImageReader>
+#include <QMetaObject>
+#include <QMutexLocker>
+
+namespace {
+
+const qint64 ringBudget = 32LL * 1024 * 1024;
+const int minFrames = 2;
+const int maxFrames = 16;
+
+// Browsers show frames with no or a tiny delay for 100 ms, and GIFs are made for that
+int frameDelay(int delay)
+{
+    return delay < 20 ? 100 : delay;
+}
+
+} // namespace
+
+AnimationPlayer::AnimationPlayer(QObject *parent)
+    : QObject(parent)
+{
+    frameTimer.setSingleShot(true);
+    connect(&frameTimer, &QTimer::timeout, this, &AnimationPlayer::showNextFrame);
+}
+
+AnimationPlayer::~AnimationPlayer()
+{
+    QThread *thread = decoder;
+    stop();
+    // It only ever has one frame left to finish
+    if (thread) {
+        thread->wait();
+    }
+}
+
+bool AnimationPlayer::canAnimate(const QString &path)
+{
+    QImageReader reader(path);
+    return reader.supportsAnimation();
+}
+
+void AnimationPlayer::play(const QString &path, const QSize &boundingSize)
+{
+    stop();
+
+    ring = std::make_shared<Ring>();
+    // The first frame goes out as soon as it is decoded
+    ring->starving = true;
+    const std::shared_ptr<Ring> shared = ring;
+    QObject *player = this;
+    decoder = QThread::create([shared, player, path, boundingSize]() {
+        decode(shared, player, path, boundingSize);
+    });
+    connect(decoder, &QThread::finished, decoder, &QObject::deleteLater);
+    decoder->start(QThread::LowPriority);
+}
+
+void AnimationPlayer::stop()
+{
+    frameTimer.stop();
+    if (!ring) return;
+
+    {
+        QMutexLocker locker(&ring->mutex);
+        ring->stopped = true;
+        ring->notFull.wakeAll();
+    }
+    ring.reset();
+    decoder = nullptr;
+}
+
+void AnimationPlayer::decode(const std::shared_ptr<Ring> &ring, QObject *player, const QString &path,
+                             const QSize &boundingSize)
+{
+    int passes = 0;
+    int loops = 0;
+    for (;;) {
+        // Readers cannot rewind, so every pass through the animation opens a new one
+        QImageReader reader(path);
+        reader.setAutoTransform(true);
+        const QSize size = reader.size();
+        if (size.isValid() && boundingSize.isValid()
+            && (size.width() > boundingSize.width() || size.height() > boundingSize.height())) {
+            reader.setScaledSize(size.scaled(boundingSize, Qt::KeepAspectRatio));
+        }
+
+        int frames = 0;
+        for (;;) {
+            Frame frame;
+            const qint64 start = Tracer::now();
+            {
+                TraceSpan span("decode", "animation");
+                frame.image = reader.read();
+            }
+            if (frame.image.isNull()) break;
+            frame.delay = frameDelay(reader.nextImageDelay());
+            Tracer::count(TraceCounter::ImagesDecoded);
+            Tracer::count(TraceCounter::DecodeNanoseconds, Tracer::now() - start);
+            ++frames;
+
+            QMutexLocker locker(&ring->mutex);
+            if (ring->frames.isEmpty()) {
+                const qint64 frameBytes = qMax<qint64>(frame.image.sizeInBytes(), 1);
+                ring->frames.resize(int(qBound<qint64>(minFrames, ringBudget / frameBytes, maxFrames)));
+            }
+            while (ring->count == ring->frames.size() && !ring->stopped) {
+                ring->notFull.wait(&ring->mutex);
+            }
+            if (ring->stopped) return;
+
+            ring->frames[(ring->head + ring->count) % ring->frames.size()] = std::move(frame);
+            ++ring->count;
+            if (ring->starving) {
+                ring->starving = false;
+                // Still under the lock, so stop() has not returned and player is alive
+                Ring *posted = ring.get();
+                QMetaObject::invokeMethod(player, [player, posted]() {
+                    AnimationPlayer *self = static_cast<AnimationPlayer *>(player);
+                    if (self->ring.get() == posted) self->showNextFrame();
+                }, Qt::QueuedConnection);
+            }
+            if (!reader.canRead()) break;
+        }
+
+        // A still image, or an animation that has played as often as it asks
+        if (frames <= 1 && passes == 0) return;
+        if (passes == 0) {
+            loops = reader.loopCount();
+        }
+        ++passes;
+        if (frames == 0 || (loops >= 0 && passes > loops)) return;
+    }
+}
+
+void AnimationPlayer::showNextFrame()
+{
+    if (!ring) return;
+
+    Frame frame;
+    {
+        QMutexLocker locker(&ring->mutex);
+        if (ring->count == 0) {
+            // The decoder is behind; it calls again when the next frame is in
+            ring->starving = true;
+            return;
+        }
+        frame = std::move(ring->frames[ring->head]);
+        ring->frames[ring->head] = Frame();
+        ring->head = (ring->head + 1) % ring->frames.size();
+        --ring->count;
+        ring->notFull.wakeOne();
+    }
+    emit frameReady(frame.image);
+    frameTimer.start(frame.delay);
+}
@@ -0,0 +1,68 @@
+#ifndef ANIMATIONPLAYER_H
+#define ANIMATIONPLAYER_H
+
+#include <QObject>
+#include <QImage>
+#include <QMutex>
+#include <QPointer>
+#include <QSize>
+#include <QString>
+#include <QThread>
+#include <QTimer>
+#include <QVector>
+#include <QWaitCondition>
+#include <memory>
+
+// Plays animated GIF and WebP without holding the whole animation. A decoder
+// thread reads frames in order, already fitted to the display, into a small
+// ring buffer and waits while it is full; the GUI thread takes one frame per
+// frame delay. The ring holds as many frames as fit in 32 MB (at least 2,
+// at most 16), so a 200 MB GIF costs a few frames of memory, and a
+// slow decoder delays the next frame instead of blocking the GUI.
+class AnimationPlayer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit AnimationPlayer(QObject *parent = nullptr);
+    ~AnimationPlayer();
+
+    // Whether the format of path can hold more than one frame; reads the header only
+    static bool canAnimate(const QString &path);
+
+    // Plays path fitted into boundingSize; a still image stops after its one frame
+    void play(const QString &path, const QSize &boundingSize);
+    void stop();
+
+signals:
+    void frameReady(const QImage &frame);
+
+private:
+    struct Frame
+    {
+        QImage image;
+        int delay = 0; // ms to show it for
+    };
+
+    // Shared with the decoder thread, which may outlive the player by one frame
+    struct Ring
+    {
+        QMutex mutex;
+        QWaitCondition notFull;
+        QVector<Frame> frames; // capacity slots, set once the first frame's size is known
+        int head = 0;
+        int count = 0;
+        bool starving = false; // the GUI found it empty and waits to be told
+        bool stopped = false;
+    };
+
+    static void decode(const std::shared_ptr<Ring> &ring, QObject *player, const QString &path,
+                       const QSize &boundingSize);
+    void showNextFrame();
+
+    std::shared_ptr<Ring> ring;
+    QPointer<QThread> decoder;
+    QTimer frameTimer;
+};
+
+#endif // ANIMATIONPLAYER_H
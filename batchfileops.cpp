@@ -0,0 +1,314 @@
+#include "batchfileops.h"
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#ifdef Q_OS_UNIX
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#ifdef Q_OS_LINUX
+#include <sys/syscall.h>
+#endif
+#ifdef SMARTRABBIT_HAVE_IO_URING
+#include <liburing.h>
+#endif
+
+#ifndef RENAME_NOREPLACE
+#define RENAME_NOREPLACE (1 << 0)
+#endif
+
+namespace {
+
+// Batches this small run inline rather than starting threads
+const int inlineBatchSize = 16;
+// Metadata operations mostly wait on the disk, so more threads than cores pay off
+const int maxPoolThreads = 16;
+// Marks an operation that has not completed yet
+const int pendingError = -1;
+
+bool entryExists(const QByteArray &path)
+{
+#ifdef Q_OS_UNIX
+    struct stat st;
+    return ::lstat(path.constData(), &st) == 0;
+#else
+    QFileInfo info(QFile::decodeName(path));
+    return info.exists() || info.isSymLink();
+#endif
+}
+
+// For file systems without RENAME_NOREPLACE; the check and the rename are not atomic
+int renameChecked(const FileOp &op)
+{
+    if (entryExists(op.target)) {
+        return EEXIST;
+    }
+#ifdef Q_OS_UNIX
+    return ::rename(op.path.constData(), op.target.constData()) == 0 ? 0 : errno;
+#else
+    if (!entryExists(op.path)) return ENOENT;
+    return QDir().rename(QFile::decodeName(op.path), QFile::decodeName(op.target)) ? 0 : EIO;
+#endif
+}
+
+void runOne(FileOp &op)
+{
+#ifdef Q_OS_UNIX
+    switch (op.type) {
+    case FileOp::Unlink:
+        op.error = ::unlink(op.path.constData()) == 0 ? 0 : errno;
+        break;
+    case FileOp::Rename:
+#if defined(Q_OS_LINUX) && defined(SYS_renameat2)
+        if (::syscall(SYS_renameat2, AT_FDCWD, op.path.constData(), AT_FDCWD, op.target.constData(), RENAME_NOREPLACE) == 0) {
+            op.error = 0;
+        } else {
+            op.error = errno;
+            if (op.error == EINVAL || op.error == ENOSYS) {
+                op.error = renameChecked(op);
+            }
+        }
+#else
+        op.error = renameChecked(op);
+#endif
+        break;
+    case FileOp::Stat: {
+        struct stat st;
+        if (::stat(op.path.constData(), &st) != 0) {
+            op.error = errno;
+            break;
+        }
+        op.error = 0;
+        op.isFile = S_ISREG(st.st_mode);
+        op.size = st.st_size;
+#ifdef Q_OS_LINUX
+        op.mtime = qint64(st.st_mtim.tv_sec) * 1000000000LL + st.st_mtim.tv_nsec;
+#else
+        op.mtime = qint64(st.st_mtime) * 1000000000LL;
+#endif
+        break;
+    }
+    }
+#else
+    const QString path = QFile::decodeName(op.path);
+    bool ok = false;
+    switch (op.type) {
+    case FileOp::Unlink:
+        ok = QFile::remove(path);
+        break;
+    case FileOp::Rename:
+        op.error = renameChecked(op);
+        return;
+    case FileOp::Stat: {
+        QFileInfo info(path);
+        ok = info.exists();
+        op.isFile = info.isFile();
+        op.size = info.size();
+        op.mtime = info.lastModified().toMSecsSinceEpoch() * 1000000LL;
+        break;
+    }
+    }
+    op.error = ok ? 0 : (!entryExists(op.path) ? ENOENT : EIO);
+#endif
+}
+
+void runPool(const std::vector<FileOp *> &ops)
+{
+    const int count = int(ops.size());
+    if (count <= inlineBatchSize) {
+        for (FileOp *op : ops) {
+            runOne(*op);
+        }
+        return;
+    }
+
+    std::atomic<int> next{0};
+    auto work = [&]() {
+        for (int i; (i = next.fetch_add(1)) < count;) {
+            runOne(*ops[i]);
+        }
+    };
+    const int threadCount = qMin(maxPoolThreads, count / inlineBatchSize);
+    std::vector<std::thread> threads;
+    for (int t = 1; t < threadCount; ++t) {
+        threads.emplace_back(work);
+    }
+    work();
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+}
+
+#ifdef SMARTRABBIT_HAVE_IO_URING
+// Operations kept in flight; enough to keep a disk queue and the io-wq workers busy
+const unsigned ringDepth = 256;
+
+bool probeIoUring()
+{
+    // Also fails where io_uring is disabled or blocked by a seccomp filter
+    struct io_uring_probe *probe = io_uring_get_probe();
+    if (!probe) {
+        return false;
+    }
+    bool supported = io_uring_opcode_supported(probe, IORING_OP_UNLINKAT)
+                     && io_uring_opcode_supported(probe, IORING_OP_RENAMEAT)
+                     && io_uring_opcode_supported(probe, IORING_OP_STATX);
+    io_uring_free_probe(probe);
+    return supported;
+}
+
+int reap(struct io_uring *ring, FileOp *ops)
+{
+    struct io_uring_cqe *cqe;
+    unsigned head;
+    int seen = 0;
+    io_uring_for_each_cqe(ring, head, cqe) {
+        ops[uintptr_t(io_uring_cqe_get_data(cqe))].error = cqe->res < 0 ? -cqe->res : 0;
+        ++seen;
+    }
+    io_uring_cq_advance(ring, seen);
+    return seen;
+}
+
+// Returns false if no ring could be set up; operations the ring could not
+// finish are left with pendingError
+bool runRing(QVector<FileOp> &ops)
+{
+    struct io_uring ring;
+    if (io_uring_queue_init(ringDepth, &ring, 0) < 0) {
+        return false;
+    }
+
+    FileOp *data = ops.data();
+    const int count = int(ops.size());
+    std::vector<struct statx> stats(count);
+    for (int i = 0; i < count; ++i) {
+        data[i].error = pendingError;
+    }
+
+    int prepared = 0;
+    int accepted = 0;
+    int completed = 0;
+    while (completed < count) {
+        for (; prepared < count; ++prepared) {
+            struct io_uring_sqe *sqe = io_uring_get_sqe(&ring);
+            if (!sqe) break;
+            const FileOp &op = data[prepared];
+            switch (op.type) {
+            case FileOp::Unlink:
+                io_uring_prep_unlinkat(sqe, AT_FDCWD, op.path.constData(), 0);
+                break;
+            case FileOp::Rename:
+                io_uring_prep_renameat(sqe, AT_FDCWD, op.path.constData(), AT_FDCWD, op.target.constData(), RENAME_NOREPLACE);
+                break;
+            case FileOp::Stat:
+                io_uring_prep_statx(sqe, AT_FDCWD, op.path.constData(), 0,
+                                    STATX_TYPE | STATX_SIZE | STATX_MTIME, &stats[prepared]);
+                break;
+            }
+            io_uring_sqe_set_data(sqe, reinterpret_cast<void *>(uintptr_t(prepared)));
+        }
+
+        int submitted = io_uring_submit_and_wait(&ring, 1);
+        if (submitted >= 0) {
+            accepted += submitted;
+        } else if (submitted != -EINTR && submitted != -EAGAIN && submitted != -EBUSY) {
+            // Ops never taken by the kernel are retried by the caller
+            break;
+        }
+        completed += reap(&ring, data);
+    }
+
+    // The kernel may still write to the stat buffers until everything it took is done
+    while (completed < accepted) {
+        struct io_uring_cqe *cqe;
+        if (io_uring_wait_cqe(&ring, &cqe) < 0) break;
+        completed += reap(&ring, data);
+    }
+    io_uring_queue_exit(&ring);
+
+    for (int i = 0; i < count; ++i) {
+        FileOp &op = data[i];
+        if (op.type == FileOp::Stat && op.error == 0) {
+            const struct statx &st = stats[i];
+            op.isFile = S_ISREG(st.stx_mode);
+            op.size = qint64(st.stx_size);
+            op.mtime = qint64(st.stx_mtime.tv_sec) * 1000000000LL + st.stx_mtime.tv_nsec;
+        }
+    }
+    return true;
+}
+#endif
+
+} // namespace
+
+FileOp BatchFileOps::unlink(const QString &path)
+{
+    FileOp op;
+    op.type = FileOp::Unlink;
+    op.path = QFile::encodeName(path);
+    return op;
+}
+
+FileOp BatchFileOps::rename(const QString &path, const QString &target)
+{
+    FileOp op;
+    op.type = FileOp::Rename;
+    op.path = QFile::encodeName(path);
+    op.target = QFile::encodeName(target);
+    return op;
+}
+
+FileOp BatchFileOps::stat(const QString &path)
+{
+    FileOp op;
+    op.type = FileOp::Stat;
+    op.path = QFile::encodeName(path);
+    return op;
+}
+
+void BatchFileOps::run(QVector<FileOp> &ops)
+{
+    if (ops.isEmpty()) return;
+
+    std::vector<FileOp *> rest;
+#ifdef SMARTRABBIT_HAVE_IO_URING
+    if (ops.size() > inlineBatchSize && hasIoUring() && runRing(ops)) {
+        // Renames on file systems without RENAME_NOREPLACE fail with EINVAL
+        for (FileOp &op : ops) {
+            if (op.error == pendingError || (op.type == FileOp::Rename && op.error == EINVAL)) {
+                rest.push_back(&op);
+            }
+        }
+        runPool(rest);
+        return;
+    }
+#endif
+    for (FileOp &op : ops) {
+        rest.push_back(&op);
+    }
+    runPool(rest);
+}
+
+bool BatchFileOps::hasIoUring()
+{
+#ifdef SMARTRABBIT_HAVE_IO_URING
+    static const bool available = probeIoUring();
+    return available;
+#else
+    return false;
+#endif
+}
+
+QString BatchFileOps::errorString(int error)
+{
+    return QString::fromLocal8Bit(std::strerror(error));
+}
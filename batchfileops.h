@@ -0,0 +1,47 @@
+#ifndef BATCHFILEOPS_H
+#define BATCHFILEOPS_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+// One operation of a batch. Paths are in the local 8-bit encoding
+// (QFile::encodeName); error is the errno it failed with, or 0.
+struct FileOp
+{
+    enum Type { Unlink, Rename, Stat };
+
+    Type type = Unlink;
+    QByteArray path;
+    QByteArray target; // new path of a Rename, which never replaces an existing entry
+    int error = 0;
+
+    // Filled in by Stat, which follows symlinks as the scan does
+    bool isFile = false; // a regular file
+    qint64 size = 0;
+    qint64 mtime = 0; // nanoseconds since the epoch
+};
+
+// Runs many independent file system operations at once. On Linux the batch
+// is submitted through io_uring when the kernel supports the opcodes, keeping
+// a few hundred operations in flight from a single thread; elsewhere, or when
+// io_uring is unavailable or disallowed, a pool of threads issues the
+// syscalls in parallel.
+class BatchFileOps
+{
+public:
+    static FileOp unlink(const QString &path);
+    static FileOp rename(const QString &path, const QString &target);
+    static FileOp stat(const QString &path);
+
+    // Blocks until every operation is done. The operations must not depend on
+    // each other, as they may complete in any order.
+    static void run(QVector<FileOp> &ops);
+
+    // True when batches go through io_uring rather than the thread pool
+    static bool hasIoUring();
+
+    static QString errorString(int error);
+};
+
+#endif // BATCHFILEOPS_H
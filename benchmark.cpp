@@ -0,0 +1,293 @@
+#include "batchfileops.h"
+#include "catalog.h"
+#include "configmanager.h"
+#include "fileoperations.h"
+#include "fixturegenerator.h"
+#include "imageloader.h"
+#include "mediametadata.h"
+#include "mediatype.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QImageReader>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTemporaryDir>
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+
+// Measures the scanning, listing, decoding and deleting paths on a generated
+// media tree and writes the results as one JSON document, for comparing
+// builds and releases. Progress goes to stderr.
+
+namespace {
+
+struct Result
+{
+    QString name;
+    qint64 items = 0;
+    QVector<double> runsMs;
+
+    QJsonObject toJson() const
+    {
+        QVector<double> sorted = runsMs;
+        std::sort(sorted.begin(), sorted.end());
+        double total = 0;
+        for (double ms : sorted) {
+            total += ms;
+        }
+        const double median = sorted.isEmpty() ? 0 : sorted[sorted.size() / 2];
+        QJsonArray runs;
+        for (double ms : runsMs) {
+            runs.append(ms);
+        }
+        return QJsonObject{{"name", name}, {"items", items}, {"runs_ms", runs},
+                           {"min_ms", sorted.isEmpty() ? 0 : sorted.first()},
+                           {"median_ms", median},
+                           {"mean_ms", sorted.isEmpty() ? 0 : total / sorted.size()},
+                           {"items_per_s", median > 0 ? items * 1000.0 / median : 0}};
+    }
+};
+
+void progress(const QString &text)
+{
+    std::fprintf(stderr, "%s\n", qPrintable(text));
+}
+
+// Runs work once untimed to warm the page cache, then times each run; work
+// returns the number of items it handled
+Result measure(const QString &name, int runs, const std::function<qint64()> &work,
+               const std::function<void()> &setup = std::function<void()>())
+{
+    progress(QString("Running %1...").arg(name));
+    Result result;
+    result.name = name;
+    if (setup) setup();
+    work();
+    for (int run = 0; run < runs; ++run) {
+        if (setup) setup();
+        QElapsedTimer timer;
+        timer.start();
+        result.items = work();
+        result.runsMs.append(timer.nsecsElapsed() / 1e6);
+    }
+    return result;
+}
+
+// A flat folder of small files for the delete benchmarks to consume
+QStringList makeVictims(const QString &folder, int count)
+{
+    QDir().mkpath(folder);
+    QStringList paths;
+    for (int i = 0; i < count; ++i) {
+        QFile file(QString("%1/victim_%2.jpg").arg(folder).arg(i));
+        if (file.open(QIODevice::WriteOnly)) {
+            file.write("x");
+            paths.append(file.fileName());
+        }
+    }
+    return paths;
+}
+
+QSize parseSize(const QString &text)
+{
+    const QStringList parts = text.split('x');
+    return parts.size() == 2 ? QSize(parts[0].toInt(), parts[1].toInt()) : QSize();
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("smartrabbit-bench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Benchmarks SmartRabbit on a generated media tree and prints JSON results.");
+    parser.addHelpOption();
+    QCommandLineOption rootOption("root", "Fixture folder, reused when it holds the same spec (default: temporary)", "dir");
+    QCommandLineOption depthOption("depth", "Folder levels below the root", "n", "3");
+    QCommandLineOption fanoutOption("fanout", "Subfolders per folder", "n", "4");
+    QCommandLineOption filesOption("files", "Media files per folder", "n", "20");
+    QCommandLineOption seedOption("seed", "Fixture seed", "n", "1");
+    QCommandLineOption runsOption("runs", "Timed runs per benchmark", "n", "5");
+    QCommandLineOption decodeOption("decode-count", "Images decoded per decode run", "n", "100");
+    QCommandLineOption displayOption("display-size", "Size images are decoded for", "WxH", "1920x1080");
+    QCommandLineOption deleteOption("delete-count", "Files deleted per delete run", "n", "5000");
+    QCommandLineOption outputOption({"o", "output"}, "Write the JSON here instead of stdout", "file");
+    parser.addOptions({rootOption, depthOption, fanoutOption, filesOption, seedOption, runsOption,
+                       decodeOption, displayOption, deleteOption, outputOption});
+    parser.process(app);
+
+    FixtureSpec spec;
+    spec.depth = parser.value(depthOption).toInt();
+    spec.fanout = parser.value(fanoutOption).toInt();
+    spec.filesPerFolder = parser.value(filesOption).toInt();
+    spec.seed = parser.value(seedOption).toULongLong();
+    const int runs = qMax(1, parser.value(runsOption).toInt());
+    const int decodeCount = parser.value(decodeOption).toInt();
+    const QSize displaySize = parseSize(parser.value(displayOption));
+    const int deleteCount = parser.value(deleteOption).toInt();
+
+    QTemporaryDir scratch;
+    if (!scratch.isValid()) {
+        progress("Could not create a temporary folder");
+        return 1;
+    }
+    const QString root = parser.isSet(rootOption) ? QDir(parser.value(rootOption)).absolutePath()
+                                                  : scratch.filePath("fixture");
+
+    progress(QString("Generating fixture in %1...").arg(root));
+    FixtureGenerator generator(spec);
+    QElapsedTimer generateTimer;
+    generateTimer.start();
+    QString error;
+    if (!generator.generate(root, &error)) {
+        progress(error);
+        return 1;
+    }
+    const qint64 generateMs = generateTimer.elapsed();
+
+    const QStringList extensions = ConfigManager().getSupportedExtensions();
+    QVector<Result> results;
+
+    // Folder walk alone, then with the catalog doing the incremental work
+    QStringList folders;
+    results.append(measure("scan_folders", runs, [&]() {
+        folders = FileOperations().scanFolders(root, true);
+        return qint64(folders.size());
+    }));
+
+    Catalog catalog(scratch.filePath("bench.catalog"));
+    FileOperations catalogOperations;
+    catalogOperations.setCatalog(&catalog, extensions);
+    results.append(measure("scan_folders_catalog", runs, [&]() {
+        return qint64(catalogOperations.scanFolders(root, true).size());
+    }));
+
+    QStringList mediaPaths;
+    results.append(measure("get_media_files", runs, [&]() {
+        FileOperations fileOperations;
+        mediaPaths.clear();
+        for (const QString &folder : std::as_const(folders)) {
+            const QStringList files = fileOperations.getMediaFiles(folder, extensions);
+            for (const QString &file : files) {
+                mediaPaths.append(folder + "/" + file);
+            }
+        }
+        return qint64(mediaPaths.size());
+    }));
+    results.append(measure("get_media_files_catalog", runs, [&]() {
+        qint64 count = 0;
+        for (const QString &folder : std::as_const(folders)) {
+            count += catalogOperations.getMediaFiles(folder, extensions).size();
+        }
+        return count;
+    }));
+
+    // Extension table lookups, against reading the first bytes of each file
+    const MediaClassifier classifier(extensions);
+    results.append(measure("classify_names", runs, [&]() {
+        qint64 count = 0;
+        for (const QString &path : std::as_const(mediaPaths)) {
+            count += classifier.classify(path) != MediaType::Unknown ? 1 : 0;
+        }
+        return count;
+    }));
+    results.append(measure("sniff_content", runs, [&]() {
+        qint64 count = 0;
+        for (const QString &path : std::as_const(mediaPaths)) {
+            count += MediaClassifier::sniffFile(path) != MediaType::Unknown ? 1 : 0;
+        }
+        return count;
+    }));
+
+    // Reduced decode as the viewer does it, against a full decode then scale
+    const QStringList decodePaths = mediaPaths.mid(0, decodeCount);
+    results.append(measure("decode_scale", runs, [&]() {
+        qint64 count = 0;
+        for (const QString &path : decodePaths) {
+            count += ImageLoader::load(path, displaySize).isNull() ? 0 : 1;
+        }
+        return count;
+    }));
+    results.append(measure("decode_full_then_scale", runs, [&]() {
+        qint64 count = 0;
+        for (const QString &path : decodePaths) {
+            QImageReader reader(path);
+            reader.setAutoTransform(true);
+            const QImage image = reader.read().scaled(displaySize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+            count += image.isNull() ? 0 : 1;
+        }
+        return count;
+    }));
+    // What the viewer shows while decode_scale runs; counts files that have an embedded preview
+    results.append(measure("embedded_preview", runs, [&]() {
+        qint64 count = 0;
+        for (const QString &path : decodePaths) {
+            count += ImageLoader::loadPreview(path).isNull() ? 0 : 1;
+        }
+        return count;
+    }));
+
+    // Header-only metadata of every media file
+    results.append(measure("read_metadata", runs, [&]() {
+        qint64 count = 0;
+        for (const QString &path : std::as_const(mediaPaths)) {
+            MediaMetadata metadata;
+            count += MetadataReader::read(path, metadata) ? 1 : 0;
+        }
+        return count;
+    }));
+
+    // Deletes consume their files, so every run gets a fresh set
+    const QString victims = scratch.filePath("victims");
+    QStringList victimPaths;
+    auto makeDeleteSet = [&]() { victimPaths = makeVictims(victims, deleteCount); };
+    results.append(measure("delete_batch", runs, [&]() {
+        return qint64(victimPaths.size() - FileOperations().deletePaths(victimPaths).size());
+    }, makeDeleteSet));
+    results.append(measure("delete_sequential", runs, [&]() {
+        FileOperations fileOperations;
+        qint64 count = 0;
+        for (const QString &path : std::as_const(victimPaths)) {
+            count += fileOperations.deleteFile(path) ? 1 : 0;
+        }
+        return count;
+    }, makeDeleteSet));
+
+    QJsonArray resultArray;
+    for (const Result &result : std::as_const(results)) {
+        resultArray.append(result.toJson());
+    }
+    QJsonObject fixture = spec.toJson();
+    fixture.insert("folders", generator.folderCount());
+    fixture.insert("files", generator.fileCount());
+    fixture.insert("bytes", generator.byteCount());
+    fixture.insert("written_formats", QJsonArray::fromStringList(generator.writtenFormats()));
+    fixture.insert("generate_ms", generateMs);
+    const QJsonObject report{{"timestamp", QDateTime::currentDateTimeUtc().toString(Qt::ISODate)},
+                             {"qt_version", qVersion()},
+                             {"io_uring", BatchFileOps::hasIoUring()},
+                             {"runs", runs},
+                             {"display_size", parser.value(displayOption)},
+                             {"fixture", fixture},
+                             {"results", resultArray}};
+    const QByteArray json = QJsonDocument(report).toJson();
+
+    if (parser.isSet(outputOption)) {
+        QFile output(parser.value(outputOption));
+        if (!output.open(QIODevice::WriteOnly) || output.write(json) != json.size()) {
+            progress(QString("Could not write %1").arg(output.fileName()));
+            return 1;
+        }
+    } else {
+        std::fwrite(json.constData(), 1, size_t(json.size()), stdout);
+    }
+    return 0;
+}
@@ -0,0 +1,610 @@
+#include "catalog.h"
+#include <QFileInfo>
+#include <QDateTime>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QReadLocker>
+#include <QWriteLocker>
+#include <algorithm>
+#include <cstring>
+#include <memory>
+
+#ifdef Q_OS_LINUX
+#include <sys/stat.h>
+#endif
+
+namespace {
+
+const char catalogMagic[8] = {'S', 'R', 'C', 'A', 'T', 'L', 'G', '\0'};
+const quint32 catalogVersion = 3;
+const quint32 recursiveFlag = 0x1;
+
+// All offsets are from the start of the file; values are native-endian since
+// the catalog never leaves the machine that wrote it
+struct CatalogHeader
+{
+    char magic[8];
+    quint32 version;
+    quint32 flags;
+    quint64 extensionsHash;
+    quint64 folderCount;
+    quint64 rootOffset;   // quint32 length + UTF-8 bytes
+    quint64 orderOffset;  // folderCount x quint64 record offsets, in scan order
+    quint64 sortedOffset; // folderCount x quint64 record offsets, sorted by path
+};
+
+// Followed by the UTF-8 path, then per subfolder a quint16 length + UTF-8 name,
+// then per media file a MediaRecord + UTF-8 name, and with metadataFlag a
+// MetadataRecord + UTF-8 camera + UTF-8 codec
+struct FolderRecord
+{
+    quint64 inode;
+    qint64 mtime;
+    quint32 pathLength;
+    quint32 subfolderCount;
+    quint32 mediaCount;
+    quint32 reserved;
+};
+
+const quint16 perceptualHashFlag = 0x1;
+const quint16 metadataFlag = 0x2;
+const quint16 typeMask = 0xc; // MediaType; Unknown in catalogs written before types were kept
+const int typeShift = 2;
+
+struct MediaRecord
+{
+    qint64 size;
+    qint64 mtime;
+    quint64 perceptualHash;
+    quint16 nameLength;
+    quint16 flags;
+};
+
+struct MetadataRecord
+{
+    qint64 captureTime;
+    qint64 duration;
+    quint32 width;
+    quint32 height;
+    quint16 orientation;
+    quint8 cameraLength;
+    quint8 codecLength;
+    quint32 reserved;
+};
+
+template <typename T>
+void appendValue(QByteArray &out, const T &value)
+{
+    out.append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+template <typename T>
+bool readValue(const uchar *data, qint64 size, quint64 &pos, T &value)
+{
+    if (pos + sizeof(T) > quint64(size)) return false;
+    std::memcpy(&value, data + pos, sizeof(T));
+    pos += sizeof(T);
+    return true;
+}
+
+bool readString(const uchar *data, qint64 size, quint64 &pos, quint32 length, QString &value)
+{
+    if (pos + length > quint64(size)) return false;
+    value = QString::fromUtf8(reinterpret_cast<const char *>(data + pos), int(length));
+    pos += length;
+    return true;
+}
+
+// Reads the folder record at offset into entry
+bool readEntryAt(const uchar *data, qint64 dataSize, quint64 offset, CatalogEntry &entry)
+{
+    FolderRecord record;
+    if (!readValue(data, dataSize, offset, record)
+        || !readString(data, dataSize, offset, record.pathLength, entry.path)) {
+        return false;
+    }
+    entry.inode = record.inode;
+    entry.mtime = record.mtime;
+
+    entry.subfolders.clear();
+    entry.subfolders.reserve(int(record.subfolderCount));
+    for (quint32 i = 0; i < record.subfolderCount; ++i) {
+        quint16 length = 0;
+        QString name;
+        if (!readValue(data, dataSize, offset, length) || !readString(data, dataSize, offset, length, name)) {
+            return false;
+        }
+        entry.subfolders.append(name);
+    }
+
+    entry.mediaFiles.clear();
+    entry.mediaFiles.reserve(int(record.mediaCount));
+    for (quint32 i = 0; i < record.mediaCount; ++i) {
+        MediaRecord media;
+        CatalogMediaFile file;
+        if (!readValue(data, dataSize, offset, media)
+            || !readString(data, dataSize, offset, media.nameLength, file.name)) {
+            return false;
+        }
+        file.size = media.size;
+        file.mtime = media.mtime;
+        file.type = MediaType((media.flags & typeMask) >> typeShift);
+        if (file.type == MediaType::Unknown) {
+            file.type = MediaClassifier::typeOf(file.name);
+        }
+        file.hasPerceptualHash = media.flags & perceptualHashFlag;
+        file.perceptualHash = media.perceptualHash;
+
+        file.hasMetadata = media.flags & metadataFlag;
+        if (file.hasMetadata) {
+            MetadataRecord metadata;
+            if (!readValue(data, dataSize, offset, metadata)
+                || !readString(data, dataSize, offset, metadata.cameraLength, file.metadata.camera)
+                || !readString(data, dataSize, offset, metadata.codecLength, file.metadata.codec)) {
+                return false;
+            }
+            file.metadata.captureTime = metadata.captureTime;
+            file.metadata.duration = metadata.duration;
+            file.metadata.width = metadata.width;
+            file.metadata.height = metadata.height;
+            file.metadata.orientation = metadata.orientation;
+        }
+        entry.mediaFiles.append(file);
+    }
+    return true;
+}
+
+} // namespace
+
+QStringList CatalogEntry::mediaFileNames() const
+{
+    QStringList names;
+    names.reserve(mediaFiles.size());
+    for (const CatalogMediaFile &file : mediaFiles) {
+        names.append(file.name);
+    }
+    return names;
+}
+
+void CatalogEntry::inheritContentData(const CatalogEntry &previous)
+{
+    QHash<QString, int> previousIndex;
+    previousIndex.reserve(previous.mediaFiles.size());
+    for (int i = 0; i < previous.mediaFiles.size(); ++i) {
+        previousIndex.insert(previous.mediaFiles[i].name, i);
+    }
+
+    for (CatalogMediaFile &file : mediaFiles) {
+        int index = previousIndex.value(file.name, -1);
+        if (index < 0) continue;
+        const CatalogMediaFile &old = previous.mediaFiles[index];
+        if (old.size == file.size && old.mtime == file.mtime) {
+            file.hasPerceptualHash = old.hasPerceptualHash;
+            file.perceptualHash = old.perceptualHash;
+            file.hasMetadata = old.hasMetadata;
+            file.metadata = old.metadata;
+        }
+    }
+}
+
+CatalogBuilder::CatalogBuilder(const QString &root, bool recursive, quint64 extensionsHash)
+    : root(root)
+    , recursive(recursive)
+    , extensionsHash(extensionsHash)
+{
+}
+
+void CatalogBuilder::add(const CatalogEntry &entry)
+{
+    QByteArray path = entry.path.toUtf8();
+    offsets.append(quint64(records.size()));
+    paths.append(path);
+
+    FolderRecord record = {};
+    record.inode = entry.inode;
+    record.mtime = entry.mtime;
+    record.pathLength = quint32(path.size());
+    record.subfolderCount = quint32(entry.subfolders.size());
+    record.mediaCount = quint32(entry.mediaFiles.size());
+    appendValue(records, record);
+    records.append(path);
+
+    for (const QString &subfolder : entry.subfolders) {
+        QByteArray name = subfolder.toUtf8();
+        appendValue(records, quint16(name.size()));
+        records.append(name);
+    }
+    for (const CatalogMediaFile &file : entry.mediaFiles) {
+        QByteArray name = file.name.toUtf8();
+        MediaRecord media = {};
+        media.size = file.size;
+        media.mtime = file.mtime;
+        media.perceptualHash = file.perceptualHash;
+        media.nameLength = quint16(name.size());
+        media.flags = (file.hasPerceptualHash ? perceptualHashFlag : 0) | (file.hasMetadata ? metadataFlag : 0)
+                      | quint16(quint16(file.type) << typeShift);
+        appendValue(records, media);
+        records.append(name);
+
+        if (file.hasMetadata) {
+            const QByteArray camera = file.metadata.camera.toUtf8().left(255);
+            const QByteArray codec = file.metadata.codec.toUtf8().left(255);
+            MetadataRecord metadata = {};
+            metadata.captureTime = file.metadata.captureTime;
+            metadata.duration = file.metadata.duration;
+            metadata.width = file.metadata.width;
+            metadata.height = file.metadata.height;
+            metadata.orientation = file.metadata.orientation;
+            metadata.cameraLength = quint8(camera.size());
+            metadata.codecLength = quint8(codec.size());
+            appendValue(records, metadata);
+            records.append(camera);
+            records.append(codec);
+        }
+    }
+}
+
+CatalogBuilder CatalogBuilder::inheritingContentData(const Catalog &catalog) const
+{
+    CatalogBuilder merged(root, recursive, extensionsHash);
+    const uchar *data = reinterpret_cast<const uchar *>(records.constData());
+    for (quint64 offset : offsets) {
+        CatalogEntry entry;
+        CatalogEntry current;
+        if (!readEntryAt(data, records.size(), offset, entry)) continue;
+        if (catalog.find(entry.path, current)) {
+            entry.inheritContentData(current);
+        }
+        merged.add(entry);
+    }
+    return merged;
+}
+
+QByteArray CatalogBuilder::serialize() const
+{
+    const quint64 count = quint64(offsets.size());
+    const quint64 recordsOffset = sizeof(CatalogHeader);
+    QByteArray rootUtf8 = root.toUtf8();
+
+    CatalogHeader header = {};
+    std::memcpy(header.magic, catalogMagic, sizeof(header.magic));
+    header.version = catalogVersion;
+    header.flags = recursive ? recursiveFlag : 0;
+    header.extensionsHash = extensionsHash;
+    header.folderCount = count;
+    header.rootOffset = recordsOffset + quint64(records.size());
+    header.orderOffset = header.rootOffset + sizeof(quint32) + quint64(rootUtf8.size());
+    header.sortedOffset = header.orderOffset + count * sizeof(quint64);
+
+    QVector<int> sorted(int(count));
+    for (int i = 0; i < sorted.size(); ++i) {
+        sorted[i] = i;
+    }
+    std::sort(sorted.begin(), sorted.end(), [this](int a, int b) { return paths[a] < paths[b]; });
+
+    QByteArray out;
+    out.reserve(int(header.sortedOffset + count * sizeof(quint64)));
+    appendValue(out, header);
+    out.append(records);
+    appendValue(out, quint32(rootUtf8.size()));
+    out.append(rootUtf8);
+    for (quint64 offset : offsets) {
+        appendValue(out, recordsOffset + offset);
+    }
+    for (int index : sorted) {
+        appendValue(out, recordsOffset + offsets[index]);
+    }
+    return out;
+}
+
+Catalog::Catalog(const QString &filePath)
+    : filePath(filePath)
+{
+}
+
+Catalog::~Catalog()
+{
+    unmapFile();
+}
+
+bool Catalog::load()
+{
+    QWriteLocker locker(&lock);
+    unmapFile();
+    return mapFile();
+}
+
+bool Catalog::store(const CatalogBuilder &builder)
+{
+    // Hashes and metadata stored while the scan ran are not in what it read
+    QMutexLocker writer(&writeMutex);
+    return write(builder.inheritingContentData(*this));
+}
+
+bool Catalog::write(const CatalogBuilder &builder)
+{
+    QSaveFile out(filePath);
+    if (!out.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    out.write(builder.serialize());
+
+    // Readers keep using the old mapping until the new file is in place
+    QWriteLocker locker(&lock);
+    unmapFile();
+    if (!out.commit()) {
+        mapFile();
+        return false;
+    }
+    return mapFile();
+}
+
+bool Catalog::mapFile()
+{
+    file.setFileName(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    qint64 size = file.size();
+    const uchar *mapped = size >= qint64(sizeof(CatalogHeader)) ? file.map(0, size) : nullptr;
+    if (!mapped) {
+        file.close();
+        return false;
+    }
+
+    CatalogHeader header;
+    std::memcpy(&header, mapped, sizeof(header));
+    bool valid = std::memcmp(header.magic, catalogMagic, sizeof(header.magic)) == 0
+                 && header.version == catalogVersion
+                 && header.sortedOffset + header.folderCount * sizeof(quint64) <= quint64(size);
+    if (!valid) {
+        file.unmap(const_cast<uchar *>(mapped));
+        file.close();
+        return false;
+    }
+
+    data = mapped;
+    dataSize = size;
+    return true;
+}
+
+void Catalog::unmapFile()
+{
+    if (data) {
+        file.unmap(const_cast<uchar *>(data));
+        data = nullptr;
+        dataSize = 0;
+    }
+    file.close();
+}
+
+bool Catalog::isLoaded() const
+{
+    QReadLocker locker(&lock);
+    return data != nullptr;
+}
+
+QString Catalog::root() const
+{
+    QReadLocker locker(&lock);
+    if (!data) return QString();
+
+    CatalogHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    quint64 pos = header.rootOffset;
+    quint32 length = 0;
+    QString value;
+    if (!readValue(data, dataSize, pos, length) || !readString(data, dataSize, pos, length, value)) {
+        return QString();
+    }
+    return value;
+}
+
+bool Catalog::isRecursive() const
+{
+    QReadLocker locker(&lock);
+    if (!data) return false;
+
+    CatalogHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    return header.flags & recursiveFlag;
+}
+
+quint64 Catalog::extensionsHash() const
+{
+    QReadLocker locker(&lock);
+    if (!data) return 0;
+
+    CatalogHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    return header.extensionsHash;
+}
+
+QStringList Catalog::folders() const
+{
+    QReadLocker locker(&lock);
+    QStringList result;
+    if (!data) return result;
+
+    CatalogHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    result.reserve(int(header.folderCount));
+
+    // A non-recursive scan lists the children of the root but not the root itself
+    quint64 first = (header.flags & recursiveFlag) ? 0 : 1;
+    for (quint64 i = first; i < header.folderCount; ++i) {
+        QByteArray path = pathAt(recordOffset(header.orderOffset + i * sizeof(quint64)));
+        result.append(QString::fromUtf8(path));
+    }
+    return result;
+}
+
+bool Catalog::find(const QString &path, CatalogEntry &entry) const
+{
+    QReadLocker locker(&lock);
+    if (!data) return false;
+
+    CatalogHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    const QByteArray key = path.toUtf8();
+
+    quint64 low = 0;
+    quint64 high = header.folderCount;
+    while (low < high) {
+        quint64 middle = low + (high - low) / 2;
+        quint64 offset = recordOffset(header.sortedOffset + middle * sizeof(quint64));
+        QByteArray candidate = pathAt(offset);
+        if (candidate < key) {
+            low = middle + 1;
+        } else if (key < candidate) {
+            high = middle;
+        } else {
+            return readEntry(offset, entry);
+        }
+    }
+    return false;
+}
+
+bool Catalog::storePerceptualHashes(const QHash<QString, CatalogMediaFile> &files)
+{
+    return updateMediaFiles(files, [](CatalogMediaFile &file, const CatalogMediaFile &update) {
+        file.hasPerceptualHash = update.hasPerceptualHash;
+        file.perceptualHash = update.perceptualHash;
+    });
+}
+
+bool Catalog::storeMetadata(const QHash<QString, CatalogMediaFile> &files)
+{
+    return updateMediaFiles(files, [](CatalogMediaFile &file, const CatalogMediaFile &update) {
+        file.hasMetadata = update.hasMetadata;
+        file.metadata = update.metadata;
+    });
+}
+
+bool Catalog::updateMediaFiles(const QHash<QString, CatalogMediaFile> &files,
+                               const std::function<void(CatalogMediaFile &file, const CatalogMediaFile &update)> &apply)
+{
+    QMutexLocker writer(&writeMutex);
+    std::unique_ptr<CatalogBuilder> builder;
+    {
+        QReadLocker locker(&lock);
+        if (!data) return false;
+
+        CatalogHeader header;
+        std::memcpy(&header, data, sizeof(header));
+        quint64 pos = header.rootOffset;
+        quint32 length = 0;
+        QString rootPath;
+        if (!readValue(data, dataSize, pos, length) || !readString(data, dataSize, pos, length, rootPath)) {
+            return false;
+        }
+        builder = std::make_unique<CatalogBuilder>(rootPath, header.flags & recursiveFlag, header.extensionsHash);
+
+        // Same folders in the same order, only the updated fields change
+        for (quint64 i = 0; i < header.folderCount; ++i) {
+            CatalogEntry entry;
+            if (!readEntry(recordOffset(header.orderOffset + i * sizeof(quint64)), entry)) {
+                return false;
+            }
+            const QString prefix = entry.path.endsWith('/') ? entry.path : entry.path + "/";
+            for (CatalogMediaFile &file : entry.mediaFiles) {
+                auto it = files.constFind(prefix + file.name);
+                if (it == files.constEnd()) continue;
+                if (it->size != file.size || it->mtime != file.mtime) {
+                    qint64 size = 0;
+                    qint64 mtime = 0;
+                    if (!statFile(it.key(), size, mtime) || size != it->size || mtime != it->mtime) continue;
+                    // Rewritten in place: the update describes the file as it is now
+                    file.size = size;
+                    file.mtime = mtime;
+                    file.hasPerceptualHash = false;
+                    file.hasMetadata = false;
+                }
+                apply(file, *it);
+            }
+            builder->add(entry);
+        }
+    }
+    return write(*builder);
+}
+
+quint64 Catalog::recordOffset(quint64 index) const
+{
+    quint64 offset = 0;
+    readValue(data, dataSize, index, offset);
+    return offset;
+}
+
+QByteArray Catalog::pathAt(quint64 offset) const
+{
+    FolderRecord record;
+    if (!readValue(data, dataSize, offset, record) || offset + record.pathLength > quint64(dataSize)) {
+        return QByteArray();
+    }
+    return QByteArray::fromRawData(reinterpret_cast<const char *>(data + offset), int(record.pathLength));
+}
+
+bool Catalog::readEntry(quint64 offset, CatalogEntry &entry) const
+{
+    return readEntryAt(data, dataSize, offset, entry);
+}
+
+quint64 Catalog::hashExtensions(const QStringList &extensions)
+{
+    // FNV-1a, stable across runs unlike qHash
+    quint64 hash = 14695981039346656037ULL;
+    for (const QString &extension : extensions) {
+        const QByteArray bytes = extension.toUtf8() + '\n';
+        for (char c : bytes) {
+            hash ^= quint8(c);
+            hash *= 1099511628211ULL;
+        }
+    }
+    return hash;
+}
+
+bool Catalog::statFolder(const QString &path, quint64 &inode, qint64 &mtime)
+{
+#ifdef Q_OS_LINUX
+    struct stat st;
+    if (::stat(QFile::encodeName(path).constData(), &st) != 0 || !S_ISDIR(st.st_mode)) {
+        return false;
+    }
+    inode = quint64(st.st_ino);
+    mtime = qint64(st.st_mtim.tv_sec) * 1000000000LL + st.st_mtim.tv_nsec;
+    return true;
+#else
+    QFileInfo info(path);
+    if (!info.isDir()) return false;
+    inode = 0;
+    mtime = info.lastModified().toMSecsSinceEpoch() * 1000000LL;
+    return true;
+#endif
+}
+
+bool Catalog::statFile(const QString &path, qint64 &size, qint64 &mtime)
+{
+#ifdef Q_OS_LINUX
+    struct stat st;
+    if (::stat(QFile::encodeName(path).constData(), &st) != 0 || !S_ISREG(st.st_mode)) {
+        return false;
+    }
+    size = qint64(st.st_size);
+    mtime = qint64(st.st_mtim.tv_sec) * 1000000000LL + st.st_mtim.tv_nsec;
+    return true;
+#else
+    QFileInfo info(path);
+    if (!info.isFile()) return false;
+    size = info.size();
+    mtime = info.lastModified().toMSecsSinceEpoch() * 1000000LL;
+    return true;
+#endif
+}
+
+bool Catalog::isCurrent(const CatalogEntry &entry)
+{
+    quint64 inode = 0;
+    qint64 mtime = 0;
+    return statFolder(entry.path, inode, mtime) && inode == entry.inode && mtime == entry.mtime;
+}
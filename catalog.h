@@ -0,0 +1,122 @@
+#ifndef CATALOG_H
+#define CATALOG_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QByteArray>
+#include <QHash>
+#include <QFile>
+#include <QMutex>
+#include <QReadWriteLock>
+#include <functional>
+#include "mediametadata.h"
+#include "mediatype.h"
+
+struct CatalogMediaFile
+{
+    QString name;
+    qint64 size = 0;
+    qint64 mtime = 0; // nanoseconds since the epoch
+    MediaType type = MediaType::Unknown; // as classified when listed
+    bool hasPerceptualHash = false;
+    quint64 perceptualHash = 0;
+    bool hasMetadata = false; // the headers were read, even if they told nothing
+    MediaMetadata metadata;
+};
+
+// One scanned folder: its identity for change detection plus its sorted
+// subfolder and media file names
+struct CatalogEntry
+{
+    QString path;
+    quint64 inode = 0;
+    qint64 mtime = 0;
+    QStringList subfolders;
+    QVector<CatalogMediaFile> mediaFiles;
+
+    QStringList mediaFileNames() const;
+    // Keep what was computed from the contents of files that did not change since previous
+    void inheritContentData(const CatalogEntry &previous);
+};
+
+class Catalog;
+
+// Accumulates the entries of one scan, in the order the scan visited them
+class CatalogBuilder
+{
+public:
+    CatalogBuilder(const QString &root, bool recursive, quint64 extensionsHash);
+
+    void add(const CatalogEntry &entry);
+    // A copy whose unchanged files take their perceptual hashes and metadata from catalog
+    CatalogBuilder inheritingContentData(const Catalog &catalog) const;
+    QByteArray serialize() const;
+
+private:
+    QString root;
+    bool recursive;
+    quint64 extensionsHash;
+    QByteArray records;
+    QVector<quint64> offsets;
+    QVector<QByteArray> paths;
+};
+
+// Persistent scan results stored next to the config file. The file is a flat
+// binary image that is memory-mapped on load, so startup costs no parsing and
+// lookups are a binary search over a path-sorted index. Rescans reuse any
+// entry whose folder inode and mtime are unchanged, and within a changed
+// folder the perceptual hashes and metadata of unchanged files.
+class Catalog
+{
+public:
+    explicit Catalog(const QString &filePath);
+    ~Catalog();
+
+    bool load();
+    bool store(const CatalogBuilder &builder);
+
+    bool isLoaded() const;
+    QString root() const;
+    bool isRecursive() const;
+    quint64 extensionsHash() const;
+
+    // Folder list of the stored scan, as FileOperations::scanFolders returned it
+    QStringList folders() const;
+    bool find(const QString &path, CatalogEntry &entry) const;
+
+    // Record perceptual hashes, keyed by file path, for files whose size and
+    // mtime still match the catalog, or match the disk when the catalog's are
+    // stale (the file was rewritten in an otherwise unchanged folder); the
+    // catalog then takes the new size and mtime. Rewrites the whole file.
+    bool storePerceptualHashes(const QHash<QString, CatalogMediaFile> &files);
+    // Same for header metadata
+    bool storeMetadata(const QHash<QString, CatalogMediaFile> &files);
+
+    static quint64 hashExtensions(const QStringList &extensions);
+    static bool statFolder(const QString &path, quint64 &inode, qint64 &mtime);
+    // Size and mtime as the scan records them
+    static bool statFile(const QString &path, qint64 &size, qint64 &mtime);
+    static bool isCurrent(const CatalogEntry &entry);
+
+private:
+    QString filePath;
+    QFile file;
+    const uchar *data = nullptr;
+    qint64 dataSize = 0;
+    mutable QReadWriteLock lock;
+    // Held by every writer from reading what it updates until the new file
+    // is mapped, so concurrent updates cannot drop each other's changes
+    QMutex writeMutex;
+
+    bool mapFile();
+    void unmapFile();
+    quint64 recordOffset(quint64 index) const;
+    QByteArray pathAt(quint64 offset) const;
+    bool readEntry(quint64 offset, CatalogEntry &entry) const;
+    bool write(const CatalogBuilder &builder);
+    bool updateMediaFiles(const QHash<QString, CatalogMediaFile> &files,
+                          const std::function<void(CatalogMediaFile &file, const CatalogMediaFile &update)> &apply);
+};
+
+#endif // CATALOG_H
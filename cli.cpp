@@ -0,0 +1,246 @@
+#include "catalog.h"
+#include "configmanager.h"
+#include "deletequeue.h"
+#include "duplicatefinder.h"
+#include "fileoperations.h"
+#include "metadataextractor.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+#include <cstdio>
+#include <memory>
+
+// Headless front end to the scanning and file engines for scripts and cron.
+// Every command writes one JSON object per line to stdout.
+
+namespace {
+
+const int exitOk = 0;
+const int exitFailures = 1;
+const int exitUsage = 2;
+
+void emitRecord(const QJsonObject &record, FILE *stream = stdout)
+{
+    const QByteArray line = QJsonDocument(record).toJson(QJsonDocument::Compact);
+    std::fwrite(line.constData(), 1, size_t(line.size()), stream);
+    std::fputc('\n', stream);
+}
+
+// The folders a command works on: the root itself, then what a scan finds
+QStringList collectFolders(FileOperations &fileOperations, const QString &root, bool recursive)
+{
+    QStringList folders;
+    if (!recursive) {
+        folders.append(root);
+    }
+    folders.append(fileOperations.scanFolders(root, recursive));
+    return folders;
+}
+
+// Only the fields the headers gave
+void addMetadata(QJsonObject &record, const MediaMetadata &metadata)
+{
+    if (metadata.width > 0) record.insert("width", qint64(metadata.width));
+    if (metadata.height > 0) record.insert("height", qint64(metadata.height));
+    if (metadata.orientation > 0) record.insert("orientation", metadata.orientation);
+    if (metadata.captureTime != 0) record.insert("captured", metadata.captureTime);
+    if (metadata.duration > 0) record.insert("duration", metadata.duration);
+    if (!metadata.camera.isEmpty()) record.insert("camera", metadata.camera);
+    if (!metadata.codec.isEmpty()) record.insert("codec", metadata.codec);
+}
+
+int scanCommand(FileOperations &fileOperations, const QString &root, bool recursive)
+{
+    QElapsedTimer timer;
+    timer.start();
+    qint64 count = 0;
+    bool completed = fileOperations.scanFolders(root, recursive, [&count](const QString &folder) {
+        emitRecord({{"type", "folder"}, {"path", folder}});
+        ++count;
+        return true;
+    });
+    emitRecord({{"type", "summary"}, {"folders", count}, {"ms", timer.elapsed()}});
+    return completed ? exitOk : exitFailures;
+}
+
+int listCommand(FileOperations &fileOperations, const QString &root, bool recursive, const QStringList &extensions)
+{
+    QElapsedTimer timer;
+    timer.start();
+    qint64 count = 0;
+    qint64 bytes = 0;
+    const QStringList folders = collectFolders(fileOperations, root, recursive);
+    for (const QString &folder : folders) {
+        const QVector<CatalogMediaFile> files = fileOperations.getMediaFileInfo(folder, extensions);
+        for (const CatalogMediaFile &file : files) {
+            QJsonObject record{{"type", "media"}, {"path", folder + "/" + file.name}, {"size", file.size},
+                               {"mtime", file.mtime / 1000000}};
+            if (file.hasMetadata) {
+                addMetadata(record, file.metadata);
+            }
+            emitRecord(record);
+            ++count;
+            bytes += file.size;
+        }
+    }
+    emitRecord({{"type", "summary"}, {"folders", folders.size()}, {"media", count}, {"bytes", bytes},
+                {"ms", timer.elapsed()}});
+    return exitOk;
+}
+
+int duplicatesCommand(FileOperations &fileOperations, Catalog *catalog, const QString &root, bool recursive,
+                      const QStringList &extensions, bool showProgress)
+{
+    QElapsedTimer timer;
+    timer.start();
+    DuplicateFinder finder(collectFolders(fileOperations, root, recursive), catalog, extensions);
+    if (showProgress) {
+        // Emitted on the finder's thread; nothing else writes to stderr meanwhile
+        QObject::connect(&finder, &DuplicateFinder::progress, [](const QString &stage, qint64 done, qint64 total) {
+            emitRecord({{"type", "progress"}, {"stage", stage}, {"done", done}, {"total", total}}, stderr);
+        }, Qt::DirectConnection);
+    }
+    finder.start(QThread::LowPriority);
+    finder.wait();
+
+    qint64 reclaimable = 0;
+    const QVector<DuplicateGroup> groups = finder.groups();
+    for (const DuplicateGroup &group : groups) {
+        emitRecord({{"type", "duplicates"}, {"size", group.size}, {"paths", QJsonArray::fromStringList(group.paths)}});
+        reclaimable += group.size * (group.paths.size() - 1);
+    }
+    emitRecord({{"type", "summary"}, {"groups", groups.size()}, {"reclaimable", reclaimable}, {"ms", timer.elapsed()}});
+    return finder.isCompleted() ? exitOk : exitFailures;
+}
+
+int metadataCommand(FileOperations &fileOperations, Catalog *catalog, const QString &root, bool recursive,
+                    const QStringList &extensions, bool showProgress)
+{
+    QElapsedTimer timer;
+    timer.start();
+    MetadataExtractor extractor(collectFolders(fileOperations, root, recursive), catalog, extensions);
+    if (showProgress) {
+        QObject::connect(&extractor, &MetadataExtractor::progress, [](const QString &stage, qint64 done, qint64 total) {
+            emitRecord({{"type", "progress"}, {"stage", stage}, {"done", done}, {"total", total}}, stderr);
+        }, Qt::DirectConnection);
+    }
+    extractor.start();
+    extractor.wait();
+    emitRecord({{"type", "summary"}, {"extracted", extractor.extractedCount()}, {"ms", timer.elapsed()}});
+    return extractor.isCompleted() ? exitOk : exitFailures;
+}
+
+int deleteCommand(FileOperations &fileOperations, QStringList paths)
+{
+    // "-" reads the paths from stdin, one per line
+    if (paths == QStringList{"-"}) {
+        paths.clear();
+        QTextStream input(stdin);
+        QString line;
+        while (input.readLineInto(&line)) {
+            if (!line.isEmpty()) {
+                paths.append(line);
+            }
+        }
+    }
+    for (QString &path : paths) {
+        path = QFileInfo(path).absoluteFilePath();
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    const QHash<QString, QString> failures = fileOperations.deletePaths(paths);
+    for (const QString &path : std::as_const(paths)) {
+        auto it = failures.constFind(path);
+        if (it == failures.constEnd()) {
+            emitRecord({{"type", "deleted"}, {"path", path}});
+        } else {
+            emitRecord({{"type", "error"}, {"path", path}, {"error", it.value()}});
+        }
+    }
+    emitRecord({{"type", "summary"}, {"deleted", paths.size() - failures.size()}, {"failed", failures.size()},
+                {"ms", timer.elapsed()}});
+    return failures.isEmpty() ? exitOk : exitFailures;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("smartrabbit-cli");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Scan, list, find duplicates in and delete from a media library.\n"
+                                     "Output is newline-delimited JSON.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("command", "scan, list, metadata, duplicates or delete");
+    parser.addPositionalArgument("paths", "Library folder, or for delete the files and folders (- reads stdin)");
+    QCommandLineOption recursiveOption({"r", "recursive"}, "Include subfolders at every depth");
+    QCommandLineOption catalogOption("catalog", "Read and update this scan catalog", "file");
+    QCommandLineOption trashOption("trash", "Delete into the undoable trash instead of unlinking; paths that cannot\n"
+                                            "be trashed are reported as errors and left in place");
+    QCommandLineOption progressOption("progress", "Write progress records to stderr");
+    parser.addOptions({recursiveOption, catalogOption, trashOption, progressOption});
+    parser.process(app);
+
+    const QStringList arguments = parser.positionalArguments();
+    const QString command = arguments.value(0);
+    if (arguments.size() < 2 || (command != "delete" && arguments.size() != 2)) {
+        std::fputs(qPrintable(parser.helpText()), stderr);
+        return exitUsage;
+    }
+
+    ConfigManager configManager;
+    configManager.load();
+    const QStringList extensions = configManager.getSupportedExtensions();
+
+    FileOperations fileOperations;
+    std::unique_ptr<Catalog> catalog;
+    if (parser.isSet(catalogOption)) {
+        catalog.reset(new Catalog(parser.value(catalogOption)));
+        catalog->load();
+        fileOperations.setCatalog(catalog.get(), extensions);
+    }
+
+    const QString root = QDir(arguments.value(1)).absolutePath();
+    const bool recursive = parser.isSet(recursiveOption);
+    int status = exitUsage;
+    if (command == "scan") {
+        status = scanCommand(fileOperations, root, recursive);
+    } else if (command == "list") {
+        status = listCommand(fileOperations, root, recursive, extensions);
+    } else if (command == "metadata") {
+        // Results only persist in a catalog; list shows them afterwards
+        if (!catalog) {
+            std::fputs("metadata needs --catalog\n", stderr);
+            return exitUsage;
+        }
+        status = metadataCommand(fileOperations, catalog.get(), root, recursive, extensions,
+                                 parser.isSet(progressOption));
+    } else if (command == "duplicates") {
+        status = duplicatesCommand(fileOperations, catalog.get(), root, recursive, extensions,
+                                   parser.isSet(progressOption));
+    } else if (command == "delete") {
+        // A path is reported deleted once it is in the trash. Purges of expired
+        // trash may be cut short at exit; the journal resumes them next time.
+        std::unique_ptr<DeleteQueue> deleteQueue;
+        if (parser.isSet(trashOption)) {
+            deleteQueue.reset(new DeleteQueue(configManager.getTrashJournalFile()));
+            deleteQueue->setRetentionMinutes(configManager.getTrashRetentionMinutes());
+            fileOperations.setDeleteQueue(deleteQueue.get());
+        }
+        status = deleteCommand(fileOperations, arguments.mid(1));
+    } else {
+        std::fputs(qPrintable(parser.helpText()), stderr);
+    }
+
+    std::fflush(stdout);
+    return status;
+}
@@ -9,6 +9,9 @@ ConfigManager::ConfigManager()
 {
     // Use application directory for config file
     configFile = QDir::currentPath() + "/media_organizer.json";
+    catalogFile = QDir::currentPath() + "/media_organizer.catalog";
+    thumbnailFile = QDir::currentPath() + "/media_organizer.thumbs";
+    trashJournalFile = QDir::currentPath() + "/media_organizer.trash";
 }
 
 bool ConfigManager::load()
@@ -30,6 +33,22 @@ bool ConfigManager::load()
     mainFolder = config.value("main_folder").toString("");
     recursive = config.value("recursive").toBool(false);
     skipDeleteConfirmation = config.value("skip_delete_confirmation").toBool(false);
+    skipEmptyFolders = config.value("skip_empty_folders").toBool(false);
+    prefetchAhead = config.value("prefetch_ahead").toInt(3);
+    prefetchBehind = config.value("prefetch_behind").toInt(1);
+    imageCacheMegabytes = config.value("image_cache_mb").toInt(256);
+    similarityThreshold = config.value("similarity_threshold").toInt(7);
+    trashRetentionMinutes = config.value("trash_retention_minutes").toInt(30);
+    sniffContent = config.value("sniff_content").toBool(false);
+
+    transferTargets.clear();
+    const QJsonObject targets = config.value("transfer_targets").toObject();
+    for (auto it = targets.begin(); it != targets.end(); ++it) {
+        int key = it.key().toInt();
+        const QJsonObject target = it.value().toObject();
+        if (key < 1 || key > 9 || target.value("folder").toString().isEmpty()) continue;
+        transferTargets.insert(key, {target.value("folder").toString(), target.value("copy").toBool(false)});
+    }
 
     return true;
 }
@@ -40,6 +59,19 @@ bool ConfigManager::save()
     config.insert("main_folder", mainFolder);
     config.insert("recursive", recursive);
     config.insert("skip_delete_confirmation", skipDeleteConfirmation);
+    config.insert("skip_empty_folders", skipEmptyFolders);
+    config.insert("prefetch_ahead", prefetchAhead);
+    config.insert("prefetch_behind", prefetchBehind);
+    config.insert("image_cache_mb", imageCacheMegabytes);
+    config.insert("similarity_threshold", similarityThreshold);
+    config.insert("trash_retention_minutes", trashRetentionMinutes);
+    config.insert("sniff_content", sniffContent);
+
+    QJsonObject targets;
+    for (auto it = transferTargets.constBegin(); it != transferTargets.constEnd(); ++it) {
+        targets.insert(QString::number(it.key()), QJsonObject{{"folder", it->folder}, {"copy", it->copy}});
+    }
+    config.insert("transfer_targets", targets);
 
     QJsonDocument doc(config);
     QFile file(configFile);
@@ -57,5 +89,8 @@ QStringList ConfigManager::getSupportedExtensions() const
     QStringList extensions;
     extensions.append(imageExtensions);
     extensions.append(videoExtensions);
+    if (sniffContent) {
+        extensions.append(MediaClassifier::sniffMarker());
+    }
     return extensions;
 }
@@ -4,6 +4,14 @@
 #include <QString>
 #include <QStringList>
 #include <QMap>
+#include "mediatype.h"
+
+// A folder the number keys send media to
+struct TransferTarget
+{
+    QString folder;
+    bool copy = false; // leave the original where it is
+};
 
 class ConfigManager
 {
@@ -22,17 +30,47 @@ public:
     bool getSkipDeleteConfirmation() const { return skipDeleteConfirmation; }
     void setSkipDeleteConfirmation(bool value) { skipDeleteConfirmation = value; }
 
+    bool getSkipEmptyFolders() const { return skipEmptyFolders; }
+    void setSkipEmptyFolders(bool value) { skipEmptyFolders = value; }
+
+    int getPrefetchAhead() const { return prefetchAhead; }
+    int getPrefetchBehind() const { return prefetchBehind; }
+    int getImageCacheMegabytes() const { return imageCacheMegabytes; }
+    int getSimilarityThreshold() const { return similarityThreshold; }
+    int getTrashRetentionMinutes() const { return trashRetentionMinutes; }
+
+    // By number key, 1 to 9
+    QMap<int, TransferTarget> getTransferTargets() const { return transferTargets; }
+    void setTransferTarget(int key, const TransferTarget &target) { transferTargets.insert(key, target); }
+
+    QString getCatalogFile() const { return catalogFile; }
+    QString getThumbnailFile() const { return thumbnailFile; }
+    QString getTrashJournalFile() const { return trashJournalFile; }
+
+    // Image and video extensions, plus MediaClassifier::sniffMarker() when
+    // files with other names are to be recognized by their content
     QStringList getSupportedExtensions() const;
     QStringList getImageExtensions() const { return imageExtensions; }
     QStringList getVideoExtensions() const { return videoExtensions; }
 
 private:
     QString configFile = "media_organizer.json";
+    QString catalogFile = "media_organizer.catalog";
+    QString thumbnailFile = "media_organizer.thumbs";
+    QString trashJournalFile = "media_organizer.trash";
     QString mainFolder;
     bool recursive = false;
     bool skipDeleteConfirmation = false;
-    QStringList imageExtensions = {".jpg", ".jpeg", ".png", ".gif", ".bmp", ".webp"};
-    QStringList videoExtensions = {".mp4", ".avi", ".mov", ".mkv", ".wmv", ".flv", ".m4v", ".webm"};
+    bool skipEmptyFolders = false; // folder navigation passes over folders without media
+    int prefetchAhead = 3;
+    int prefetchBehind = 1;
+    int imageCacheMegabytes = 256;
+    int trashRetentionMinutes = 30; // how long deletes can be undone
+    QMap<int, TransferTarget> transferTargets;
+    int similarityThreshold = 7; // max differing bits of two perceptual hashes; up to 7 keeps the index probes cheap
+    bool sniffContent = false; // costs a read per file without a media extension
+    QStringList imageExtensions = MediaClassifier::extensions(MediaType::Image);
+    QStringList videoExtensions = MediaClassifier::extensions(MediaType::Video);
 };
 
 #endif // CONFIGMANAGER_H
@@ -0,0 +1,137 @@
+#include "contenthash.h"
+#include <cstring>
+
+namespace {
+
+const quint64 prime1 = 11400714785074694791ULL;
+const quint64 prime2 = 14029467366897019727ULL;
+const quint64 prime3 = 1609587929392839161ULL;
+const quint64 prime4 = 9650029242287828579ULL;
+const quint64 prime5 = 2870177450012600261ULL;
+
+inline quint64 rotl(quint64 x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+inline quint64 read64(const unsigned char *p)
+{
+    quint64 v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline quint32 read32(const unsigned char *p)
+{
+    quint32 v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline quint64 hashRound(quint64 acc, quint64 input)
+{
+    acc += input * prime2;
+    acc = rotl(acc, 31);
+    return acc * prime1;
+}
+
+inline quint64 mergeRound(quint64 acc, quint64 value)
+{
+    acc ^= hashRound(0, value);
+    return acc * prime1 + prime4;
+}
+
+} // namespace
+
+ContentHash::ContentHash(quint64 seed)
+{
+    reset(seed);
+}
+
+void ContentHash::reset(quint64 seed)
+{
+    this->seed = seed;
+    v1 = seed + prime1 + prime2;
+    v2 = seed + prime2;
+    v3 = seed;
+    v4 = seed - prime1;
+    totalLength = 0;
+    bufferSize = 0;
+}
+
+void ContentHash::update(const void *data, qint64 length)
+{
+    const unsigned char *p = static_cast<const unsigned char *>(data);
+    const unsigned char *end = p + length;
+    totalLength += quint64(length);
+
+    if (bufferSize + length < 32) {
+        std::memcpy(buffer + bufferSize, p, size_t(length));
+        bufferSize += int(length);
+        return;
+    }
+
+    if (bufferSize > 0) {
+        const int fill = 32 - bufferSize;
+        std::memcpy(buffer + bufferSize, p, size_t(fill));
+        v1 = hashRound(v1, read64(buffer));
+        v2 = hashRound(v2, read64(buffer + 8));
+        v3 = hashRound(v3, read64(buffer + 16));
+        v4 = hashRound(v4, read64(buffer + 24));
+        p += fill;
+        bufferSize = 0;
+    }
+
+    while (end - p >= 32) {
+        v1 = hashRound(v1, read64(p));
+        v2 = hashRound(v2, read64(p + 8));
+        v3 = hashRound(v3, read64(p + 16));
+        v4 = hashRound(v4, read64(p + 24));
+        p += 32;
+    }
+
+    if (p < end) {
+        bufferSize = int(end - p);
+        std::memcpy(buffer, p, size_t(bufferSize));
+    }
+}
+
+quint64 ContentHash::digest() const
+{
+    quint64 h;
+    if (totalLength >= 32) {
+        h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+        h = mergeRound(h, v1);
+        h = mergeRound(h, v2);
+        h = mergeRound(h, v3);
+        h = mergeRound(h, v4);
+    } else {
+        h = seed + prime5;
+    }
+    h += totalLength;
+
+    const unsigned char *p = buffer;
+    const unsigned char *end = buffer + bufferSize;
+    while (end - p >= 8) {
+        h ^= hashRound(0, read64(p));
+        h = rotl(h, 27) * prime1 + prime4;
+        p += 8;
+    }
+    if (end - p >= 4) {
+        h ^= quint64(read32(p)) * prime1;
+        h = rotl(h, 23) * prime2 + prime3;
+        p += 4;
+    }
+    while (p < end) {
+        h ^= quint64(*p) * prime5;
+        h = rotl(h, 11) * prime1;
+        ++p;
+    }
+
+    h ^= h >> 33;
+    h *= prime2;
+    h ^= h >> 29;
+    h *= prime3;
+    h ^= h >> 32;
+    return h;
+}
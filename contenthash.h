@@ -0,0 +1,25 @@
+#ifndef CONTENTHASH_H
+#define CONTENTHASH_H
+
+#include <QtGlobal>
+
+// Streaming XXH64, a fast non-cryptographic hash used to compare file contents.
+// Results match the reference implementation on little-endian hosts.
+class ContentHash
+{
+public:
+    explicit ContentHash(quint64 seed = 0);
+
+    void reset(quint64 seed = 0);
+    void update(const void *data, qint64 length);
+    quint64 digest() const;
+
+private:
+    quint64 v1, v2, v3, v4;
+    quint64 totalLength;
+    unsigned char buffer[32];
+    int bufferSize;
+    quint64 seed;
+};
+
+#endif // CONTENTHASH_H
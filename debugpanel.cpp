@@ -0,0 +1,119 @@
+#include "debugpanel.h"
+#include <QDialogButtonBox>
+#include <QFileDialog>
+#include <QFormLayout>
+#include <QLabel>
+#include <QMessageBox>
+#include <QPushButton>
+#include <QVBoxLayout>
+
+DebugPanel::DebugPanel(QWidget *parent)
+    : QDialog(parent)
+{
+    setWindowTitle("Debug");
+
+    foldersRate = new QLabel(this);
+    filesRate = new QLabel(this);
+    decodeRate = new QLabel(this);
+    decodeAverage = new QLabel(this);
+    cacheHitRate = new QLabel(this);
+    deleted = new QLabel(this);
+    spans = new QLabel(this);
+
+    QFormLayout *form = new QFormLayout;
+    form->addRow("Folders scanned/s:", foldersRate);
+    form->addRow("Files listed/s:", filesRate);
+    form->addRow("Images decoded/s:", decodeRate);
+    form->addRow("Average decode:", decodeAverage);
+    form->addRow("Cache hit rate:", cacheHitRate);
+    form->addRow("Files deleted:", deleted);
+    form->addRow("Recorded spans:", spans);
+
+    QDialogButtonBox *buttons = new QDialogButtonBox(QDialogButtonBox::Close, this);
+    traceButton = buttons->addButton("Start Tracing", QDialogButtonBox::ActionRole);
+    QPushButton *clearButton = buttons->addButton("Clear", QDialogButtonBox::ActionRole);
+    QPushButton *exportButton = buttons->addButton("Export Trace...", QDialogButtonBox::ActionRole);
+    connect(traceButton, &QPushButton::clicked, this, &DebugPanel::toggleTracing);
+    connect(clearButton, &QPushButton::clicked, this, &DebugPanel::clearTrace);
+    connect(exportButton, &QPushButton::clicked, this, &DebugPanel::exportTrace);
+    connect(buttons, &QDialogButtonBox::rejected, this, &QDialog::reject);
+
+    QVBoxLayout *layout = new QVBoxLayout(this);
+    layout->addLayout(form);
+    layout->addWidget(buttons);
+
+    refreshTimer.setInterval(500);
+    connect(&refreshTimer, &QTimer::timeout, this, &DebugPanel::refresh);
+}
+
+void DebugPanel::showEvent(QShowEvent *event)
+{
+    for (int i = 0; i < int(TraceCounter::Count); ++i) {
+        previous[i] = Tracer::counter(TraceCounter(i));
+    }
+    sinceRefresh.start();
+    refresh();
+    refreshTimer.start();
+    QDialog::showEvent(event);
+}
+
+void DebugPanel::hideEvent(QHideEvent *event)
+{
+    refreshTimer.stop();
+    QDialog::hideEvent(event);
+}
+
+void DebugPanel::refresh()
+{
+    qint64 current[int(TraceCounter::Count)];
+    qint64 delta[int(TraceCounter::Count)];
+    for (int i = 0; i < int(TraceCounter::Count); ++i) {
+        current[i] = Tracer::counter(TraceCounter(i));
+        delta[i] = current[i] - previous[i];
+        previous[i] = current[i];
+    }
+    const double seconds = qMax<qint64>(1, sinceRefresh.restart()) / 1000.0;
+    auto rate = [&](TraceCounter counter) {
+        return QString::number(delta[int(counter)] / seconds, 'f', 1);
+    };
+
+    foldersRate->setText(rate(TraceCounter::FoldersScanned));
+    filesRate->setText(rate(TraceCounter::FilesListed));
+    decodeRate->setText(rate(TraceCounter::ImagesDecoded));
+
+    const qint64 decoded = current[int(TraceCounter::ImagesDecoded)];
+    decodeAverage->setText(decoded == 0 ? QString("-")
+        : QString("%1 ms").arg(current[int(TraceCounter::DecodeNanoseconds)] / 1e6 / decoded, 0, 'f', 2));
+
+    const qint64 hits = current[int(TraceCounter::CacheHits)];
+    const qint64 lookups = hits + current[int(TraceCounter::CacheMisses)];
+    cacheHitRate->setText(lookups == 0 ? QString("-")
+        : QString("%1% of %2").arg(100.0 * hits / lookups, 0, 'f', 1).arg(lookups));
+
+    deleted->setText(QString::number(current[int(TraceCounter::FilesDeleted)]));
+    spans->setText(QString::number(Tracer::spanCount()));
+}
+
+void DebugPanel::toggleTracing()
+{
+    Tracer::setEnabled(!Tracer::isEnabled());
+    traceButton->setText(Tracer::isEnabled() ? "Stop Tracing" : "Start Tracing");
+}
+
+void DebugPanel::clearTrace()
+{
+    Tracer::clear();
+    refresh();
+}
+
+void DebugPanel::exportTrace()
+{
+    QString path = QFileDialog::getSaveFileName(this, "Export Trace", "smartrabbit-trace.json",
+                                                "Chrome Trace (*.json)");
+    if (path.isEmpty()) return;
+
+    QString error;
+    if (!Tracer::writeChromeTrace(path, &error)) {
+        QMessageBox::warning(this, "Export Trace", QString("Could not write %1: %2").arg(path, error));
+    }
+}
@@ -0,0 +1,46 @@
+#ifndef DEBUGPANEL_H
+#define DEBUGPANEL_H
+
+#include <QDialog>
+#include <QElapsedTimer>
+#include <QTimer>
+#include "tracer.h"
+
+class QLabel;
+class QPushButton;
+
+// Live view of the Tracer counters (F12). Rates are computed from the
+// counter deltas between two refreshes; the buttons switch span recording
+// on and off and export what was recorded as a Chrome trace.
+class DebugPanel : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit DebugPanel(QWidget *parent = nullptr);
+
+protected:
+    void showEvent(QShowEvent *event) override;
+    void hideEvent(QHideEvent *event) override;
+
+private:
+    QTimer refreshTimer;
+    QElapsedTimer sinceRefresh;
+    qint64 previous[int(TraceCounter::Count)] = {};
+
+    QLabel *foldersRate;
+    QLabel *filesRate;
+    QLabel *decodeRate;
+    QLabel *decodeAverage;
+    QLabel *cacheHitRate;
+    QLabel *deleted;
+    QLabel *spans;
+    QPushButton *traceButton;
+
+    void refresh();
+    void toggleTracing();
+    void clearTrace();
+    void exportTrace();
+};
+
+#endif // DEBUGPANEL_H
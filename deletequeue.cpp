@@ -0,0 +1,464 @@
+#include "deletequeue.h"
+#include "batchfileops.h"
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMetaObject>
+#include <QSaveFile>
+#include <QStorageInfo>
+#include <cerrno>
+#include <string>
+#include <vector>
+
+#ifdef Q_OS_LINUX
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+#ifdef Q_OS_LINUX
+// Unlinks a file or a whole tree with *at() calls relative to already open
+// folders. Each folder is listed completely before its entries are unlinked
+// in one run, so no path is resolved twice and the listing stays valid.
+bool removeTree(int parentFd, const char *name, const std::atomic<bool> &stop)
+{
+    if (::unlinkat(parentFd, name, 0) == 0 || errno == ENOENT) {
+        return true;
+    }
+    if (errno != EISDIR && errno != EPERM) {
+        return false;
+    }
+
+    int fd = ::openat(parentFd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    std::vector<std::string> files;
+    std::vector<std::string> folders;
+    alignas(struct dirent64) char buffer[64 * 1024];
+    for (;;) {
+        long bytes = ::syscall(SYS_getdents64, fd, buffer, sizeof(buffer));
+        if (bytes <= 0) {
+            break;
+        }
+        for (long offset = 0; offset < bytes;) {
+            auto *dirent = reinterpret_cast<struct dirent64 *>(buffer + offset);
+            offset += dirent->d_reclen;
+            const char *child = dirent->d_name;
+            if (child[0] == '.' && (child[1] == '\0' || (child[1] == '.' && child[2] == '\0'))) {
+                continue;
+            }
+            (dirent->d_type == DT_DIR ? folders : files).push_back(child);
+        }
+    }
+
+    bool ok = true;
+    for (const std::string &file : files) {
+        if (stop) break;
+        if (::unlinkat(fd, file.c_str(), 0) != 0 && errno != ENOENT) {
+            if (errno == EISDIR) {
+                folders.push_back(file); // d_type was unknown
+            } else {
+                ok = false;
+            }
+        }
+    }
+    for (const std::string &folder : folders) {
+        if (stop) break;
+        ok = removeTree(fd, folder.c_str(), stop) && ok;
+    }
+    ::close(fd);
+
+    if (stop) {
+        return false;
+    }
+    return ok && (::unlinkat(parentFd, name, AT_REMOVEDIR) == 0 || errno == ENOENT);
+}
+#endif
+
+bool removePath(const QString &path, const std::atomic<bool> &stop)
+{
+#ifdef Q_OS_LINUX
+    return removeTree(AT_FDCWD, QFile::encodeName(path).constData(), stop);
+#else
+    Q_UNUSED(stop);
+    QFileInfo info(path);
+    if (!info.exists() && !info.isSymLink()) {
+        return true;
+    }
+    return info.isDir() && !info.isSymLink() ? QDir(path).removeRecursively() : QFile::remove(path);
+#endif
+}
+
+bool pathExists(const QString &path)
+{
+    QFileInfo info(path);
+    return info.exists() || info.isSymLink();
+}
+
+} // namespace
+
+DeleteQueue::DeleteQueue(const QString &journalPath, QObject *parent)
+    : QObject(parent)
+    , journal(journalPath)
+{
+    loadJournal();
+
+    connect(&purgeTimer, &QTimer::timeout, this, &DeleteQueue::purgeExpired);
+    purgeTimer.start(60 * 1000);
+    worker = std::thread([this]() { runWorker(); });
+}
+
+DeleteQueue::~DeleteQueue()
+{
+    // Unfinished purges are still in the journal and resume on the next start
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        stopping = true;
+    }
+    queueChanged.notify_all();
+    worker.join();
+}
+
+void DeleteQueue::setRetentionMinutes(int minutes)
+{
+    retentionMs = qint64(qMax(0, minutes)) * 60 * 1000;
+    purgeExpired();
+}
+
+bool DeleteQueue::remove(const QString &path, QString *error)
+{
+    QHash<QString, QString> failures;
+    if (remove(QStringList{path}, &failures) > 0) {
+        return true;
+    }
+    if (error) *error = failures.isEmpty() ? QString() : failures.begin().value();
+    return false;
+}
+
+int DeleteQueue::remove(const QStringList &paths, QHash<QString, QString> *failures, QStringList *untrashable)
+{
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    const quint64 batch = nextId;
+    QVector<Entry> trashed;
+    QVector<FileOp> renames;
+    QHash<QString, bool> writableFolders;
+
+    for (const QString &path : paths) {
+        if (!checkRemovable(path, writableFolders, failures)) continue;
+
+        Entry entry;
+        entry.id = nextId++;
+        entry.batch = batch;
+        entry.time = now;
+        entry.path = QFileInfo(path).absoluteFilePath();
+
+        const QString trash = trashFolderFor(entry.path);
+        if (trash.isEmpty()) {
+            if (failures) failures->insert(path, "No trash on this file system");
+            if (untrashable) untrashable->append(path);
+            continue;
+        }
+        // The journal has the original name; keeping it here could exceed NAME_MAX
+        entry.trashPath = QString("%1/%2-%3").arg(trash).arg(entry.time).arg(entry.id);
+        trashed.append(entry);
+        renames.append(BatchFileOps::rename(entry.path, entry.trashPath));
+    }
+
+    // Journal first: a crash after the renames must still find the trashed items
+    for (const Entry &entry : std::as_const(trashed)) {
+        appendJournal("trash", entry);
+    }
+    journal.flush();
+    BatchFileOps::run(renames);
+
+    int removed = 0;
+    for (int i = 0; i < trashed.size(); ++i) {
+        const Entry &entry = trashed[i];
+        const int error = renames[i].error;
+        if (error == 0) {
+            entries.append(entry);
+            ++removed;
+            continue;
+        }
+        appendJournal("restore", entry);
+        if (error == ENOENT || error == EACCES || error == EPERM || error == EROFS || error == EBUSY) {
+            if (failures) failures->insert(entry.path, BatchFileOps::errorString(error));
+        } else {
+            // Such as EXDEV from a bind mount; deleting it outright could still work
+            if (failures) failures->insert(entry.path, "Cannot move to the trash: " + BatchFileOps::errorString(error));
+            if (untrashable) untrashable->append(entry.path);
+        }
+    }
+    journal.flush();
+    return removed;
+}
+
+int DeleteQueue::removePermanently(const QStringList &paths, QHash<QString, QString> *failures)
+{
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    const quint64 batch = nextId;
+    QHash<QString, bool> writableFolders;
+
+    int removed = 0;
+    for (const QString &path : paths) {
+        if (!checkRemovable(path, writableFolders, failures)) continue;
+
+        Entry entry;
+        entry.id = nextId++;
+        entry.batch = batch;
+        entry.time = now;
+        entry.path = QFileInfo(path).absoluteFilePath();
+        entry.trashPath = entry.path;
+        appendJournal("trash", entry);
+        schedulePurge(entry);
+        ++removed;
+    }
+    journal.flush();
+    return removed;
+}
+
+bool DeleteQueue::checkRemovable(const QString &path, QHash<QString, bool> &writableFolders,
+                                 QHash<QString, QString> *failures)
+{
+    const QString folder = QFileInfo(path).absolutePath();
+    auto writable = writableFolders.find(folder);
+    if (writable == writableFolders.end()) {
+        writable = writableFolders.insert(folder, QFileInfo(folder).isWritable());
+    }
+    if (!pathExists(path)) {
+        if (failures) failures->insert(path, "No such file or folder");
+        return false;
+    }
+    if (!*writable) {
+        if (failures) failures->insert(path, "Permission denied");
+        return false;
+    }
+    return true;
+}
+
+bool DeleteQueue::canUndo() const
+{
+    return !entries.isEmpty();
+}
+
+QStringList DeleteQueue::undo(QString *error)
+{
+    if (entries.isEmpty()) {
+        if (error) *error = "Nothing to undo";
+        return QStringList();
+    }
+
+    const quint64 batch = entries.last().batch;
+    int first = entries.size();
+    while (first > 0 && entries[first - 1].batch == batch) {
+        --first;
+    }
+
+    // Renames never replace, so anything recreated in the meantime is kept
+    QVector<FileOp> renames;
+    for (int i = first; i < entries.size(); ++i) {
+        renames.append(BatchFileOps::rename(entries[i].trashPath, entries[i].path));
+    }
+    BatchFileOps::run(renames);
+
+    QStringList restored;
+    QVector<Entry> kept;
+    int failedError = 0;
+    for (int i = first; i < entries.size(); ++i) {
+        const Entry &entry = entries[i];
+        const int renameError = renames[i - first].error;
+        if (renameError == 0) {
+            restored.append(entry.path);
+            appendJournal("restore", entry);
+        } else {
+            kept.append(entry);
+            failedError = renameError;
+        }
+    }
+    journal.flush();
+    entries.resize(first);
+    entries.append(kept);
+
+    if (error && kept.size() == 1) {
+        *error = QString("Could not move %1 back: %2").arg(QFileInfo(kept.first().path).fileName(),
+                                                           BatchFileOps::errorString(failedError));
+    } else if (error && !kept.isEmpty()) {
+        *error = QString("Could not move %1 items back").arg(kept.size());
+    }
+    return restored;
+}
+
+void DeleteQueue::loadJournal()
+{
+    QHash<quint64, Entry> live;
+    QVector<quint64> order;
+    if (journal.open(QIODevice::ReadOnly)) {
+        while (!journal.atEnd()) {
+            const QJsonObject record = QJsonDocument::fromJson(journal.readLine()).object();
+            const QString op = record.value("op").toString();
+            const quint64 id = quint64(record.value("id").toInteger());
+            const quint64 batch = quint64(record.value("batch").toInteger(qint64(id)));
+            nextId = qMax(nextId, id + 1);
+            if (op == "trash") {
+                Entry entry;
+                entry.id = id;
+                entry.batch = batch;
+                entry.time = record.value("time").toInteger();
+                entry.path = record.value("path").toString();
+                entry.trashPath = record.value("trash").toString();
+                live.insert(id, entry);
+                order.append(id);
+            } else {
+                live.remove(id);
+            }
+        }
+        journal.close();
+    }
+
+    // Rewrite the journal with only what is still in a trash folder
+    QSaveFile compacted(journal.fileName());
+    if (compacted.open(QIODevice::WriteOnly)) {
+        for (quint64 id : std::as_const(order)) {
+            auto it = live.constFind(id);
+            if (it == live.constEnd() || !pathExists(it->trashPath)) continue;
+            QJsonObject record{{"op", "trash"}, {"id", qint64(it->id)}, {"batch", qint64(it->batch)}, {"time", it->time},
+                               {"path", it->path}, {"trash", it->trashPath}};
+            compacted.write(QJsonDocument(record).toJson(QJsonDocument::Compact) + '\n');
+        }
+        compacted.commit();
+    }
+    journal.open(QIODevice::WriteOnly | QIODevice::Append);
+
+    for (quint64 id : std::as_const(order)) {
+        auto it = live.constFind(id);
+        if (it == live.constEnd() || !pathExists(it->trashPath)) continue;
+        if (it->trashPath == it->path) {
+            schedulePurge(*it);
+        } else {
+            entries.append(*it);
+        }
+    }
+}
+
+void DeleteQueue::appendJournal(const QString &op, const Entry &entry)
+{
+    QJsonObject record{{"op", op}, {"id", qint64(entry.id)}};
+    if (op == "trash") {
+        record.insert("batch", qint64(entry.batch));
+        record.insert("time", entry.time);
+        record.insert("path", entry.path);
+        record.insert("trash", entry.trashPath);
+    }
+    journal.write(QJsonDocument(record).toJson(QJsonDocument::Compact) + '\n');
+}
+
+void DeleteQueue::purgeExpired()
+{
+    const qint64 cutoff = QDateTime::currentMSecsSinceEpoch() - retentionMs;
+    while (!entries.isEmpty() && entries.first().time <= cutoff) {
+        schedulePurge(entries.takeFirst());
+    }
+}
+
+void DeleteQueue::schedulePurge(const Entry &entry)
+{
+    purging.insert(entry.id, entry);
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        queue.push_back(entry);
+    }
+    queueChanged.notify_one();
+}
+
+void DeleteQueue::onPurged(quint64 id)
+{
+    auto it = purging.find(id);
+    if (it == purging.end()) return;
+    appendJournal("purge", *it);
+    journal.flush();
+    purging.erase(it);
+}
+
+QString DeleteQueue::trashFolderFor(const QString &path)
+{
+#ifdef Q_OS_LINUX
+    struct stat st;
+    if (::lstat(QFile::encodeName(path).constData(), &st) != 0) {
+        return QString();
+    }
+    const quint64 device = quint64(st.st_dev);
+    auto cached = trashFolders.constFind(device);
+    if (cached != trashFolders.constEnd() && QFileInfo(*cached).isDir()) {
+        return *cached;
+    }
+
+    // The highest writable folder on the same filesystem, so the rename never
+    // crosses a mount and one trash serves the whole library
+    QString top;
+    QString folder = QFileInfo(path).absolutePath();
+    for (;;) {
+        if (::stat(QFile::encodeName(folder).constData(), &st) != 0 || quint64(st.st_dev) != device) {
+            break;
+        }
+        if (::access(QFile::encodeName(folder).constData(), W_OK) == 0) {
+            top = folder;
+        }
+        const QString parent = QFileInfo(folder).path();
+        if (parent == folder) break;
+        folder = parent;
+    }
+    if (top.isEmpty()) {
+        return QString();
+    }
+
+    const QString trash = (top.endsWith('/') ? top : top + "/") + trashFolderName;
+    if (::mkdir(QFile::encodeName(trash).constData(), 0700) != 0 && errno != EEXIST) {
+        return QString();
+    }
+    trashFolders.insert(device, trash);
+    return trash;
+#else
+    QStorageInfo storage(path);
+    if (!storage.isValid() || storage.isReadOnly()) {
+        return QString();
+    }
+    const QString trash = QDir(storage.rootPath()).filePath(trashFolderName);
+    return QDir().mkpath(trash) ? trash : QString();
+#endif
+}
+
+void DeleteQueue::runWorker()
+{
+#ifdef Q_OS_LINUX
+    // Idle I/O class: purging never competes with browsing for the disk
+    const int ioprioWhoProcess = 1;
+    const int ioprioClassIdle = 3;
+    ::syscall(SYS_ioprio_set, ioprioWhoProcess, 0, ioprioClassIdle << 13);
+#endif
+
+    for (;;) {
+        std::deque<Entry> batch;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            queueChanged.wait(lock, [this]() { return stopping || !queue.empty(); });
+            if (stopping) return;
+            batch.swap(queue);
+        }
+
+        for (const Entry &entry : batch) {
+            if (stopping) return;
+            if (removePath(entry.trashPath, stopping)) {
+                const quint64 id = entry.id;
+                QMetaObject::invokeMethod(this, [this, id]() { onPurged(id); }, Qt::QueuedConnection);
+            }
+        }
+    }
+}
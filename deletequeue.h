@@ -0,0 +1,90 @@
+#ifndef DELETEQUEUE_H
+#define DELETEQUEUE_H
+
+#include <QObject>
+#include <QFile>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QTimer>
+#include <QVector>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+// Deletes without blocking and with undo. A removed file or folder is renamed
+// into a hidden trash folder on its own filesystem, which is instant however
+// big the folder is, and recorded in a journal next to the config. Trashed
+// items stay restorable for the retention period; after that a background
+// thread unlinks them. Pending purges are replayed from the journal on start.
+// Items that cannot go into a trash are never deleted behind the caller's
+// back; removePermanently() deletes them once the caller has agreed to it.
+class DeleteQueue : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr const char *trashFolderName = ".smartrabbit-trash";
+
+    explicit DeleteQueue(const QString &journalPath, QObject *parent = nullptr);
+    ~DeleteQueue();
+
+    // Purges whatever has been in the trash longer than this
+    void setRetentionMinutes(int minutes);
+
+    // Moves path into the trash; false if it could not be removed at all
+    bool remove(const QString &path, QString *error = nullptr);
+    // Moves absolute paths into the trash as one undo step, renaming them in
+    // a single batch. Paths that could not be removed are mapped to the
+    // reason in failures. Those that could only be deleted permanently, such
+    // as on a filesystem without a writable trash, are also added to
+    // untrashable. Returns how many were removed.
+    int remove(const QStringList &paths, QHash<QString, QString> *failures = nullptr,
+               QStringList *untrashable = nullptr);
+    // Deletes paths in the background without undo. Journaled, so an
+    // interrupted delete resumes on the next start. Returns how many were queued.
+    int removePermanently(const QStringList &paths, QHash<QString, QString> *failures = nullptr);
+
+    bool canUndo() const;
+    // Moves the most recently removed items back and returns their paths. Items
+    // that could not be restored stay in the trash and are described in error.
+    QStringList undo(QString *error = nullptr);
+
+private:
+    struct Entry
+    {
+        quint64 id = 0;
+        quint64 batch = 0; // entries removed together are undone together
+        qint64 time = 0; // msecs since the epoch
+        QString path;
+        QString trashPath; // equal to path when it had to be deleted in place
+    };
+
+    bool checkRemovable(const QString &path, QHash<QString, bool> &writableFolders,
+                        QHash<QString, QString> *failures);
+    void loadJournal();
+    void appendJournal(const QString &op, const Entry &entry);
+    void purgeExpired();
+    void schedulePurge(const Entry &entry);
+    void onPurged(quint64 id);
+    QString trashFolderFor(const QString &path);
+    void runWorker();
+
+    QFile journal;
+    QVector<Entry> entries; // restorable, oldest first
+    QHash<quint64, Entry> purging;
+    quint64 nextId = 1;
+    qint64 retentionMs = 30 * 60 * 1000;
+    QTimer purgeTimer;
+    QHash<quint64, QString> trashFolders; // by device
+
+    std::mutex queueMutex;
+    std::condition_variable queueChanged;
+    std::deque<Entry> queue;
+    std::atomic<bool> stopping{false};
+    std::thread worker;
+};
+
+#endif // DELETEQUEUE_H
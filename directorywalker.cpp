@@ -0,0 +1,388 @@
+#include "directorywalker.h"
+#include "catalog.h"
+#include "fileoperations.h"
+#include <QFile>
+#include <QDir>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QThread>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef Q_OS_LINUX
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+struct WalkNode
+{
+    CatalogEntry entry;
+    bool read = false;    // queued for a worker to list
+    bool descend = false; // subfolders become nodes of their own
+    bool ready = false;   // guarded by WalkState::readyMutex
+    std::vector<std::unique_ptr<WalkNode>> children;
+};
+
+struct WorkQueue
+{
+    std::mutex mutex;
+    std::deque<WalkNode *> nodes;
+};
+
+struct WalkState
+{
+    explicit WalkState(int workers) : queues(workers) {}
+
+    bool recursive = false;
+    bool readLeaves = false;
+    bool listMedia = false;
+    MediaClassifier classifier;
+    const Catalog *catalog = nullptr;
+
+    std::vector<WorkQueue> queues;
+    std::atomic<int> outstanding{0};
+    std::atomic<bool> stop{false};
+
+    std::mutex idleMutex;
+    std::condition_variable workAvailable;
+
+    std::mutex readyMutex;
+    std::condition_variable nodeReady;
+    WalkNode *awaited = nullptr;
+};
+
+QString joinPath(const QString &dir, const QString &name)
+{
+    return dir.endsWith(QLatin1Char('/')) ? dir + name : dir + QLatin1Char('/') + name;
+}
+
+#ifdef Q_OS_LINUX
+// Content type of a listed file whose extension tells nothing
+MediaType sniffAt(int dirFd, const char *name)
+{
+    int fd = ::openat(dirFd, name, O_RDONLY | O_CLOEXEC | O_NOCTTY);
+    if (fd < 0) {
+        return MediaType::Unknown;
+    }
+    char header[MediaClassifier::sniffSize];
+    const ssize_t bytes = ::read(fd, header, sizeof(header));
+    ::close(fd);
+    return MediaClassifier::sniff(header, bytes);
+}
+#endif
+
+// Lists entry.path like QDir::entryList(QDir::Dirs | QDir::NoDotAndDotDot) and,
+// with listMedia, QDir::entryList(QDir::Files) filtered by the classifier:
+// hidden entries are skipped and symlinks are followed
+void listDirectory(CatalogEntry &entry, const WalkState &state)
+{
+#ifdef Q_OS_LINUX
+    int fd = ::openat(AT_FDCWD, QFile::encodeName(entry.path).constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+
+    // Stat before reading so any change made while listing bumps the mtime past what is recorded
+    struct stat st;
+    if (::fstat(fd, &st) == 0) {
+        entry.inode = quint64(st.st_ino);
+        entry.mtime = qint64(st.st_mtim.tv_sec) * 1000000000LL + st.st_mtim.tv_nsec;
+    }
+
+    alignas(struct dirent64) char buffer[64 * 1024];
+    for (;;) {
+        long bytes = ::syscall(SYS_getdents64, fd, buffer, sizeof(buffer));
+        if (bytes <= 0) {
+            break;
+        }
+        for (long offset = 0; offset < bytes;) {
+            auto *dirent = reinterpret_cast<struct dirent64 *>(buffer + offset);
+            offset += dirent->d_reclen;
+
+            const char *name = dirent->d_name;
+            if (name[0] == '.') {
+                continue; // ".", ".." and hidden entries
+            }
+
+            unsigned char type = dirent->d_type;
+            bool haveStat = false;
+            if (type == DT_LNK || type == DT_UNKNOWN) {
+                if (::fstatat(fd, name, &st, 0) != 0) {
+                    continue;
+                }
+                haveStat = true;
+                type = S_ISDIR(st.st_mode) ? DT_DIR : S_ISREG(st.st_mode) ? DT_REG : DT_UNKNOWN;
+            }
+
+            if (type == DT_DIR) {
+                entry.subfolders.append(QFile::decodeName(name));
+                continue;
+            }
+            if (type != DT_REG || !state.listMedia) {
+                continue;
+            }
+
+            // Names are classified as bytes, so other files cost no decoding
+            MediaType mediaType = state.classifier.classify(name, qsizetype(std::strlen(name)));
+            if (mediaType == MediaType::Unknown && state.classifier.sniffsContent()) {
+                mediaType = sniffAt(fd, name);
+            }
+            if (mediaType == MediaType::Unknown) {
+                continue;
+            }
+            if (!haveStat && ::fstatat(fd, name, &st, 0) != 0) {
+                continue;
+            }
+            CatalogMediaFile file;
+            file.name = QFile::decodeName(name);
+            file.type = mediaType;
+            file.size = qint64(st.st_size);
+            file.mtime = qint64(st.st_mtim.tv_sec) * 1000000000LL + st.st_mtim.tv_nsec;
+            entry.mediaFiles.append(file);
+        }
+    }
+    ::close(fd);
+#else
+    QDir dir(entry.path);
+    Catalog::statFolder(entry.path, entry.inode, entry.mtime);
+    entry.subfolders = dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Unsorted);
+    if (state.listMedia) {
+        const QFileInfoList files = dir.entryInfoList(QDir::Files, QDir::Unsorted);
+        for (const QFileInfo &info : files) {
+            const MediaType mediaType = state.classifier.classifyFile(info.filePath());
+            if (mediaType != MediaType::Unknown) {
+                CatalogMediaFile file;
+                file.name = info.fileName();
+                file.type = mediaType;
+                file.size = info.size();
+                file.mtime = info.lastModified().toMSecsSinceEpoch() * 1000000LL;
+                entry.mediaFiles.append(file);
+            }
+        }
+    }
+#endif
+
+    std::sort(entry.subfolders.begin(), entry.subfolders.end(), FileOperations::fileNameLessThan);
+    std::sort(entry.mediaFiles.begin(), entry.mediaFiles.end(), [](const CatalogMediaFile &a, const CatalogMediaFile &b) {
+        return FileOperations::fileNameLessThan(a.name, b.name);
+    });
+}
+
+void readEntry(CatalogEntry &entry, const WalkState &state)
+{
+    CatalogEntry cached;
+    bool haveCached = false;
+    if (state.catalog) {
+        // An unchanged folder costs one stat instead of a full listing. Its
+        // files' stats are reused too, which misses a file rewritten in place;
+        // hash and metadata stages re-stat through getCurrentMediaFileInfo()
+        quint64 inode = 0;
+        qint64 mtime = 0;
+        haveCached = state.catalog->find(entry.path, cached);
+        if (haveCached && Catalog::statFolder(entry.path, inode, mtime)
+            && cached.inode == inode && cached.mtime == mtime) {
+            entry = cached;
+            return;
+        }
+    }
+    listDirectory(entry, state);
+    if (haveCached) {
+        entry.inheritContentData(cached);
+    }
+}
+
+WalkNode *popLocal(WorkQueue &queue)
+{
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.nodes.empty()) return nullptr;
+    WalkNode *node = queue.nodes.back();
+    queue.nodes.pop_back();
+    return node;
+}
+
+WalkNode *steal(WorkQueue &queue)
+{
+    // Take from the opposite end: the oldest entries are the shallowest, largest subtrees
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.nodes.empty()) return nullptr;
+    WalkNode *node = queue.nodes.front();
+    queue.nodes.pop_front();
+    return node;
+}
+
+void expandNode(WalkState &state, int self, WalkNode *node)
+{
+    readEntry(node->entry, state);
+
+    int queued = 0;
+    if (node->descend) {
+        node->children.reserve(node->entry.subfolders.size());
+        for (const QString &name : std::as_const(node->entry.subfolders)) {
+            auto child = std::make_unique<WalkNode>();
+            child->entry.path = joinPath(node->entry.path, name);
+            child->descend = state.recursive;
+            child->read = state.recursive || state.readLeaves;
+            queued += child->read ? 1 : 0;
+            node->children.push_back(std::move(child));
+        }
+    }
+
+    if (queued > 0) {
+        state.outstanding.fetch_add(queued);
+        {
+            // Push in reverse so this worker picks up the first child next,
+            // which is also the next folder the visitor is waiting for
+            WorkQueue &queue = state.queues[self];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            for (auto it = node->children.rbegin(); it != node->children.rend(); ++it) {
+                if ((*it)->read) {
+                    queue.nodes.push_back(it->get());
+                }
+            }
+        }
+        state.workAvailable.notify_all();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(state.readyMutex);
+        node->ready = true;
+        if (state.awaited == node) {
+            state.nodeReady.notify_one();
+        }
+    }
+
+    if (state.outstanding.fetch_sub(1) == 1) {
+        state.workAvailable.notify_all();
+    }
+}
+
+void workerLoop(WalkState &state, int self)
+{
+    const int count = int(state.queues.size());
+    while (!state.stop.load(std::memory_order_relaxed)) {
+        WalkNode *node = popLocal(state.queues[self]);
+        for (int k = 1; !node && k < count; ++k) {
+            node = steal(state.queues[(self + k) % count]);
+        }
+
+        if (!node) {
+            if (state.outstanding.load() == 0) {
+                break;
+            }
+            std::unique_lock<std::mutex> lock(state.idleMutex);
+            state.workAvailable.wait_for(lock, std::chrono::milliseconds(1));
+            continue;
+        }
+
+        expandNode(state, self, node);
+    }
+}
+
+void waitUntilReady(WalkState &state, WalkNode *node)
+{
+    std::unique_lock<std::mutex> lock(state.readyMutex);
+    state.awaited = node;
+    state.nodeReady.wait(lock, [node] { return node->ready; });
+    state.awaited = nullptr;
+}
+
+} // namespace
+
+DirectoryWalker::DirectoryWalker(int threadCount)
+    : threadCount(threadCount > 0 ? threadCount : qMax(4, QThread::idealThreadCount()))
+{
+}
+
+void DirectoryWalker::setMediaExtensions(const QStringList &extensions)
+{
+    mediaExtensions = extensions;
+}
+
+void DirectoryWalker::setCatalog(const Catalog *catalog)
+{
+    this->catalog = catalog;
+}
+
+bool DirectoryWalker::walk(const QString &root, bool recursive, const Visitor &visitor,
+                           const EntryVisitor &entryVisitor)
+{
+    WalkState state(threadCount);
+    state.recursive = recursive;
+    state.readLeaves = bool(entryVisitor);
+    state.listMedia = bool(entryVisitor) && !mediaExtensions.isEmpty();
+    state.classifier = MediaClassifier(mediaExtensions);
+    // Cached entries only hold media files for the extension set they were listed with
+    if (catalog && catalog->extensionsHash() == Catalog::hashExtensions(mediaExtensions)) {
+        state.catalog = catalog;
+    }
+
+    auto rootNode = std::make_unique<WalkNode>();
+    rootNode->entry.path = QDir(root).path();
+    rootNode->read = true;
+    rootNode->descend = true;
+    state.outstanding = 1;
+    state.queues[0].nodes.push_back(rootNode.get());
+
+    std::vector<std::thread> workers;
+    workers.reserve(threadCount);
+    for (int i = 0; i < threadCount; ++i) {
+        workers.emplace_back(workerLoop, std::ref(state), i);
+    }
+
+    // Emit in pre-order as soon as each folder's parent has been read
+    struct Frame
+    {
+        WalkNode *node;
+        size_t next;
+    };
+    std::vector<Frame> stack;
+    bool completed = true;
+
+    waitUntilReady(state, rootNode.get());
+    if (entryVisitor) {
+        entryVisitor(rootNode->entry);
+    }
+    stack.push_back({rootNode.get(), 0});
+    while (!stack.empty()) {
+        Frame &frame = stack.back();
+        if (frame.next == frame.node->children.size()) {
+            // Whole subtree has been read and visited, nothing references it any more
+            frame.node->children.clear();
+            stack.pop_back();
+            continue;
+        }
+
+        WalkNode *child = frame.node->children[frame.next++].get();
+        if (!visitor(child->entry.path)) {
+            completed = false;
+            break;
+        }
+        if (child->read) {
+            waitUntilReady(state, child);
+            if (entryVisitor) {
+                entryVisitor(child->entry);
+            }
+            stack.push_back({child, 0});
+        }
+    }
+
+    state.stop = true;
+    state.workAvailable.notify_all();
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+    return completed;
+}
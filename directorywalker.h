@@ -0,0 +1,42 @@
+#ifndef DIRECTORYWALKER_H
+#define DIRECTORYWALKER_H
+
+#include <QString>
+#include <QStringList>
+#include <functional>
+
+class Catalog;
+struct CatalogEntry;
+
+// Multi-threaded directory tree walker. Directories are read in parallel by a
+// pool of workers sharing work-stealing queues; entries come from getdents64
+// and d_type, so only symlinks, DT_UNKNOWN entries and media files cost a
+// stat. Folders are still handed to the visitor on the calling thread, in the
+// same sorted pre-order the QDir based recursion produces.
+class DirectoryWalker
+{
+public:
+    using Visitor = std::function<bool(const QString &folder)>;
+    using EntryVisitor = std::function<void(const CatalogEntry &entry)>;
+
+    explicit DirectoryWalker(int threadCount = 0);
+
+    // Media files with these extensions are included in the entries
+    void setMediaExtensions(const QStringList &extensions);
+    // Entries of folders whose inode and mtime still match are taken from here
+    void setCatalog(const Catalog *catalog);
+
+    // Visits the subfolders of root (not root itself), descending only when
+    // recursive is set. If entryVisitor is given, every folder that was read
+    // (the root and all visited folders) is also reported with its listing,
+    // right after it was visited. Returns false if the visitor stopped the walk.
+    bool walk(const QString &root, bool recursive, const Visitor &visitor,
+              const EntryVisitor &entryVisitor = EntryVisitor());
+
+private:
+    int threadCount;
+    QStringList mediaExtensions;
+    const Catalog *catalog = nullptr;
+};
+
+#endif // DIRECTORYWALKER_H
@@ -0,0 +1,302 @@
+#include "duplicatefinder.h"
+#include "contenthash.h"
+#include "fileoperations.h"
+#include "parallel.h"
+#include <QElapsedTimer>
+#include <QFile>
+#include <algorithm>
+#include <map>
+
+#ifdef Q_OS_LINUX
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <unistd.h>
+#endif
+
+DuplicateFinder::DuplicateFinder(const QStringList &folders, Catalog *catalog,
+                                 const QStringList &mediaExtensions, QObject *parent)
+    : QThread(parent)
+    , folders(folders)
+    , catalog(catalog)
+    , mediaExtensions(mediaExtensions)
+{
+}
+
+QVector<DuplicateGroup> DuplicateFinder::groups() const
+{
+    return result;
+}
+
+bool DuplicateFinder::isCompleted() const
+{
+    return completed;
+}
+
+void DuplicateFinder::run()
+{
+    std::vector<Candidate> candidates = collect();
+    if (isInterruptionRequested()) return;
+
+    // Only a file that shares its size with another one can have a copy
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate &a, const Candidate &b) {
+        return a.size < b.size;
+    });
+    std::vector<Candidate *> sameSize;
+    for (size_t i = 0; i < candidates.size();) {
+        size_t j = i + 1;
+        while (j < candidates.size() && candidates[j].size == candidates[i].size) {
+            ++j;
+        }
+        if (j - i > 1) {
+            for (size_t k = i; k < j; ++k) {
+                sameSize.push_back(&candidates[k]);
+            }
+        }
+        i = j;
+    }
+
+    // Path order keeps the block reads of one folder close together
+    std::sort(sameSize.begin(), sameSize.end(), [](const Candidate *a, const Candidate *b) {
+        return a->path < b->path;
+    });
+    hashCandidates(sameSize, false, "Comparing first and last blocks");
+    if (isInterruptionRequested()) return;
+
+    // Small files were hashed whole already; the rest need a full read
+    std::vector<std::vector<Candidate *>> matches;
+    std::vector<Candidate *> unresolved;
+    for (std::vector<Candidate *> &group : groupBy(sameSize)) {
+        if (group.front()->complete) {
+            matches.push_back(std::move(group));
+        } else {
+            unresolved.insert(unresolved.end(), group.begin(), group.end());
+        }
+    }
+
+    hashCandidates(unresolved, true, "Comparing file contents");
+    if (isInterruptionRequested()) return;
+    for (std::vector<Candidate *> &group : groupBy(unresolved)) {
+        matches.push_back(std::move(group));
+    }
+
+    result.clear();
+    result.reserve(int(matches.size()));
+    for (const std::vector<Candidate *> &group : matches) {
+        DuplicateGroup duplicates;
+        duplicates.size = group.front()->size;
+        for (const Candidate *candidate : group) {
+            duplicates.paths.append(candidate->path);
+        }
+        duplicates.paths.sort();
+        result.append(duplicates);
+    }
+    std::sort(result.begin(), result.end(), [](const DuplicateGroup &a, const DuplicateGroup &b) {
+        return a.size * (a.paths.size() - 1) > b.size * (b.paths.size() - 1);
+    });
+    completed = true;
+}
+
+std::vector<DuplicateFinder::Candidate> DuplicateFinder::collect()
+{
+    FileOperations fileOperations;
+    if (catalog) {
+        fileOperations.setCatalog(catalog, mediaExtensions);
+    }
+
+    std::vector<Candidate> candidates;
+    QElapsedTimer sinceProgress;
+    sinceProgress.start();
+    for (int i = 0; i < folders.size() && !isInterruptionRequested(); ++i) {
+        const QVector<CatalogMediaFile> files = fileOperations.getMediaFileInfo(folders[i], mediaExtensions);
+        const QString prefix = folders[i].endsWith('/') ? folders[i] : folders[i] + "/";
+        for (const CatalogMediaFile &file : files) {
+            // Empty files are trivially identical and free nothing when deleted
+            if (file.size > 0) {
+                Candidate candidate;
+                candidate.path = prefix + file.name;
+                candidate.size = file.size;
+                candidates.push_back(candidate);
+            }
+        }
+        if (sinceProgress.elapsed() >= 100) {
+            emit progress("Listing files", i + 1, folders.size());
+            sinceProgress.restart();
+        }
+    }
+    return candidates;
+}
+
+void DuplicateFinder::hashCandidates(const std::vector<Candidate *> &items, bool full, const QString &stage)
+{
+    struct Lane
+    {
+        std::vector<Candidate *> items;
+        int threadCount = 1;
+    };
+
+    // One lane per device, so each disk gets the concurrency that suits it.
+    // Devices are only known after the first read, which is when it matters.
+    std::map<quint64, Lane> laneMap;
+    qint64 total = 0;
+    for (Candidate *candidate : items) {
+        laneMap[full ? candidate->device : 0].items.push_back(candidate);
+        total += full ? candidate->size : qMin(candidate->size, 2 * edgeBlockSize);
+    }
+
+    const int idealThreads = qMax(1, QThread::idealThreadCount());
+    std::vector<Lane *> lanes;
+    for (auto &it : laneMap) {
+        Lane &lane = it.second;
+        if (full) {
+            // Inode order roughly follows on-disk order; parallel streams would make a disk seek
+            std::sort(lane.items.begin(), lane.items.end(), [](const Candidate *a, const Candidate *b) {
+                return a->inode < b->inode;
+            });
+            lane.threadCount = isRotational(it.first) ? 1 : idealThreads;
+        } else {
+            // Block reads are latency bound, keep plenty of them in flight
+            lane.threadCount = qMin(idealThreads * 4, 32);
+        }
+        lanes.push_back(&lane);
+    }
+
+    // Every lane runs at once on its own threads; progress is summed over all of them
+    std::atomic<qint64> done{0};
+    auto stop = [this]() { return isInterruptionRequested(); };
+    forEachItem(qint64(lanes.size()), int(lanes.size()),
+        [&](qint64 laneIndex) {
+            const Lane &lane = *lanes[size_t(laneIndex)];
+            forEachItem(qint64(lane.items.size()), lane.threadCount,
+                [&](qint64 index) {
+                    thread_local std::vector<char> buffer;
+                    buffer.resize(size_t(full ? readChunkSize : edgeBlockSize));
+                    Candidate &candidate = *lane.items[size_t(index)];
+                    candidate.failed = !hashCandidate(candidate, full, buffer, done);
+                },
+                stop, [](qint64) {});
+        },
+        stop, [&](qint64) { emit progress(stage, done, total); });
+}
+
+bool DuplicateFinder::hashCandidate(Candidate &candidate, bool full, std::vector<char> &buffer, std::atomic<qint64> &done)
+{
+    // Files no larger than the two edge blocks are read whole right away
+    const bool whole = full || candidate.size <= 2 * edgeBlockSize;
+
+#ifdef Q_OS_LINUX
+    int fd = ::open(QFile::encodeName(candidate.path).constData(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || st.st_size != candidate.size) {
+        ::close(fd);
+        return false;
+    }
+    candidate.device = st.st_dev;
+    candidate.inode = st.st_ino;
+    ::posix_fadvise(fd, 0, 0, whole ? POSIX_FADV_SEQUENTIAL : POSIX_FADV_RANDOM);
+
+    auto readAt = [fd](char *data, qint64 length, qint64 offset) -> qint64 {
+        ssize_t n;
+        do {
+            n = ::pread(fd, data, size_t(length), offset);
+        } while (n < 0 && errno == EINTR);
+        return n;
+    };
+#else
+    QFile file(candidate.path);
+    if (!file.open(QIODevice::ReadOnly) || file.size() != candidate.size) {
+        return false;
+    }
+
+    auto readAt = [&file](char *data, qint64 length, qint64 offset) -> qint64 {
+        return file.seek(offset) ? file.read(data, length) : -1;
+    };
+#endif
+
+    ContentHash hash;
+    auto hashRange = [&](qint64 offset, qint64 length) {
+        while (length > 0) {
+            if (isInterruptionRequested()) return false;
+            qint64 n = readAt(buffer.data(), qMin<qint64>(length, qint64(buffer.size())), offset);
+            if (n <= 0) return false;
+            hash.update(buffer.data(), n);
+            offset += n;
+            length -= n;
+            done += n;
+        }
+        return true;
+    };
+
+    bool ok = whole ? hashRange(0, candidate.size)
+                    : hashRange(0, edgeBlockSize) && hashRange(candidate.size - edgeBlockSize, edgeBlockSize);
+
+#ifdef Q_OS_LINUX
+    if (full) {
+        // The library is far bigger than memory; don't push everything else out of the page cache
+        ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    }
+    ::close(fd);
+#endif
+
+    candidate.hash = hash.digest();
+    candidate.complete = whole;
+    return ok;
+}
+
+std::vector<std::vector<DuplicateFinder::Candidate *>> DuplicateFinder::groupBy(const std::vector<Candidate *> &items)
+{
+    std::vector<Candidate *> sorted;
+    sorted.reserve(items.size());
+    for (Candidate *candidate : items) {
+        if (!candidate->failed) {
+            sorted.push_back(candidate);
+        }
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const Candidate *a, const Candidate *b) {
+        if (a->size != b->size) return a->size < b->size;
+        if (a->hash != b->hash) return a->hash < b->hash;
+        if (a->device != b->device) return a->device < b->device;
+        if (a->inode != b->inode) return a->inode < b->inode;
+        return a->path < b->path;
+    });
+
+    std::vector<std::vector<Candidate *>> groups;
+    for (size_t i = 0; i < sorted.size();) {
+        std::vector<Candidate *> group;
+        size_t j = i;
+        for (; j < sorted.size() && sorted[j]->size == sorted[i]->size && sorted[j]->hash == sorted[i]->hash; ++j) {
+            // Hard links share one copy of the data, deleting one frees nothing
+            const Candidate *last = group.empty() ? nullptr : group.back();
+            if (last && sorted[j]->inode != 0 && sorted[j]->inode == last->inode && sorted[j]->device == last->device) {
+                continue;
+            }
+            group.push_back(sorted[j]);
+        }
+        if (group.size() > 1) {
+            groups.push_back(std::move(group));
+        }
+        i = j;
+    }
+    return groups;
+}
+
+bool DuplicateFinder::isRotational(quint64 device)
+{
+#ifdef Q_OS_LINUX
+    // Partitions keep their queue attributes on the parent disk
+    const QString base = QString("/sys/dev/block/%1:%2/").arg(major(device)).arg(minor(device));
+    for (const QString &path : {base + "queue/rotational", base + "../queue/rotational"}) {
+        QFile file(path);
+        if (file.open(QIODevice::ReadOnly)) {
+            return file.readAll().trimmed() == "1";
+        }
+    }
+#else
+    Q_UNUSED(device);
+#endif
+    return false;
+}
@@ -0,0 +1,72 @@
+#ifndef DUPLICATEFINDER_H
+#define DUPLICATEFINDER_H
+
+#include <QThread>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <atomic>
+#include <vector>
+
+class Catalog;
+
+// Files with byte-identical content; paths are sorted
+struct DuplicateGroup
+{
+    qint64 size = 0;
+    QStringList paths;
+};
+
+// Finds byte-identical media files among the scanned folders on a worker
+// thread. Candidates are narrowed in stages so most files are never read:
+// equal size, then a hash of the first and last block, then a hash of the
+// whole content. Reads run in parallel per device, one stream at a time on
+// rotational disks. Cancel with requestInterruption().
+class DuplicateFinder : public QThread
+{
+    Q_OBJECT
+
+public:
+    DuplicateFinder(const QStringList &folders, Catalog *catalog,
+                    const QStringList &mediaExtensions, QObject *parent = nullptr);
+
+    // Valid once the thread has finished; largest reclaimable space first
+    QVector<DuplicateGroup> groups() const;
+    // False when the search was interrupted
+    bool isCompleted() const;
+
+signals:
+    void progress(const QString &stage, qint64 done, qint64 total);
+
+protected:
+    void run() override;
+
+private:
+    struct Candidate
+    {
+        QString path;
+        qint64 size = 0;
+        quint64 device = 0;
+        quint64 inode = 0;
+        quint64 hash = 0;
+        bool complete = false; // hash already covers the whole file
+        bool failed = false;
+    };
+
+    QStringList folders;
+    Catalog *catalog;
+    QStringList mediaExtensions;
+    QVector<DuplicateGroup> result;
+    bool completed = false;
+
+    std::vector<Candidate> collect();
+    void hashCandidates(const std::vector<Candidate *> &items, bool full, const QString &stage);
+    bool hashCandidate(Candidate &candidate, bool full, std::vector<char> &buffer, std::atomic<qint64> &done);
+    static std::vector<std::vector<Candidate *>> groupBy(const std::vector<Candidate *> &items);
+    static bool isRotational(quint64 device);
+
+    static constexpr qint64 edgeBlockSize = 64 * 1024;
+    static constexpr qint64 readChunkSize = 1024 * 1024;
+};
+
+#endif // DUPLICATEFINDER_H
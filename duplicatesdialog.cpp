@@ -0,0 +1,195 @@
+#include "duplicatesdialog.h"
+#include "fileoperations.h"
+#include <QDialogButtonBox>
+#include <QFileInfo>
+#include <QHeaderView>
+#include <QLabel>
+#include <QLocale>
+#include <QMessageBox>
+#include <QPushButton>
+#include <QSet>
+#include <QTreeWidget>
+#include <QVBoxLayout>
+
+namespace {
+
+const int sizeRole = Qt::UserRole;
+
+} // namespace
+
+DuplicatesDialog::DuplicatesDialog(const QVector<DuplicateGroup> &groups, FileOperations *fileOperations,
+                                   bool confirmDelete, QWidget *parent)
+    : QDialog(parent)
+    , fileOperations(fileOperations)
+    , confirmDelete(confirmDelete)
+{
+    setWindowTitle("Duplicate Files");
+    resize(900, 600);
+
+    summary = new QLabel(this);
+    tree = new QTreeWidget(this);
+    tree->setColumnCount(2);
+    tree->setHeaderLabels({"File", "Size"});
+    tree->header()->setSectionResizeMode(0, QHeaderView::Stretch);
+    tree->header()->setSectionResizeMode(1, QHeaderView::ResizeToContents);
+    tree->header()->setStretchLastSection(false);
+
+    QDialogButtonBox *buttons = new QDialogButtonBox(QDialogButtonBox::Close, this);
+    QPushButton *selectButton = buttons->addButton("Select Duplicates", QDialogButtonBox::ActionRole);
+    QPushButton *clearButton = buttons->addButton("Clear Selection", QDialogButtonBox::ActionRole);
+    QPushButton *deleteButton = buttons->addButton("Delete Selected", QDialogButtonBox::DestructiveRole);
+    connect(selectButton, &QPushButton::clicked, this, &DuplicatesDialog::selectDuplicates);
+    connect(clearButton, &QPushButton::clicked, this, &DuplicatesDialog::clearSelection);
+    connect(deleteButton, &QPushButton::clicked, this, &DuplicatesDialog::deleteSelected);
+    connect(buttons, &QDialogButtonBox::rejected, this, &QDialog::reject);
+
+    QVBoxLayout *layout = new QVBoxLayout(this);
+    layout->addWidget(summary);
+    layout->addWidget(tree);
+    layout->addWidget(buttons);
+
+    populate(groups);
+    connect(tree, &QTreeWidget::itemChanged, this, &DuplicatesDialog::updateSummary);
+    updateSummary();
+}
+
+void DuplicatesDialog::populate(const QVector<DuplicateGroup> &groups)
+{
+    const QLocale locale;
+    for (const DuplicateGroup &group : groups) {
+        QTreeWidgetItem *groupItem = new QTreeWidgetItem(tree);
+        groupItem->setText(0, QString("%1 copies").arg(group.paths.size()));
+        groupItem->setText(1, locale.formattedDataSize(group.size));
+        groupItem->setData(0, sizeRole, group.size);
+        groupItem->setFlags(Qt::ItemIsEnabled);
+
+        for (const QString &path : group.paths) {
+            QTreeWidgetItem *fileItem = new QTreeWidgetItem(groupItem);
+            fileItem->setText(0, path);
+            fileItem->setToolTip(0, path);
+            fileItem->setFlags(Qt::ItemIsEnabled | Qt::ItemIsUserCheckable);
+            fileItem->setCheckState(0, Qt::Unchecked);
+        }
+        groupItem->setExpanded(true);
+    }
+}
+
+void DuplicatesDialog::updateSummary()
+{
+    const QLocale locale;
+    qint64 reclaimable = 0;
+    qint64 selectedBytes = 0;
+    int selected = 0;
+    for (int i = 0; i < tree->topLevelItemCount(); ++i) {
+        QTreeWidgetItem *groupItem = tree->topLevelItem(i);
+        const qint64 size = groupItem->data(0, sizeRole).toLongLong();
+        reclaimable += size * (groupItem->childCount() - 1);
+        for (int j = 0; j < groupItem->childCount(); ++j) {
+            if (groupItem->child(j)->checkState(0) == Qt::Checked) {
+                ++selected;
+                selectedBytes += size;
+            }
+        }
+    }
+
+    summary->setText(QString("%1 groups of identical files, %2 reclaimable. %3 selected (%4).")
+                         .arg(tree->topLevelItemCount())
+                         .arg(locale.formattedDataSize(reclaimable))
+                         .arg(selected)
+                         .arg(locale.formattedDataSize(selectedBytes)));
+}
+
+void DuplicatesDialog::selectDuplicates()
+{
+    // Keep the first copy of every group
+    for (int i = 0; i < tree->topLevelItemCount(); ++i) {
+        QTreeWidgetItem *groupItem = tree->topLevelItem(i);
+        for (int j = 0; j < groupItem->childCount(); ++j) {
+            groupItem->child(j)->setCheckState(0, j == 0 ? Qt::Unchecked : Qt::Checked);
+        }
+    }
+}
+
+void DuplicatesDialog::clearSelection()
+{
+    for (int i = 0; i < tree->topLevelItemCount(); ++i) {
+        QTreeWidgetItem *groupItem = tree->topLevelItem(i);
+        for (int j = 0; j < groupItem->childCount(); ++j) {
+            groupItem->child(j)->setCheckState(0, Qt::Unchecked);
+        }
+    }
+}
+
+void DuplicatesDialog::deleteSelected()
+{
+    QList<QTreeWidgetItem *> selected;
+    int groupsLosingEveryCopy = 0;
+    for (int i = 0; i < tree->topLevelItemCount(); ++i) {
+        QTreeWidgetItem *groupItem = tree->topLevelItem(i);
+        int checked = 0;
+        for (int j = 0; j < groupItem->childCount(); ++j) {
+            if (groupItem->child(j)->checkState(0) == Qt::Checked) {
+                selected.append(groupItem->child(j));
+                ++checked;
+            }
+        }
+        if (checked == groupItem->childCount()) {
+            ++groupsLosingEveryCopy;
+        }
+    }
+    if (selected.isEmpty()) return;
+
+    // Deleting every copy is never what duplicate removal is for, so always ask
+    if (groupsLosingEveryCopy > 0) {
+        QMessageBox::StandardButton reply = QMessageBox::warning(this, "Delete Duplicates",
+                                                                 QString("Every copy is selected in %1 group(s); those files will be gone entirely. Continue?").arg(groupsLosingEveryCopy),
+                                                                 QMessageBox::Yes | QMessageBox::No, QMessageBox::No);
+        if (reply != QMessageBox::Yes) return;
+    } else if (confirmDelete) {
+        QMessageBox::StandardButton reply = QMessageBox::question(this, "Delete Duplicates",
+                                                                  QString("Delete %1 selected files?").arg(selected.size()),
+                                                                  QMessageBox::Yes | QMessageBox::No, QMessageBox::No);
+        if (reply != QMessageBox::Yes) return;
+    }
+
+    QStringList paths;
+    for (QTreeWidgetItem *fileItem : std::as_const(selected)) {
+        paths.append(fileItem->text(0));
+    }
+    const QHash<QString, QString> failed = fileOperations->deletePaths(paths);
+
+    QSet<QString> changedFolders;
+    QStringList failures;
+    tree->blockSignals(true);
+    for (QTreeWidgetItem *fileItem : std::as_const(selected)) {
+        const QString path = fileItem->text(0);
+        auto it = failed.constFind(path);
+        if (it == failed.constEnd()) {
+            changedFolders.insert(QFileInfo(path).path());
+            delete fileItem;
+        } else {
+            failures.append(QString("%1: %2").arg(path, it.value()));
+        }
+    }
+
+    // A group with a single file left has no duplicates any more
+    for (int i = tree->topLevelItemCount() - 1; i >= 0; --i) {
+        QTreeWidgetItem *groupItem = tree->topLevelItem(i);
+        if (groupItem->childCount() < 2) {
+            delete groupItem;
+        } else {
+            groupItem->setText(0, QString("%1 copies").arg(groupItem->childCount()));
+        }
+    }
+    tree->blockSignals(false);
+    updateSummary();
+
+    if (!changedFolders.isEmpty()) {
+        emit filesDeleted(QStringList(changedFolders.begin(), changedFolders.end()));
+    }
+    if (!failures.isEmpty()) {
+        QMessageBox::critical(this, "Error", QString("Failed to delete %1 file(s):\n%2")
+                                                 .arg(failures.size())
+                                                 .arg(failures.mid(0, 10).join("\n")));
+    }
+}
@@ -0,0 +1,41 @@
+#ifndef DUPLICATESDIALOG_H
+#define DUPLICATESDIALOG_H
+
+#include <QDialog>
+#include <QStringList>
+#include <QVector>
+#include "duplicatefinder.h"
+
+class FileOperations;
+class QLabel;
+class QTreeWidget;
+class QTreeWidgetItem;
+
+// Lists duplicate groups for review. Checked files are deleted through
+// FileOperations::deleteFile(); the folders that lost files are reported
+// with filesDeleted() so open views can refresh.
+class DuplicatesDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    DuplicatesDialog(const QVector<DuplicateGroup> &groups, FileOperations *fileOperations,
+                     bool confirmDelete, QWidget *parent = nullptr);
+
+signals:
+    void filesDeleted(const QStringList &folders);
+
+private:
+    QTreeWidget *tree;
+    QLabel *summary;
+    FileOperations *fileOperations;
+    bool confirmDelete;
+
+    void populate(const QVector<DuplicateGroup> &groups);
+    void updateSummary();
+    void selectDuplicates();
+    void clearSelection();
+    void deleteSelected();
+};
+
+#endif // DUPLICATESDIALOG_H
@@ -1,83 +1,292 @@
 #include "fileoperations.h"
+#include "directorywalker.h"
+#include "catalog.h"
+#include "deletequeue.h"
+#include "batchfileops.h"
+#include "logging.h"
+#include "tracer.h"
 #include <QDir>
 #include <QFileInfo>
+#include <QDateTime>
 #include <QProcess>
 #include <QDesktopServices>
 #include <QUrl>
-#include <QDebug> // Add for debugging
+#include <cerrno>
 
 FileOperations::FileOperations()
 {
 }
 
+void FileOperations::setCatalog(Catalog *catalog, const QStringList &mediaExtensions)
+{
+    this->catalog = catalog;
+    catalogExtensions = mediaExtensions;
+}
+
+void FileOperations::setDeleteQueue(DeleteQueue *deleteQueue)
+{
+    this->deleteQueue = deleteQueue;
+}
+
 QStringList FileOperations::scanFolders(const QString &mainFolder, bool recursive)
 {
     QStringList folders;
+    scanFolders(mainFolder, recursive, [&folders](const QString &folder) {
+        folders.append(folder);
+        return true;
+    });
+    return folders;
+}
+
+bool FileOperations::scanFolders(const QString &mainFolder, bool recursive, const FolderVisitor &folderVisitor,
+                                 const EntryVisitor &entryVisitor)
+{
+    TraceSpan span("scan", "files");
+    const FolderVisitor visitor = [&folderVisitor](const QString &folder) {
+        Tracer::count(TraceCounter::FoldersScanned);
+        return folderVisitor(folder);
+    };
 
     // Always include the main folder itself when recursive is enabled
-    if (recursive) {
-        folders.append(mainFolder); // Add the main folder
+    if (recursive && !visitor(mainFolder)) {
+        return false;
     }
 
-    if (!recursive) {
-        QDir dir(mainFolder);
-        QStringList entries = dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot);
-        for (const QString &entry : entries) {
-            folders.append(dir.filePath(entry));
+#ifdef Q_OS_LINUX
+    DirectoryWalker walker;
+    if (!catalog) {
+        return walker.walk(mainFolder, recursive, visitor);
+    }
+
+    // Unchanged folders come straight from the previous catalog; the new one
+    // only replaces it once the whole tree has been walked
+    CatalogBuilder builder(QDir(mainFolder).path(), recursive, Catalog::hashExtensions(catalogExtensions));
+    walker.setMediaExtensions(catalogExtensions);
+    walker.setCatalog(catalog);
+    bool completed = walker.walk(mainFolder, recursive, visitor, [&builder, &entryVisitor](const CatalogEntry &entry) {
+        builder.add(entry);
+        if (entryVisitor) {
+            entryVisitor(entry);
         }
-    } else {
-        scanFoldersRecursive(mainFolder, folders);
+    });
+    if (completed) {
+        catalog->store(builder);
+    }
+    return completed;
+#else
+    if (recursive) {
+        return scanFoldersRecursive(mainFolder, visitor);
     }
 
-    return folders;
+    QDir dir(mainFolder);
+    QStringList entries = dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+    for (const QString &entry : entries) {
+        if (!visitor(dir.filePath(entry))) {
+            return false;
+        }
+    }
+    return true;
+#endif
 }
 
-void FileOperations::scanFoldersRecursive(const QString &folderPath, QStringList &folders)
+bool FileOperations::scanFoldersRecursive(const QString &folderPath, const FolderVisitor &visitor)
 {
     QDir dir(folderPath);
     QStringList entries = dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot);
 
     for (const QString &entry : entries) {
         QString fullPath = dir.filePath(entry);
-        folders.append(fullPath);
-        scanFoldersRecursive(fullPath, folders);
+        if (!visitor(fullPath) || !scanFoldersRecursive(fullPath, visitor)) {
+            return false;
+        }
     }
+    return true;
 }
 
 QStringList FileOperations::getMediaFiles(const QString &folderPath, const QStringList &extensions)
 {
+    TraceSpan span("list", "files");
+    if (catalog && catalog->extensionsHash() == Catalog::hashExtensions(extensions)) {
+        CatalogEntry entry;
+        if (catalog->find(QDir(folderPath).path(), entry) && Catalog::isCurrent(entry)) {
+            const QStringList mediaFiles = entry.mediaFileNames();
+            Tracer::count(TraceCounter::FilesListed, mediaFiles.size());
+            qCDebug(lcFiles) << "Listed" << mediaFiles.size() << "media files in" << folderPath << "from the catalog";
+            return mediaFiles;
+        }
+    }
+
     QDir dir(folderPath);
     QStringList files = dir.entryList(QDir::Files);
     QStringList mediaFiles;
 
-    qDebug() << "Scanning folder:" << folderPath;
-    qDebug() << "Files found:" << files;
-    qDebug() << "Looking for extensions:" << extensions;
-
+    const MediaClassifier classifier(extensions);
     for (const QString &file : files) {
-        QString ext = "." + QFileInfo(file).suffix().toLower();
-        if (extensions.contains(ext)) {
-            qDebug() << "Found media file:" << file << "with extension:" << ext;
+        if (classifier.classify(file) != MediaType::Unknown
+            || (classifier.sniffsContent() && MediaClassifier::sniffFile(dir.filePath(file)) != MediaType::Unknown)) {
             mediaFiles.append(file);
         }
     }
 
-    qDebug() << "Media files found:" << mediaFiles;
+    Tracer::count(TraceCounter::FilesListed, mediaFiles.size());
+    qCDebug(lcFiles) << "Listed" << mediaFiles.size() << "media files among" << files.size() << "files in" << folderPath;
     return mediaFiles;
 }
 
+QVector<CatalogMediaFile> FileOperations::getMediaFileInfo(const QString &folderPath, const QStringList &extensions)
+{
+    if (catalog && catalog->extensionsHash() == Catalog::hashExtensions(extensions)) {
+        CatalogEntry entry;
+        if (catalog->find(QDir(folderPath).path(), entry) && Catalog::isCurrent(entry)) {
+            return entry.mediaFiles;
+        }
+    }
+
+    QVector<CatalogMediaFile> mediaFiles;
+    const MediaClassifier classifier(extensions);
+    const QFileInfoList files = QDir(folderPath).entryInfoList(QDir::Files);
+    for (const QFileInfo &info : files) {
+        const MediaType type = classifier.classifyFile(info.filePath());
+        if (type != MediaType::Unknown) {
+            mediaFiles.append({info.fileName(), info.size(), info.lastModified().toMSecsSinceEpoch() * 1000000LL, type});
+        }
+    }
+    return mediaFiles;
+}
+
+QVector<CatalogMediaFile> FileOperations::getCurrentMediaFileInfo(const QString &folderPath,
+                                                                  const QStringList &extensions)
+{
+    QVector<CatalogMediaFile> mediaFiles = getMediaFileInfo(folderPath, extensions);
+    const QString prefix = folderPath.endsWith('/') ? folderPath : folderPath + "/";
+
+    // A folder can hold thousands of files; stat them as one batch
+    QVector<FileOp> stats;
+    stats.reserve(mediaFiles.size());
+    for (const CatalogMediaFile &file : std::as_const(mediaFiles)) {
+        stats.append(BatchFileOps::stat(prefix + file.name));
+    }
+    BatchFileOps::run(stats);
+
+    QVector<CatalogMediaFile> current;
+    current.reserve(mediaFiles.size());
+    for (int i = 0; i < mediaFiles.size(); ++i) {
+        CatalogMediaFile &file = mediaFiles[i];
+        const FileOp &stat = stats[i];
+        if (stat.error != 0 || !stat.isFile) continue;
+        if (stat.size != file.size || stat.mtime != file.mtime) {
+            file.size = stat.size;
+            file.mtime = stat.mtime;
+            file.hasPerceptualHash = false;
+            file.hasMetadata = false;
+            file.metadata = MediaMetadata();
+        }
+        current.append(file);
+    }
+    return current;
+}
+
 bool FileOperations::deleteFile(const QString &filePath)
 {
-    return QFile::remove(filePath);
+    TraceSpan span("delete", "files");
+    bool deleted = deleteQueue ? deleteQueue->remove(filePath) : QFile::remove(filePath);
+    if (deleted) {
+        Tracer::count(TraceCounter::FilesDeleted);
+    }
+    return deleted;
 }
 
 bool FileOperations::deleteFolder(const QString &folderPath)
 {
+    if (deleteQueue) {
+        return deleteQueue->remove(folderPath);
+    }
     QDir dir(folderPath);
     return dir.removeRecursively();
 }
 
+QHash<QString, QString> FileOperations::deletePaths(const QStringList &paths, QStringList *untrashable)
+{
+    TraceSpan span("delete", "files");
+    QHash<QString, QString> failures;
+    if (deleteQueue) {
+        deleteQueue->remove(paths, &failures, untrashable);
+        Tracer::count(TraceCounter::FilesDeleted, paths.size() - failures.size());
+        return failures;
+    }
+
+    QVector<FileOp> unlinks;
+    for (const QString &path : paths) {
+        unlinks.append(BatchFileOps::unlink(path));
+    }
+    BatchFileOps::run(unlinks);
+
+    // Unlinking a folder fails; those are removed with their contents
+    for (int i = 0; i < paths.size(); ++i) {
+        if (unlinks[i].error == 0) continue;
+        QFileInfo info(paths[i]);
+        if (info.isDir() && !info.isSymLink()) {
+            if (!QDir(paths[i]).removeRecursively()) {
+                failures.insert(paths[i], "Could not remove all contents");
+            }
+        } else {
+            failures.insert(paths[i], BatchFileOps::errorString(unlinks[i].error));
+        }
+    }
+    Tracer::count(TraceCounter::FilesDeleted, paths.size() - failures.size());
+    return failures;
+}
+
+QHash<QString, QString> FileOperations::deletePathsPermanently(const QStringList &paths)
+{
+    if (!deleteQueue) {
+        return deletePaths(paths);
+    }
+    TraceSpan span("delete", "files");
+    QHash<QString, QString> failures;
+    deleteQueue->removePermanently(paths, &failures);
+    Tracer::count(TraceCounter::FilesDeleted, paths.size() - failures.size());
+    return failures;
+}
+
+QHash<QString, QString> FileOperations::movePaths(const QStringList &paths, const QString &targetFolder)
+{
+    QHash<QString, QString> failures;
+    const QString target = QDir(targetFolder).absolutePath();
+    QStringList moving;
+    QVector<FileOp> renames;
+    for (const QString &path : paths) {
+        const QString absolute = QFileInfo(path).absoluteFilePath();
+        if (target == absolute || target.startsWith(absolute + "/")) {
+            failures.insert(path, "Cannot move a folder into itself");
+            continue;
+        }
+        moving.append(path);
+        renames.append(BatchFileOps::rename(path, target + "/" + QFileInfo(path).fileName()));
+    }
+    BatchFileOps::run(renames);
+
+    for (int i = 0; i < moving.size(); ++i) {
+        const int error = renames[i].error;
+        if (error == EXDEV) {
+            failures.insert(moving[i], "Target is on another file system");
+        } else if (error != 0) {
+            failures.insert(moving[i], BatchFileOps::errorString(error));
+        }
+    }
+    return failures;
+}
+
 bool FileOperations::openFile(const QString &filePath)
 {
     return QDesktopServices::openUrl(QUrl::fromLocalFile(filePath));
 }
+
+bool FileOperations::fileNameLessThan(const QString &a, const QString &b)
+{
+    int r = a.compare(b, Qt::CaseInsensitive);
+    if (r == 0) {
+        r = a.compare(b, Qt::CaseSensitive);
+    }
+    return r < 0;
+}
@@ -1,22 +1,61 @@
 #ifndef FILEOPERATIONS_H
 #define FILEOPERATIONS_H
 
+#include <QHash>
 #include <QString>
 #include <QStringList>
+#include <QVector>
+#include <functional>
+#include "catalog.h"
+
+class DeleteQueue;
 
 class FileOperations
 {
 public:
+    // Called once per discovered folder; return false to stop the scan early
+    using FolderVisitor = std::function<bool(const QString &folder)>;
+    // Called with the listing of each folder the catalog scan read or reused
+    using EntryVisitor = std::function<void(const CatalogEntry &entry)>;
+
     FileOperations();
 
+    // Scans record into and list from this catalog (not owned)
+    void setCatalog(Catalog *catalog, const QStringList &mediaExtensions);
+    // Deletes go through this queue, making them instant and undoable (not owned)
+    void setDeleteQueue(DeleteQueue *deleteQueue);
+
     QStringList scanFolders(const QString &mainFolder, bool recursive = false);
+    bool scanFolders(const QString &mainFolder, bool recursive, const FolderVisitor &folderVisitor,
+                     const EntryVisitor &entryVisitor = EntryVisitor());
     QStringList getMediaFiles(const QString &folderPath, const QStringList &extensions);
+    // Same files as getMediaFiles() along with their size and mtime
+    QVector<CatalogMediaFile> getMediaFileInfo(const QString &folderPath, const QStringList &extensions);
+    // getMediaFileInfo() with every file stat'ed again. A file rewritten in
+    // place leaves its folder's mtime alone, so the catalog keeps its old
+    // size, mtime, hashes and metadata; here it gets fresh stats and loses
+    // the rest. For stages that trust per-file results.
+    QVector<CatalogMediaFile> getCurrentMediaFileInfo(const QString &folderPath, const QStringList &extensions);
     bool deleteFile(const QString &filePath);
     bool deleteFolder(const QString &folderPath);
+    // Batch versions for many selected files and folders. Each returns the
+    // paths that failed, mapped to the reason; all others were done. Paths
+    // the delete queue could only delete permanently are also added to
+    // untrashable; deletePathsPermanently() removes them without undo.
+    QHash<QString, QString> deletePaths(const QStringList &paths, QStringList *untrashable = nullptr);
+    QHash<QString, QString> deletePathsPermanently(const QStringList &paths);
+    QHash<QString, QString> movePaths(const QStringList &paths, const QString &targetFolder);
     bool openFile(const QString &filePath);
 
+    // Sort order of QDir::Name | QDir::IgnoreCase, which all listings use
+    static bool fileNameLessThan(const QString &a, const QString &b);
+
 private:
-    void scanFoldersRecursive(const QString &folderPath, QStringList &folders);
+    Catalog *catalog = nullptr;
+    QStringList catalogExtensions;
+    DeleteQueue *deleteQueue = nullptr;
+
+    bool scanFoldersRecursive(const QString &folderPath, const FolderVisitor &visitor);
 };
 
 #endif // FILEOPERATIONS_H
@@ -0,0 +1,190 @@
+#include "fixturegenerator.h"
+#include <QBuffer>
+#include <QDir>
+#include <QFile>
+#include <QImage>
+#include <QImageWriter>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <algorithm>
+
+namespace {
+
+const char *specFileName = ".smartrabbit-fixture.json";
+
+quint64 fnv1a(const QByteArray &data)
+{
+    quint64 hash = 14695981039346656037ULL;
+    for (char c : data) {
+        hash = (hash ^ quint8(c)) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+// splitmix64: tiny, and identical on every platform and standard library
+quint64 nextRandom(quint64 &state)
+{
+    quint64 z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Smooth gradients with a few flat blocks: compresses like a photo rather
+// than like noise, and every variant looks different to the perceptual hash
+QImage renderImage(const QSize &size, quint64 seed)
+{
+    quint64 state = seed;
+    const int r0 = int(nextRandom(state) % 256);
+    const int g0 = int(nextRandom(state) % 256);
+    const int b0 = int(nextRandom(state) % 256);
+    const int width = size.width();
+    const int height = size.height();
+
+    QImage image(size, QImage::Format_RGB32);
+    for (int y = 0; y < height; ++y) {
+        QRgb *line = reinterpret_cast<QRgb *>(image.scanLine(y));
+        const int gy = y * 255 / qMax(1, height - 1);
+        for (int x = 0; x < width; ++x) {
+            const int gx = x * 255 / qMax(1, width - 1);
+            line[x] = qRgb((r0 + gx) & 255, (g0 + gy) & 255, (b0 + (gx ^ gy)) & 255);
+        }
+    }
+
+    for (int block = 0; block < 6; ++block) {
+        const int w = int(nextRandom(state) % quint64(qMax(1, width / 3))) + 1;
+        const int h = int(nextRandom(state) % quint64(qMax(1, height / 3))) + 1;
+        const int left = int(nextRandom(state) % quint64(width - w + 1));
+        const int top = int(nextRandom(state) % quint64(height - h + 1));
+        const QRgb color = qRgb(int(nextRandom(state) % 256), int(nextRandom(state) % 256), int(nextRandom(state) % 256));
+        for (int y = top; y < top + h; ++y) {
+            QRgb *line = reinterpret_cast<QRgb *>(image.scanLine(y));
+            std::fill(line + left, line + left + w, color);
+        }
+    }
+    return image;
+}
+
+} // namespace
+
+QJsonObject FixtureSpec::toJson() const
+{
+    QJsonArray sizes;
+    for (const QSize &size : imageSizes) {
+        sizes.append(QString("%1x%2").arg(size.width()).arg(size.height()));
+    }
+    return QJsonObject{{"depth", depth}, {"fanout", fanout}, {"files_per_folder", filesPerFolder},
+                       {"seed", QString::number(seed)}, {"image_sizes", sizes},
+                       {"formats", QJsonArray::fromStringList(formats)}, {"variants", variants}};
+}
+
+FixtureGenerator::FixtureGenerator(const FixtureSpec &spec)
+    : spec(spec)
+{
+}
+
+QStringList FixtureGenerator::writtenFormats() const
+{
+    const QList<QByteArray> supported = QImageWriter::supportedImageFormats();
+    QStringList formats;
+    for (const QString &format : spec.formats) {
+        if (supported.contains(format.toLatin1()) || (format == "jpg" && supported.contains("jpeg"))) {
+            formats.append(format);
+        }
+    }
+    return formats;
+}
+
+bool FixtureGenerator::generate(const QString &root, QString *error)
+{
+    folders = 0;
+    files = 0;
+    bytes = 0;
+
+    QDir dir(root);
+    QFile specFile(dir.filePath(specFileName));
+    if (dir.exists() && !dir.isEmpty(QDir::AllEntries | QDir::NoDotAndDotDot | QDir::Hidden)) {
+        const QJsonObject previous = specFile.open(QIODevice::ReadOnly)
+                                         ? QJsonDocument::fromJson(specFile.readAll()).object()
+                                         : QJsonObject();
+        if (previous.value("spec").toObject() == spec.toJson()) {
+            folders = previous.value("folders").toInt();
+            files = previous.value("files").toInteger();
+            bytes = previous.value("bytes").toInteger();
+            return true;
+        }
+        if (error) *error = QString("%1 is not empty and holds no fixture of this spec").arg(root);
+        return false;
+    }
+    if (!QDir().mkpath(root)) {
+        if (error) *error = QString("Could not create %1").arg(root);
+        return false;
+    }
+
+    quint64 state = spec.seed;
+    if (!generateFolder(dir.absolutePath(), 0, state, error)) {
+        return false;
+    }
+
+    // Written last, so an interrupted run is never mistaken for a complete tree
+    const QByteArray specJson = QJsonDocument(QJsonObject{{"spec", spec.toJson()}, {"folders", folders},
+                                                          {"files", files}, {"bytes", bytes}}).toJson();
+    if (!specFile.open(QIODevice::WriteOnly) || specFile.write(specJson) != specJson.size()) {
+        if (error) *error = QString("Could not write %1").arg(specFile.fileName());
+        return false;
+    }
+    return true;
+}
+
+bool FixtureGenerator::generateFolder(const QString &path, int level, quint64 &state, QString *error)
+{
+    ++folders;
+    const QStringList formats = writtenFormats();
+    if (formats.isEmpty() || spec.imageSizes.isEmpty()) {
+        if (error) *error = "None of the requested image formats can be written";
+        return false;
+    }
+
+    for (int i = 0; i < spec.filesPerFolder; ++i) {
+        const QString format = formats[int(nextRandom(state) % quint64(formats.size()))];
+        const QSize size = spec.imageSizes[int(nextRandom(state) % quint64(spec.imageSizes.size()))];
+        const int variant = int(nextRandom(state) % quint64(qMax(1, spec.variants)));
+        const QByteArray &data = image(format, size, variant);
+
+        QFile file(QString("%1/img_%2.%3").arg(path).arg(i, 5, 10, QChar('0')).arg(format));
+        if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size()) {
+            if (error) *error = QString("Could not write %1").arg(file.fileName());
+            return false;
+        }
+        ++files;
+        bytes += data.size();
+    }
+
+    if (level == spec.depth) {
+        return true;
+    }
+    for (int i = 0; i < spec.fanout; ++i) {
+        const QString child = QString("%1/folder_%2_%3").arg(path).arg(level + 1).arg(i, 3, 10, QChar('0'));
+        if (!QDir().mkdir(child) || !generateFolder(child, level + 1, state, error)) {
+            if (error && error->isEmpty()) *error = QString("Could not create %1").arg(child);
+            return false;
+        }
+    }
+    return true;
+}
+
+const QByteArray &FixtureGenerator::image(const QString &format, const QSize &size, int variant)
+{
+    const QString key = QString("%1/%2x%3/%4").arg(format).arg(size.width()).arg(size.height()).arg(variant);
+    auto it = encoded.find(key);
+    if (it != encoded.end()) {
+        return *it;
+    }
+
+    const quint64 seed = spec.seed ^ fnv1a(key.toUtf8());
+    QByteArray data;
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::WriteOnly);
+    renderImage(size, seed).save(&buffer, format.toLatin1().constData(), 85);
+    return *encoded.insert(key, data);
+}
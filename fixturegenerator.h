@@ -0,0 +1,55 @@
+#ifndef FIXTUREGENERATOR_H
+#define FIXTUREGENERATOR_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QJsonObject>
+#include <QList>
+#include <QSize>
+#include <QString>
+#include <QStringList>
+
+struct FixtureSpec
+{
+    int depth = 3;           // folder levels below the root
+    int fanout = 4;          // subfolders per folder
+    int filesPerFolder = 20; // media files in every folder, the root included
+    quint64 seed = 1;
+    QList<QSize> imageSizes = {QSize(640, 480), QSize(1920, 1080), QSize(4000, 3000)};
+    QStringList formats = {"jpg", "png", "webp"};
+    int variants = 4; // distinct images per format and size; files reuse them
+
+    QJsonObject toJson() const;
+};
+
+// Builds a synthetic media library for benchmarks. The same spec always
+// produces the same tree and the same bytes, so runs on different machines
+// or releases measure the same work. Images are encoded once per variant and
+// then written out as often as needed, so even large trees generate quickly.
+class FixtureGenerator
+{
+public:
+    explicit FixtureGenerator(const FixtureSpec &spec);
+
+    // Builds the tree under root, which must be empty or missing. A root that
+    // holds a tree from the same spec is reused as it is.
+    bool generate(const QString &root, QString *error = nullptr);
+
+    int folderCount() const { return folders; }
+    qint64 fileCount() const { return files; }
+    qint64 byteCount() const { return bytes; }
+    // The requested formats this Qt build can write
+    QStringList writtenFormats() const;
+
+private:
+    FixtureSpec spec;
+    QHash<QString, QByteArray> encoded;
+    int folders = 0;
+    qint64 files = 0;
+    qint64 bytes = 0;
+
+    bool generateFolder(const QString &path, int level, quint64 &state, QString *error);
+    const QByteArray &image(const QString &format, const QSize &size, int variant);
+};
+
+#endif // FIXTUREGENERATOR_H
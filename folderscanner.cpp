@@ -0,0 +1,65 @@
+#include "folderscanner.h"
+#include "fileoperations.h"
+#include "catalog.h"
+#include <QElapsedTimer>
+
+FolderScanner::FolderScanner(const QString &mainFolder, bool recursive, Catalog *catalog,
+                             const QStringList &mediaExtensions, QObject *parent)
+    : QThread(parent)
+    , mainFolder(mainFolder)
+    , recursive(recursive)
+    , catalog(catalog)
+    , mediaExtensions(mediaExtensions)
+{
+}
+
+void FolderScanner::run()
+{
+    FileOperations fileOperations;
+    if (catalog) {
+        fileOperations.setCatalog(catalog, mediaExtensions);
+    }
+    QStringList batch;
+    QStringList countedFolders;
+    QVector<MediaTotals> countedTotals;
+    int foldersScanned = 0;
+    QElapsedTimer sinceFlush;
+    sinceFlush.start();
+
+    auto flush = [&]() {
+        if (!countedFolders.isEmpty()) {
+            emit mediaCounted(countedFolders, countedTotals);
+            countedFolders.clear();
+            countedTotals.clear();
+        }
+        if (!batch.isEmpty()) {
+            emit foldersFound(batch);
+            batch.clear();
+        }
+        emit progress(foldersScanned);
+        sinceFlush.restart();
+    };
+
+    fileOperations.scanFolders(mainFolder, recursive, [&](const QString &folder) {
+        if (isInterruptionRequested()) {
+            return false;
+        }
+
+        batch.append(folder);
+        ++foldersScanned;
+
+        // Send the very first folder right away so the UI can show something
+        if (foldersScanned == 1 || batch.size() >= maxBatchSize
+            || sinceFlush.elapsed() >= maxBatchIntervalMs) {
+            flush();
+        }
+        return true;
+    }, [&](const CatalogEntry &entry) {
+        countedFolders.append(entry.path);
+        countedTotals.append(MediaTotals::of(entry.mediaFiles));
+    });
+
+    if (!isInterruptionRequested()) {
+        flush();
+    }
+}
@@ -0,0 +1,41 @@
+#ifndef FOLDERSCANNER_H
+#define FOLDERSCANNER_H
+
+#include <QThread>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include "folderstats.h"
+
+class Catalog;
+
+// Runs FileOperations::scanFolders() on a worker thread and streams the
+// discovered folders back in batches, along with the media totals of each
+// folder as its listing comes in. Cancel with requestInterruption().
+class FolderScanner : public QThread
+{
+    Q_OBJECT
+
+public:
+    FolderScanner(const QString &mainFolder, bool recursive, Catalog *catalog,
+                  const QStringList &mediaExtensions, QObject *parent = nullptr);
+
+signals:
+    void foldersFound(const QStringList &batch);
+    void mediaCounted(const QStringList &folders, const QVector<MediaTotals> &totals);
+    void progress(int foldersScanned);
+
+protected:
+    void run() override;
+
+private:
+    QString mainFolder;
+    bool recursive;
+    Catalog *catalog;
+    QStringList mediaExtensions;
+
+    static constexpr int maxBatchSize = 1024;
+    static constexpr int maxBatchIntervalMs = 50;
+};
+
+#endif // FOLDERSCANNER_H
@@ -0,0 +1,73 @@
+#include "folderstats.h"
+#include "catalog.h"
+
+MediaTotals MediaTotals::of(const QVector<CatalogMediaFile> &files)
+{
+    MediaTotals totals;
+    for (const CatalogMediaFile &file : files) {
+        if (file.type == MediaType::Video) {
+            ++totals.videos;
+        } else {
+            ++totals.images;
+        }
+        totals.bytes += file.size;
+    }
+    return totals;
+}
+
+void FolderStats::clear()
+{
+    folders.clear();
+}
+
+void FolderStats::set(const PathTree &tree, PathTree::Id folder, const MediaTotals &totals)
+{
+    if (int(folder) >= folders.size()) {
+        folders.resize(tree.size());
+    }
+    Folder &entry = folders[int(folder)];
+    const MediaTotals previous = entry.own;
+    entry.own = totals;
+    entry.known = true;
+    addToSubtrees(tree, folder, qint64(totals.images) - previous.images, qint64(totals.videos) - previous.videos,
+                  totals.bytes - previous.bytes);
+}
+
+void FolderStats::remove(const PathTree &tree, PathTree::Id folder)
+{
+    if (!isKnown(folder)) return;
+
+    Folder &entry = folders[int(folder)];
+    const MediaTotals previous = entry.own;
+    entry.own = MediaTotals();
+    entry.known = false;
+    addToSubtrees(tree, folder, -qint64(previous.images), -qint64(previous.videos), -previous.bytes);
+}
+
+bool FolderStats::isKnown(PathTree::Id folder) const
+{
+    return int(folder) < folders.size() && folders[int(folder)].known;
+}
+
+MediaTotals FolderStats::own(PathTree::Id folder) const
+{
+    return int(folder) < folders.size() ? folders[int(folder)].own : MediaTotals();
+}
+
+MediaTotals FolderStats::subtree(PathTree::Id folder) const
+{
+    return int(folder) < folders.size() ? folders[int(folder)].subtree : MediaTotals();
+}
+
+void FolderStats::addToSubtrees(const PathTree &tree, PathTree::Id folder, qint64 images, qint64 videos, qint64 bytes)
+{
+    if (images == 0 && videos == 0 && bytes == 0) return;
+
+    // Ancestors were inserted before their descendants, so their ids are in range
+    for (PathTree::Id id = folder; id != PathTree::NoId; id = tree.parent(id)) {
+        MediaTotals &subtree = folders[int(id)].subtree;
+        subtree.images = quint32(qint64(subtree.images) + images);
+        subtree.videos = quint32(qint64(subtree.videos) + videos);
+        subtree.bytes += bytes;
+    }
+}
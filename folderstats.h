@@ -0,0 +1,54 @@
+#ifndef FOLDERSTATS_H
+#define FOLDERSTATS_H
+
+#include <QMetaType>
+#include <QVector>
+#include "pathtree.h"
+
+struct CatalogMediaFile;
+
+// Media in one folder, or summed over a folder and all folders below it
+struct MediaTotals
+{
+    quint32 images = 0;
+    quint32 videos = 0;
+    qint64 bytes = 0;
+
+    quint32 files() const { return images + videos; }
+
+    static MediaTotals of(const QVector<CatalogMediaFile> &files);
+};
+
+Q_DECLARE_METATYPE(MediaTotals)
+
+// Media totals per PathTree folder along with rolled-up subtree totals.
+// Setting a folder's own totals adds the difference to each of its
+// ancestors, so the scan fills in both as it lists folders and every
+// lookup afterwards is O(1).
+class FolderStats
+{
+public:
+    void clear();
+    void set(const PathTree &tree, PathTree::Id folder, const MediaTotals &totals);
+    // Takes back the folder's own totals, as when it was deleted
+    void remove(const PathTree &tree, PathTree::Id folder);
+
+    // False for folders that were never counted
+    bool isKnown(PathTree::Id folder) const;
+    MediaTotals own(PathTree::Id folder) const;
+    MediaTotals subtree(PathTree::Id folder) const;
+
+private:
+    struct Folder
+    {
+        MediaTotals own;
+        MediaTotals subtree;
+        bool known = false;
+    };
+
+    QVector<Folder> folders; // by id
+
+    void addToSubtrees(const PathTree &tree, PathTree::Id folder, qint64 images, qint64 videos, qint64 bytes);
+};
+
+#endif // FOLDERSTATS_H
@@ -0,0 +1,395 @@
+#include "folderwatcher.h"
+#include "folderscanner.h"
+#include "catalog.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSocketNotifier>
+#include <utility>
+
+#ifdef Q_OS_LINUX
+#include <sys/inotify.h>
+#include <errno.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+#ifdef Q_OS_LINUX
+const uint32_t watchMask = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_CLOSE_WRITE
+                           | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR;
+
+int readMaxUserWatches()
+{
+    QFile file("/proc/sys/fs/inotify/max_user_watches");
+    if (!file.open(QIODevice::ReadOnly)) {
+        return 8192;
+    }
+    return file.readAll().trimmed().toInt();
+}
+#endif
+
+QString subtreePrefix(const QString &folder)
+{
+    return folder.endsWith(QLatin1Char('/')) ? folder : folder + QLatin1Char('/');
+}
+
+} // namespace
+
+FolderWatcher::FolderWatcher(QObject *parent)
+    : QObject(parent)
+{
+#ifdef Q_OS_LINUX
+    inotifyFd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd >= 0) {
+        notifier = new QSocketNotifier(inotifyFd, QSocketNotifier::Read, this);
+        connect(notifier, &QSocketNotifier::activated, this, &FolderWatcher::readEvents);
+        // Leave a quarter of the per-user limit to other applications
+        watchBudget = readMaxUserWatches() / 4 * 3;
+    }
+#endif
+
+    addWatchesTimer.setInterval(0);
+    connect(&addWatchesTimer, &QTimer::timeout, this, &FolderWatcher::addPendingWatches);
+
+    pollTimer.setInterval(pollIntervalMs);
+    connect(&pollTimer, &QTimer::timeout, this, &FolderWatcher::pollNextSlice);
+
+    flushTimer.setSingleShot(true);
+    flushTimer.setInterval(flushIntervalMs);
+    connect(&flushTimer, &QTimer::timeout, this, &FolderWatcher::flushChanges);
+}
+
+FolderWatcher::~FolderWatcher()
+{
+    // Includes scans orphaned by clear() that have not wound down yet
+    const QList<FolderScanner *> scanners = findChildren<FolderScanner *>();
+    for (FolderScanner *scanner : scanners) {
+        scanner->requestInterruption();
+        scanner->wait();
+    }
+#ifdef Q_OS_LINUX
+    if (inotifyFd >= 0) {
+        ::close(inotifyFd);
+    }
+#endif
+}
+
+void FolderWatcher::watch(const QString &root, const QStringList &folders, bool recursive)
+{
+    clear();
+    this->root = QDir(root).path();
+    this->recursive = recursive;
+
+    // The root is watched for new subfolders even when it is not part of the list
+    pendingWatches = folders;
+    if (!recursive) {
+        pendingWatches.prepend(this->root);
+    }
+    pendingPosition = 0;
+
+    // Adding hundreds of thousands of watches takes a while, so do it in slices
+    addWatchesTimer.start();
+}
+
+void FolderWatcher::clear()
+{
+    addWatchesTimer.stop();
+    pollTimer.stop();
+    flushTimer.stop();
+
+    const QList<FolderScanner *> scanners = findChildren<FolderScanner *>();
+    for (FolderScanner *scanner : scanners) {
+        scanner->requestInterruption();
+    }
+    scanningSubtrees.clear();
+    ++scanGeneration;
+
+#ifdef Q_OS_LINUX
+    for (auto it = watchPaths.constBegin(); it != watchPaths.constEnd(); ++it) {
+        ::inotify_rm_watch(inotifyFd, it.key());
+    }
+#endif
+
+    watchedFolders.clear();
+    watchPaths.clear();
+    watchCount = 0;
+    pendingWatches.clear();
+    pendingPosition = 0;
+    pollQueue.clear();
+    pollPosition = 0;
+    polledMtimes.clear();
+    dirtySubfolders.clear();
+    dirtyMedia.clear();
+}
+
+void FolderWatcher::addPendingWatches()
+{
+    int end = qMin(pendingPosition + watchesPerSlice, int(pendingWatches.size()));
+    for (; pendingPosition < end; ++pendingPosition) {
+        addFolder(pendingWatches[pendingPosition]);
+    }
+
+    if (pendingPosition >= pendingWatches.size()) {
+        addWatchesTimer.stop();
+        pendingWatches.clear();
+        pendingPosition = 0;
+    }
+}
+
+void FolderWatcher::addFolder(const QString &path)
+{
+    if (watchedFolders.contains(path)) return;
+
+    int wd = -1;
+#ifdef Q_OS_LINUX
+    if (inotifyFd >= 0 && watchCount < watchBudget) {
+        wd = ::inotify_add_watch(inotifyFd, QFile::encodeName(path).constData(), watchMask);
+        if (wd < 0 && errno == ENOSPC) {
+            // Hit the system-wide limit early; everything from here on is polled
+            watchBudget = watchCount;
+        }
+    }
+#endif
+
+    watchedFolders.insert(path, wd);
+    if (wd >= 0) {
+        watchPaths.insert(wd, path);
+        ++watchCount;
+    } else {
+        pollQueue.append(path);
+        if (!pollTimer.isActive()) {
+            pollTimer.start();
+        }
+    }
+}
+
+void FolderWatcher::removeFolderTree(const QString &path)
+{
+    auto forget = [this](QMap<QString, int>::iterator it) {
+#ifdef Q_OS_LINUX
+        if (it.value() >= 0) {
+            ::inotify_rm_watch(inotifyFd, it.value());
+            watchPaths.remove(it.value());
+            --watchCount;
+        }
+#endif
+        polledMtimes.remove(it.key());
+        return watchedFolders.erase(it);
+    };
+
+    auto it = watchedFolders.find(path);
+    if (it != watchedFolders.end()) {
+        forget(it);
+    }
+
+    // Descendants sort right after their common prefix
+    const QString prefix = subtreePrefix(path);
+    it = watchedFolders.lowerBound(prefix);
+    while (it != watchedFolders.end() && it.key().startsWith(prefix)) {
+        it = forget(it);
+    }
+}
+
+QStringList FolderWatcher::knownSubfolders(const QString &parent) const
+{
+    QStringList children;
+    const QString prefix = subtreePrefix(parent);
+    for (auto it = watchedFolders.lowerBound(prefix); it != watchedFolders.end() && it.key().startsWith(prefix); ++it) {
+        if (it.key().indexOf(QLatin1Char('/'), prefix.size()) < 0) {
+            children.append(it.key());
+        }
+    }
+    return children;
+}
+
+void FolderWatcher::readEvents()
+{
+#ifdef Q_OS_LINUX
+    alignas(struct inotify_event) char buffer[16 * 1024];
+    bool overflow = false;
+
+    for (;;) {
+        ssize_t length = ::read(inotifyFd, buffer, sizeof(buffer));
+        if (length <= 0) {
+            break;
+        }
+
+        for (ssize_t offset = 0; offset < length;) {
+            auto *event = reinterpret_cast<const struct inotify_event *>(buffer + offset);
+            offset += sizeof(struct inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                overflow = true;
+                continue;
+            }
+
+            const QString path = watchPaths.value(event->wd);
+            if (path.isEmpty()) {
+                continue;
+            }
+            if (event->mask & IN_IGNORED) {
+                watchPaths.remove(event->wd);
+                continue;
+            }
+
+            if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF)) {
+                markDirty(QFileInfo(path).path(), true, false);
+            } else if (event->mask & IN_ISDIR) {
+                markDirty(path, true, false);
+            } else {
+                markDirty(path, false, true);
+            }
+        }
+    }
+
+    if (overflow) {
+        emit overflowed();
+    }
+#endif
+}
+
+void FolderWatcher::pollNextSlice()
+{
+    if (pollQueue.isEmpty()) {
+        pollTimer.stop();
+        return;
+    }
+
+    for (int i = 0; i < pollsPerSlice && i < pollQueue.size(); ++i) {
+        if (pollPosition >= pollQueue.size()) {
+            pollPosition = 0;
+        }
+        const QString path = pollQueue[pollPosition];
+        if (!watchedFolders.contains(path)) {
+            // Removed since it was queued
+            pollQueue.removeAt(pollPosition);
+            continue;
+        }
+        ++pollPosition;
+
+        quint64 inode = 0;
+        qint64 mtime = 0;
+        if (!Catalog::statFolder(path, inode, mtime)) {
+            markDirty(QFileInfo(path).path(), true, false);
+            continue;
+        }
+
+        auto it = polledMtimes.find(path);
+        if (it == polledMtimes.end()) {
+            polledMtimes.insert(path, mtime);
+        } else if (it.value() != mtime) {
+            it.value() = mtime;
+            markDirty(path, true, true);
+        }
+    }
+}
+
+void FolderWatcher::markDirty(const QString &folder, bool subfolders, bool media)
+{
+    if (subfolders) {
+        dirtySubfolders.insert(folder);
+    }
+    if (media) {
+        dirtyMedia.insert(folder);
+    }
+
+    // Don't restart a running timer, or a busy folder would never get flushed
+    if (!flushTimer.isActive()) {
+        flushTimer.start();
+    }
+}
+
+void FolderWatcher::flushChanges()
+{
+    const QSet<QString> parents = std::exchange(dirtySubfolders, QSet<QString>());
+    const QSet<QString> media = std::exchange(dirtyMedia, QSet<QString>());
+
+    for (const QString &parent : parents) {
+        if (watchedFolders.contains(parent)) {
+            diffSubfolders(parent);
+        }
+    }
+
+    QStringList changed;
+    for (const QString &folder : media) {
+        if (watchedFolders.contains(folder)) {
+            changed.append(folder);
+        }
+    }
+    if (!changed.isEmpty()) {
+        emit mediaChanged(changed);
+    }
+}
+
+void FolderWatcher::diffSubfolders(const QString &parent)
+{
+    // Without recursion only the root's direct children are part of the list
+    if (!recursive && parent != root) return;
+
+    QDir dir(parent);
+    if (!dir.exists()) {
+        if (parent != root) {
+            removeFolderTree(parent);
+            emit folderRemoved(parent);
+        }
+        return;
+    }
+
+    QSet<QString> present;
+    const QStringList entries = dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+    for (const QString &entry : entries) {
+        present.insert(dir.filePath(entry));
+    }
+
+    const QStringList known = knownSubfolders(parent);
+    for (const QString &folder : known) {
+        if (!present.contains(folder)) {
+            removeFolderTree(folder);
+            emit folderRemoved(folder);
+        }
+    }
+
+    for (const QString &entry : entries) {
+        const QString folder = dir.filePath(entry);
+        if (watchedFolders.contains(folder) || scanningSubtrees.contains(folder)) continue;
+
+        if (recursive) {
+            scanSubtree(folder);
+        } else {
+            addFolder(folder);
+            emit foldersAdded({folder});
+        }
+    }
+}
+
+void FolderWatcher::scanSubtree(const QString &folder)
+{
+    // A tree moved or copied in can be large; listing it must not hold up the GUI
+    FolderScanner *scanner = new FolderScanner(folder, true, nullptr, QStringList(), this);
+    scanningSubtrees.insert(folder, QStringList());
+    const int generation = scanGeneration;
+
+    connect(scanner, &FolderScanner::foldersFound, this, [this, folder, generation](const QStringList &batch) {
+        if (generation != scanGeneration) return;
+        auto it = scanningSubtrees.find(folder);
+        if (it != scanningSubtrees.end()) {
+            it->append(batch);
+        }
+    });
+    connect(scanner, &QThread::finished, this, [this, scanner, folder, generation]() {
+        scanner->deleteLater();
+        if (generation != scanGeneration) return;
+
+        // Skip it if it went away again, along with its parent or by itself
+        const QStringList subtree = scanningSubtrees.take(folder);
+        if (subtree.isEmpty() || !watchedFolders.contains(QFileInfo(folder).path()) || !QFileInfo(folder).isDir()) {
+            return;
+        }
+        for (const QString &path : subtree) {
+            addFolder(path);
+        }
+        emit foldersAdded(subtree);
+    });
+    scanner->start(QThread::LowPriority);
+}
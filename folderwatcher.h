@@ -0,0 +1,88 @@
+#ifndef FOLDERWATCHER_H
+#define FOLDERWATCHER_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QMap>
+#include <QHash>
+#include <QSet>
+#include <QTimer>
+
+class QSocketNotifier;
+
+// Keeps a scanned folder list live. Every folder gets an inotify watch; events
+// are coalesced per folder and flushed at most every flushIntervalMs as small
+// incremental changes. Folders beyond the inotify watch limit (or on other
+// platforms) are polled round-robin by directory mtime instead. A new folder's
+// subtree is listed by a background FolderScanner and added once complete.
+class FolderWatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit FolderWatcher(QObject *parent = nullptr);
+    ~FolderWatcher();
+
+    void watch(const QString &root, const QStringList &folders, bool recursive);
+    void clear();
+
+signals:
+    // Pre-order listing of a new folder and its subfolders, subtree[0] is the new folder
+    void foldersAdded(const QStringList &subtree);
+    // The folder and everything below it is gone
+    void folderRemoved(const QString &folder);
+    // Files were added, removed or rewritten in these folders
+    void mediaChanged(const QStringList &folders);
+    // The kernel dropped events; the folder list needs a full refresh
+    void overflowed();
+
+private slots:
+    void readEvents();
+    void addPendingWatches();
+    void pollNextSlice();
+    void flushChanges();
+
+private:
+    void addFolder(const QString &path);
+    void removeFolderTree(const QString &path);
+    QStringList knownSubfolders(const QString &parent) const;
+    void diffSubfolders(const QString &parent);
+    void scanSubtree(const QString &folder);
+    void markDirty(const QString &folder, bool subfolders, bool media);
+
+    QString root;
+    bool recursive = false;
+
+    int inotifyFd = -1;
+    QSocketNotifier *notifier = nullptr;
+    int watchBudget = 0;
+    int watchCount = 0;
+
+    QMap<QString, int> watchedFolders; // path -> inotify watch descriptor, -1 when polled
+    QHash<int, QString> watchPaths;
+    QStringList pendingWatches;
+    int pendingPosition = 0;
+    QTimer addWatchesTimer;
+
+    QStringList pollQueue;
+    int pollPosition = 0;
+    QHash<QString, qint64> polledMtimes;
+    QTimer pollTimer;
+
+    // Subtrees listed so far by running scans, by new folder; the generation
+    // lets scans orphaned by clear() be ignored
+    QHash<QString, QStringList> scanningSubtrees;
+    int scanGeneration = 0;
+
+    QSet<QString> dirtySubfolders;
+    QSet<QString> dirtyMedia;
+    QTimer flushTimer;
+
+    static constexpr int flushIntervalMs = 150;
+    static constexpr int watchesPerSlice = 4096;
+    static constexpr int pollIntervalMs = 1000;
+    static constexpr int pollsPerSlice = 2000;
+};
+
+#endif // FOLDERWATCHER_H
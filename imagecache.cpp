@@ -0,0 +1,127 @@
+#include "imagecache.h"
+#include "imageloader.h"
+#include "tracer.h"
+#include <QMetaObject>
+#include <QThread>
+
+ImageCache::ImageCache(QObject *parent)
+    : QObject(parent)
+{
+    pool.setMaxThreadCount(qMax(2, QThread::idealThreadCount() / 2));
+    setMemoryBudget(256LL * 1024 * 1024);
+}
+
+ImageCache::~ImageCache()
+{
+    cancelPending();
+    pool.waitForDone();
+}
+
+void ImageCache::setMemoryBudget(qint64 bytes)
+{
+    cache.setMaxCost(qMax<qint64>(bytes, 1));
+}
+
+void ImageCache::setTargetSize(const QSize &size)
+{
+    if (size == targetSize) return;
+
+    targetSize = size;
+    cache.clear();
+    cancelPending();
+}
+
+bool ImageCache::lookup(const QString &path, QImage &image) const
+{
+    const QImage *cached = cache.object(path);
+    Tracer::count(cached ? TraceCounter::CacheHits : TraceCounter::CacheMisses);
+    if (!cached) return false;
+
+    image = *cached;
+    return true;
+}
+
+void ImageCache::request(const QString &path)
+{
+    ++latestRequest;
+    schedule(path, 1);
+}
+
+void ImageCache::prefetch(const QStringList &paths)
+{
+    for (const QString &path : paths) {
+        schedule(path, 0);
+    }
+}
+
+void ImageCache::cancelPending()
+{
+    ++generation;
+    pool.clear();
+    pending.clear();
+}
+
+void ImageCache::schedule(const QString &path, int priority)
+{
+    if (cache.contains(path)) return;
+
+    auto queued = pending.find(path);
+    if (queued != pending.end()) {
+        if (priority <= queued->priority) return;
+        // Only prefetched so far: unless it is already decoding, it would wait
+        // behind every other prefetch, so queue it again ahead of them
+        int expected = PendingDecode::Queued;
+        if (!queued->state->compare_exchange_strong(expected, PendingDecode::Dropped)) return;
+    }
+
+    PendingDecode decode;
+    decode.priority = priority;
+    decode.state = std::make_shared<std::atomic<int>>(PendingDecode::Queued);
+    pending.insert(path, decode);
+    const std::shared_ptr<std::atomic<int>> state = decode.state;
+    const QSize size = targetSize;
+    const int jobGeneration = generation;
+    const int jobRequest = priority > 0 ? int(latestRequest) : 0;
+
+    pool.start([this, path, size, jobGeneration, jobRequest, state]() {
+        if (jobGeneration != generation) return;
+        int expected = PendingDecode::Queued;
+        if (!state->compare_exchange_strong(expected, PendingDecode::Started)) return;
+        // Moved on before the decode started (arrow key held down): leave it to prefetching
+        if (jobRequest && jobRequest != latestRequest) {
+            QMetaObject::invokeMethod(this, [this, path, jobGeneration]() {
+                if (jobGeneration == generation) pending.remove(path);
+            }, Qt::QueuedConnection);
+            return;
+        }
+
+        // The camera's preview is a few kilobytes away; show it while the full decode runs
+        if (jobRequest) {
+            const QImage preview = ImageLoader::loadPreview(path);
+            if (!preview.isNull() && jobRequest == latestRequest) {
+                QMetaObject::invokeMethod(this, [this, path, preview, jobGeneration]() {
+                    if (jobGeneration == generation && !cache.contains(path)) {
+                        emit previewReady(path, preview);
+                    }
+                }, Qt::QueuedConnection);
+            }
+        }
+
+        QImage image = ImageLoader::load(path, size);
+
+        QMetaObject::invokeMethod(this, [this, path, image, jobGeneration]() {
+            onDecoded(path, image, jobGeneration);
+        }, Qt::QueuedConnection);
+    }, priority);
+}
+
+void ImageCache::onDecoded(const QString &path, const QImage &image, int jobGeneration)
+{
+    if (jobGeneration != generation) return;
+
+    pending.remove(path);
+    if (!image.isNull()) {
+        cache.insert(path, new QImage(image), qMax<qsizetype>(image.sizeInBytes(), 1));
+    }
+    emit imageReady(path, image);
+}
@@ -0,0 +1,68 @@
+#ifndef IMAGECACHE_H
+#define IMAGECACHE_H
+
+#include <QObject>
+#include <QCache>
+#include <QHash>
+#include <QImage>
+#include <QSize>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+#include <atomic>
+#include <memory>
+
+// LRU cache of display-sized images. Decoding (through ImageLoader, at the
+// target size) happens on a private thread pool; the cache itself is only
+// touched from the GUI thread. Each cached
+// image costs its size in bytes against the memory budget.
+class ImageCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ImageCache(QObject *parent = nullptr);
+    ~ImageCache();
+
+    void setMemoryBudget(qint64 bytes);
+    // Images are decoded to fit this size; changing it drops everything cached
+    void setTargetSize(const QSize &size);
+
+    bool lookup(const QString &path, QImage &image) const;
+    // Decode path ahead of any prefetch work; imageReady() follows, preceded
+    // by previewReady() when the file embeds a preview. A newer request drops
+    // this one if its decode has not started yet.
+    void request(const QString &path);
+    // Queue background decodes in the given order, most likely needed first
+    void prefetch(const QStringList &paths);
+    // Drop queued work and ignore results of decodes already running
+    void cancelPending();
+
+signals:
+    // image is null when the file could not be decoded
+    void imageReady(const QString &path, const QImage &image);
+    // The embedded EXIF preview of a requested path, to show until imageReady()
+    void previewReady(const QString &path, const QImage &preview);
+
+private:
+    // A queued decode; a request takes over a prefetch of the same path that has not started
+    struct PendingDecode
+    {
+        enum State { Queued, Started, Dropped };
+
+        int priority = 0;
+        std::shared_ptr<std::atomic<int>> state;
+    };
+
+    void schedule(const QString &path, int priority);
+    void onDecoded(const QString &path, const QImage &image, int generation);
+
+    QCache<QString, QImage> cache;
+    QHash<QString, PendingDecode> pending;
+    QThreadPool pool;
+    QSize targetSize;
+    std::atomic<int> generation{0};
+    std::atomic<int> latestRequest{0};
+};
+
+#endif // IMAGECACHE_H
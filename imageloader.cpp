@@ -0,0 +1,59 @@
+#include "imageloader.h"
+#include "mediametadata.h"
+#include "tracer.h"
+#include <QImageReader>
+#include <QTransform>
+
+namespace {
+
+// EXIF orientation the way QImageReader applies it: mirror or flip, then a quarter turn clockwise
+QImage oriented(const QImage &image, quint16 orientation)
+{
+    switch (orientation) {
+    case 2: return image.mirrored(true, false);
+    case 3: return image.mirrored(true, true);
+    case 4: return image.mirrored(false, true);
+    case 5: return image.mirrored(false, true).transformed(QTransform().rotate(90));
+    case 6: return image.transformed(QTransform().rotate(90));
+    case 7: return image.mirrored(true, false).transformed(QTransform().rotate(90));
+    case 8: return image.transformed(QTransform().rotate(270));
+    default: return image;
+    }
+}
+
+} // namespace
+
+QImage ImageLoader::load(const QString &path, const QSize &boundingSize)
+{
+    TraceSpan span("decode", "image");
+    const qint64 start = Tracer::now();
+    QImageReader reader(path);
+    reader.setAutoTransform(true);
+
+    const QSize imageSize = reader.size();
+    if (imageSize.isValid() && boundingSize.isValid()) {
+        // The reader scales before it rotates, so fit the stored image into the rotated box
+        const bool transposed = reader.transformation() & QImageIOHandler::TransformationRotate90;
+        const QSize box = transposed ? boundingSize.transposed() : boundingSize;
+        const QSize scaledSize = imageSize.scaled(box, Qt::KeepAspectRatio);
+        if (!scaledSize.isEmpty() && scaledSize != imageSize) {
+            reader.setScaledSize(scaledSize);
+        }
+    }
+
+    QImage image = reader.read();
+    Tracer::count(TraceCounter::ImagesDecoded);
+    Tracer::count(TraceCounter::DecodeNanoseconds, Tracer::now() - start);
+    return image;
+}
+
+QImage ImageLoader::loadPreview(const QString &path)
+{
+    TraceSpan span("decode", "preview");
+    quint16 orientation;
+    const QByteArray jpeg = MetadataReader::readPreview(path, orientation);
+    if (jpeg.isEmpty()) {
+        return QImage();
+    }
+    return oriented(QImage::fromData(jpeg, "JPEG"), orientation);
+}
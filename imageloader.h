@@ -0,0 +1,24 @@
+#ifndef IMAGELOADER_H
+#define IMAGELOADER_H
+
+#include <QImage>
+#include <QSize>
+#include <QString>
+
+// Decodes images straight to the size they are shown at. QImageReader hands
+// the target size to the format plugin, so JPEGs are reduced in the DCT domain
+// and a 50 MP photo never exists in memory at full size. EXIF orientation is
+// applied as part of the read. Safe to call from worker threads.
+class ImageLoader
+{
+public:
+    // Fits the (oriented) image into boundingSize keeping its aspect ratio;
+    // an invalid boundingSize decodes at full resolution
+    static QImage load(const QString &path, const QSize &boundingSize);
+    // The small preview a camera embeds in the EXIF of a JPEG or RAW file,
+    // oriented like the image; null when there is none. It costs a few header
+    // reads and decoding a few kilobytes, so it can stand in while load() runs.
+    static QImage loadPreview(const QString &path);
+};
+
+#endif // IMAGELOADER_H
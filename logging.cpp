@@ -0,0 +1,5 @@
+#include "logging.h"
+
+Q_LOGGING_CATEGORY(lcFiles, "smartrabbit.files", QtInfoMsg)
+Q_LOGGING_CATEGORY(lcDisplay, "smartrabbit.display", QtInfoMsg)
+Q_LOGGING_CATEGORY(lcDecode, "smartrabbit.decode", QtInfoMsg)
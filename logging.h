@@ -0,0 +1,12 @@
+#ifndef LOGGING_H
+#define LOGGING_H
+
+#include <QLoggingCategory>
+
+// Debug output is off by default; turn a category on with for example
+// QT_LOGGING_RULES="smartrabbit.files.debug=true"
+Q_DECLARE_LOGGING_CATEGORY(lcFiles)
+Q_DECLARE_LOGGING_CATEGORY(lcDisplay)
+Q_DECLARE_LOGGING_CATEGORY(lcDecode)
+
+#endif // LOGGING_H
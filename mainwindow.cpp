@@ -4,11 +4,43 @@
 #include <QMessageBox>
 #include <QKeyEvent>
 #include <QDate>
+#include <QDateTime>
 #include <QCheckBox>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QLocale>
+#include <QLineEdit>
+#include <QPushButton>
+#include <algorithm>
+#include <memory>
+#include "mediadisplay.h"
+#include "duplicatesdialog.h"
+#include "debugpanel.h"
+#include "tiledimageview.h"
+#include "logging.h"
+#include "tracer.h"
+
+namespace {
+
+// "12 images, 3 videos (1.2 GB)"
+QString describeMedia(const MediaTotals &totals)
+{
+    if (totals.files() == 0) return "no media";
+    QStringList parts;
+    if (totals.images > 0) parts.append(QString("%1 image%2").arg(totals.images).arg(totals.images == 1 ? "" : "s"));
+    if (totals.videos > 0) parts.append(QString("%1 video%2").arg(totals.videos).arg(totals.videos == 1 ? "" : "s"));
+    return QString("%1 (%2)").arg(parts.join(", "), QLocale().formattedDataSize(totals.bytes));
+}
+
+} // namespace
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , ui(new Ui::MainWindow)
+    , catalog(configManager.getCatalogFile())
+    , thumbnailStore(configManager.getThumbnailFile())
+    , thumbnailModel(&thumbnailStore)
+    , deleteQueue(configManager.getTrashJournalFile())
 {
     ui->setupUi(this);
 
@@ -16,6 +48,14 @@ MainWindow::MainWindow(QWidget *parent)
     configManager.load();
     mainFolder = configManager.getMainFolder();
     supportedExtensions = configManager.getSupportedExtensions();
+    deleteQueue.setRetentionMinutes(configManager.getTrashRetentionMinutes());
+    fileOperations.setDeleteQueue(&deleteQueue);
+    connect(&transferQueue, &TransferQueue::failed, this, &MainWindow::onTransferFailed);
+    connect(&transferQueue, &TransferQueue::progress, this, &MainWindow::onTransferProgress);
+    connect(ui->filter_entry, &QLineEdit::returnPressed, this, &MainWindow::applyFilter);
+    connect(ui->filter_all_cb, &QCheckBox::toggled, this, [this]() {
+        if (!ui->filter_entry->text().trimmed().isEmpty()) applyFilter();
+    });
 
     // Initialize state
     currentFolderIndex = 0;
@@ -25,6 +65,7 @@ MainWindow::MainWindow(QWidget *parent)
     ui->folder_entry->setText(mainFolder.isEmpty() ? "No folder selected" : mainFolder);
     ui->recursive_cb->setChecked(configManager.getRecursive());
     ui->skip_confirm_cb->setChecked(configManager.getSkipDeleteConfirmation());
+    ui->media_only_cb->setChecked(configManager.getSkipEmptyFolders());
 
     // Connect checkbox signals using checkStateChanged (not deprecated)
     connect(ui->recursive_cb, &QCheckBox::checkStateChanged, this, [this](Qt::CheckState state) {
@@ -37,41 +78,143 @@ MainWindow::MainWindow(QWidget *parent)
         configManager.save();
     });
 
-    // Since ui->media_display is a QLabel, we can't connect MediaDisplay signals to it
-    // We'll handle the click event differently - remove this connection:
-    // connect(ui->media_display, &MediaDisplay::clicked, this, &MainWindow::on_play_btn_clicked);
+    connect(ui->media_only_cb, &QCheckBox::checkStateChanged, this, [this](Qt::CheckState state) {
+        configManager.setSkipEmptyFolders(state == Qt::Checked);
+        configManager.save();
+        skipToMediaFolder();
+        updateButtonStates();
+    });
 
-    // Instead, we'll use an event filter or handle mouse events on the QLabel
+    // Clicks are filtered rather than taken from MediaDisplay::clicked so a
+    // video can be played before its poster frame has arrived
     ui->media_display->installEventFilter(this);
+    ui->thumbnail_grid->installEventFilter(this);
     ui->media_display->setCursor(Qt::PointingHandCursor);
 
+    // Large images open in the tiled viewer with Z or a double-click
+    zoomView = new TiledImageView(ui->media_stack);
+    ui->media_stack->addWidget(zoomView);
+    connect(zoomView, &TiledImageView::zoomChanged, this, [this](double zoom) {
+        ui->status->setText(QString("Zoom %1% (wheel or +/- to zoom, drag to pan, 0 fits, Esc returns)").arg(qRound(zoom * 100)));
+    });
+
+    // Shrinking is served from the display's mipmaps; a larger view needs a sharper decode
+    connect(ui->media_display, &MediaDisplay::resizeSettled, this, [this]() {
+        imageCache.setTargetSize(ui->media_display->contentsRect().size());
+        if (mediaFiles.isEmpty() || ui->media_stack->currentWidget() != ui->single_page) return;
+        if (ui->media_display->isUpscaled() && !isVideoFile(currentMediaPath())) {
+            imageCache.request(currentMediaPath());
+        }
+        prefetchAroundCurrent();
+    });
+
     // Initial button states
     updateButtonStates();
+
+    // Keep the folder and media lists in sync with changes made by other programs
+    connect(&folderWatcher, &FolderWatcher::foldersAdded, this, &MainWindow::onFoldersAdded);
+    connect(&folderWatcher, &FolderWatcher::folderRemoved, this, &MainWindow::onFolderRemoved);
+    connect(&folderWatcher, &FolderWatcher::mediaChanged, this, &MainWindow::onMediaChanged);
+    connect(&folderWatcher, &FolderWatcher::overflowed, this, [this]() {
+        if (browsingResults) {
+            foldersStale = true;
+        } else if (!folderScanner) {
+            scanFolders(true);
+        }
+    });
+
+    imageCache.setMemoryBudget(qint64(configManager.getImageCacheMegabytes()) * 1024 * 1024);
+    connect(&imageCache, &ImageCache::imageReady, this, &MainWindow::onImageReady);
+    connect(&imageCache, &ImageCache::previewReady, this, [this](const QString &path, const QImage &preview) {
+        if (path == currentMediaPath()) {
+            showImage(preview);
+        }
+    });
+    connect(&animationPlayer, &AnimationPlayer::frameReady, ui->media_display, &MediaDisplay::setFrame);
+
+    // Videos show a poster frame once it has been extracted
+    connect(&thumbnailStore, &ThumbnailStore::thumbnailReady, this, &MainWindow::onPosterReady);
+
+    // Thumbnail grid of the current folder; picking a thumbnail selects that media
+    ui->thumbnail_grid->setModel(&thumbnailModel);
+    connect(ui->thumbnail_grid->selectionModel(), &QItemSelectionModel::currentChanged, this, [this](const QModelIndex &current) {
+        if (current.isValid() && current.row() != currentMediaIndex) {
+            currentMediaIndex = current.row();
+            updateMediaDisplay();
+        }
+    });
+    connect(ui->thumbnail_grid, &QListView::activated, this, [this]() {
+        ui->grid_btn->setChecked(false);
+    });
+
+    // Show the folders of the last scan straight away, then re-validate them in the background
+    fileOperations.setCatalog(&catalog, supportedExtensions);
+    if (catalog.load() && !mainFolder.isEmpty() && catalog.root() == QDir(mainFolder).path()
+        && catalog.isRecursive() == configManager.getRecursive()) {
+        appendFolders(folders, catalog.folders());
+        updateFolderDisplay();
+        scanFolders(true);
+    }
 }
 
 MainWindow::~MainWindow()
 {
+    // Includes scans orphaned by a rescan that have not wound down yet
+    const QList<FolderScanner *> scanners = findChildren<FolderScanner *>();
+    for (FolderScanner *scanner : scanners) {
+        scanner->requestInterruption();
+        scanner->wait();
+    }
+    if (duplicateFinder) {
+        duplicateFinder->requestInterruption();
+        duplicateFinder->wait();
+    }
+    // Likewise extractions stopped by a rescan
+    const QList<MetadataExtractor *> extractors = findChildren<MetadataExtractor *>();
+    for (MetadataExtractor *extractor : extractors) {
+        extractor->requestInterruption();
+        extractor->wait();
+    }
+    if (indexBuilder) {
+        indexBuilder->requestInterruption();
+        indexBuilder->wait();
+    }
+    if (similarityFinder) {
+        similarityFinder->requestInterruption();
+        similarityFinder->wait();
+    }
     delete ui;
 }
 
 // Add event filter to handle clicks on the media display
 bool MainWindow::eventFilter(QObject *watched, QEvent *event)
 {
+    if (watched == ui->media_display && event->type() == QEvent::MouseButtonDblClick) {
+        showZoomView(true);
+        return true;
+    }
     if (watched == ui->media_display && event->type() == QEvent::MouseButtonPress) {
         QMouseEvent *mouseEvent = static_cast<QMouseEvent*>(event);
         if (mouseEvent->button() == Qt::LeftButton) {
             // Check if we're currently displaying a video
-            QString currentFile = mediaFiles.value(currentMediaIndex);
+            QString currentFile = currentMediaPath();
             if (!currentFile.isEmpty()) {
-                QString ext = QFileInfo(currentFile).suffix().toLower();
-                bool isVideo = configManager.getVideoExtensions().contains("." + ext);
-                if (isVideo) {
+                if (isVideoFile(currentFile)) {
                     on_play_btn_clicked();
                     return true;
                 }
             }
         }
     }
+    // The grid would take these for its keyboard search and selection
+    if (watched == ui->thumbnail_grid && event->type() == QEvent::KeyPress) {
+        QKeyEvent *keyEvent = static_cast<QKeyEvent*>(event);
+        if (keyEvent->key() == Qt::Key_M || (keyEvent->key() >= Qt::Key_1 && keyEvent->key() <= Qt::Key_9)
+            || (keyEvent->key() == Qt::Key_Space && (keyEvent->modifiers() & Qt::ControlModifier))) {
+            keyPressEvent(keyEvent);
+            return true;
+        }
+    }
     return QMainWindow::eventFilter(watched, event);
 }
 
@@ -79,6 +222,7 @@ void MainWindow::on_browse_btn_clicked()
 {
     QString folder = QFileDialog::getExistingDirectory(this, "Select Media Folder");
     if (!folder.isEmpty()) {
+        cancelScan();
         mainFolder = folder;
         ui->folder_entry->setText(folder);
         configManager.setMainFolder(folder);
@@ -86,34 +230,736 @@ void MainWindow::on_browse_btn_clicked()
     }
 }
 
-void MainWindow::on_scan_btn_clicked()
+void MainWindow::on_scan_btn_clicked()
+{
+    scanFolders();
+}
+
+void MainWindow::scanFolders(bool refresh)
+{
+    if (mainFolder.isEmpty()) {
+        showMessage("Please select a folder first", true);
+        return;
+    }
+
+    // A rescan replaces whatever scan is still running, and rewrites the catalog
+    cancelScan();
+    stopMetadataExtraction();
+    if (browsingResults) {
+        foldersStale = false;
+        leaveResultGroups();
+    }
+
+    // A refresh keeps showing the current list and swaps in the result at the end
+    refreshingFolders = refresh;
+    if (!refresh) {
+        folders.clear();
+        markedFolders.clear();
+        // Nothing refers to the old folders any more
+        pathTree.clear();
+        folderStats.clear();
+        currentFolderIndex = 0;
+        updateFolderDisplay();
+    }
+
+    ui->status->setText(refresh ? "Checking folders for changes..." : "Scanning folders...");
+
+    folderWatcher.clear();
+
+    bool recursive = ui->recursive_cb->isChecked();
+    scanRecursive = recursive;
+    int generation = ++scanGeneration;
+    FolderScanner *scanner = new FolderScanner(mainFolder, recursive, &catalog, supportedExtensions, this);
+    folderScanner = scanner;
+
+    connect(scanner, &FolderScanner::foldersFound, this, [this, generation](const QStringList &batch) {
+        if (generation == scanGeneration) {
+            onFoldersFound(batch);
+        }
+    });
+    connect(scanner, &FolderScanner::mediaCounted, this,
+            [this, generation](const QStringList &paths, const QVector<MediaTotals> &totals) {
+        if (generation == scanGeneration) {
+            onMediaCounted(paths, totals);
+        }
+    });
+    connect(scanner, &FolderScanner::progress, this, [this, generation](int foldersScanned) {
+        if (generation == scanGeneration) {
+            ui->status->setText(QString("Scanning folders... %1 found (Esc to cancel)").arg(foldersScanned));
+        }
+    });
+    connect(scanner, &QThread::finished, this, [this, scanner, generation]() {
+        if (generation == scanGeneration) {
+            folderScanner = nullptr;
+            onScanFinished(scanner->isInterruptionRequested());
+        }
+        scanner->deleteLater();
+    });
+
+    scanner->start();
+}
+
+void MainWindow::cancelScan()
+{
+    if (!folderScanner) return;
+
+    // Orphan the running scan; its finished() handler only cleans up after itself
+    folderScanner->requestInterruption();
+    folderScanner = nullptr;
+    ++scanGeneration;
+    refreshingFolders = false;
+    refreshedFolders.clear();
+}
+
+void MainWindow::onFoldersFound(const QStringList &batch)
+{
+    if (refreshingFolders) {
+        appendFolders(refreshedFolders, batch);
+        return;
+    }
+
+    bool wasEmpty = folders.isEmpty();
+    appendFolders(folders, batch);
+
+    if (wasEmpty) {
+        currentFolderIndex = 0;
+        updateFolderDisplay();
+    } else {
+        updateFolderInfo();
+        updateButtonStates();
+    }
+}
+
+void MainWindow::onScanFinished(bool cancelled)
+{
+    if (refreshingFolders && !cancelled) {
+        applyRefreshedFolders();
+    }
+    refreshingFolders = false;
+    refreshedFolders.clear();
+
+    mediaIndexStale = true;
+    if (!cancelled) {
+        folderWatcher.watch(mainFolder, folderPaths(folders), scanRecursive);
+        extractMetadata();
+        skipToMediaFolder();
+    }
+
+    if (!folders.isEmpty()) {
+        ui->status->setText(QString(cancelled ? "Scan cancelled, %1 folders found" : "Found %1 folders").arg(folders.size()));
+    } else {
+        ui->status->setText(cancelled ? "Scan cancelled" : "No folders found");
+        ui->folder_info->setText("No folders found");
+        updateButtonStates();
+    }
+}
+
+void MainWindow::applyRefreshedFolders()
+{
+    if (refreshedFolders == folders) return;
+
+    // Folders that went away no longer count towards their parents
+    const QSet<PathTree::Id> kept(refreshedFolders.constBegin(), refreshedFolders.constEnd());
+    for (PathTree::Id folder : std::as_const(folders)) {
+        if (!kept.contains(folder)) {
+            folderStats.remove(pathTree, folder);
+        }
+    }
+    mediaFoldersStale = true;
+
+    // Stay on the folder the user is looking at if it still exists
+    PathTree::Id currentFolder = folders.value(currentFolderIndex, PathTree::NoId);
+    folders = refreshedFolders;
+    int index = folders.indexOf(currentFolder);
+    currentFolderIndex = qMax(0, index);
+
+    if (index < 0) {
+        updateFolderDisplay();
+    } else {
+        updateFolderInfo();
+        updateButtonStates();
+    }
+}
+
+void MainWindow::onFoldersAdded(const QStringList &subtree)
+{
+    if (browsingResults) {
+        foldersStale = true;
+        return;
+    }
+
+    mediaIndexStale = true;
+
+    // An undone delete is added right away and then reported by the watcher too
+    const QString top = subtree.first();
+    if (folders.contains(pathTree.find(top))) return;
+
+    const QString parentPath = QFileInfo(top).path();
+    const PathTree::Id parent = pathTree.insert(parentPath);
+    const QString name = QFileInfo(top).fileName();
+
+    // Without recursion the list is exactly the root's children; otherwise
+    // the new folder goes among its siblings right after its parent
+    int insertAt = 0;
+    if (parentPath != QDir(mainFolder).path() || scanRecursive) {
+        int parentIndex = folders.indexOf(parent);
+        if (parentIndex < 0) return;
+        insertAt = parentIndex + 1;
+    }
+
+    // Skip siblings (with their subtrees) that sort before the new folder
+    while (insertAt < folders.size() && pathTree.contains(parent, folders[insertAt])) {
+        const PathTree::Id sibling = folders[insertAt];
+        if (pathTree.parent(sibling) == parent && FileOperations::fileNameLessThan(name, pathTree.name(sibling))) {
+            break;
+        }
+        ++insertAt;
+    }
+
+    bool wasEmpty = folders.isEmpty();
+    QVector<PathTree::Id> added;
+    appendFolders(added, subtree);
+    for (int i = 0; i < added.size(); ++i) {
+        folders.insert(insertAt + i, added[i]);
+    }
+    countFolderMedia(subtree);
+
+    if (wasEmpty) {
+        currentFolderIndex = 0;
+        updateFolderDisplay();
+        return;
+    }
+    if (insertAt <= currentFolderIndex) {
+        currentFolderIndex += subtree.size();
+    }
+    updateFolderInfo();
+    updateButtonStates();
+}
+
+void MainWindow::onFolderRemoved(const QString &folder)
+{
+    removeFolders({folder});
+}
+
+void MainWindow::removeFolders(const QStringList &removed)
+{
+    mediaIndexStale = true;
+    if (browsingResults) {
+        foldersStale = true;
+        return;
+    }
+
+    QSet<PathTree::Id> gone;
+    for (const QString &path : removed) {
+        const PathTree::Id id = pathTree.find(path);
+        if (id != PathTree::NoId) {
+            gone.insert(id);
+        }
+    }
+    if (gone.isEmpty()) return;
+
+    // Descendants follow their folder in the pre-order list, so one pass
+    // that skips the subtree of each removed folder finds them all
+    QVector<PathTree::Id> remaining;
+    PathTree::Id skipTree = PathTree::NoId;
+    int removedBefore = 0;
+    bool currentRemoved = false;
+    for (int i = 0; i < folders.size(); ++i) {
+        const PathTree::Id folder = folders[i];
+        bool inRemoved = skipTree != PathTree::NoId && pathTree.contains(skipTree, folder);
+        if (!inRemoved && gone.contains(folder)) {
+            skipTree = folder;
+            inRemoved = true;
+        }
+        if (!inRemoved) {
+            remaining.append(folder);
+            continue;
+        }
+        markedFolders.remove(folder);
+        folderStats.remove(pathTree, folder);
+        if (i < currentFolderIndex) {
+            ++removedBefore;
+        } else if (i == currentFolderIndex) {
+            currentRemoved = true;
+        }
+    }
+    if (remaining.size() == folders.size()) return;
+
+    folders = remaining;
+    mediaFoldersStale = true;
+    currentFolderIndex -= removedBefore;
+    if (currentRemoved) {
+        currentFolderIndex = qMax(0, qMin(currentFolderIndex, int(folders.size()) - 1));
+        updateFolderDisplay();
+    } else {
+        updateFolderInfo();
+        updateButtonStates();
+    }
+}
+
+void MainWindow::onMediaChanged(const QStringList &changedFolders)
+{
+    mediaIndexStale = true;
+    countFolderMedia(changedFolders);
+    if (browsingResults || folders.isEmpty()) return;
+    updateFolderInfo();
+    updateButtonStates();
+    const QString folder = folderPath(currentFolderIndex);
+    if (!changedFolders.contains(folder)) return;
+
+    QStringList updated = listMediaFiles(folder);
+    if (updated == mediaFiles) return;
+
+    // Stay on the file being shown; if it went away show its successor
+    QString currentFile = mediaFiles.value(currentMediaIndex);
+    mediaFiles = updated;
+    thumbnailModel.setFolder(folder, mediaFiles);
+    int index = mediaFiles.indexOf(currentFile);
+    if (index >= 0) {
+        currentMediaIndex = index;
+        updateMediaInfo();
+        updateButtonStates();
+    } else {
+        currentMediaIndex = qMax(0, qMin(currentMediaIndex, int(mediaFiles.size()) - 1));
+        updateMediaDisplay();
+    }
+}
+
+void MainWindow::undoDelete()
+{
+    QString error;
+    const QStringList restored = deleteQueue.undo(&error);
+    if (restored.isEmpty()) {
+        ui->status->setText(QString("Undo failed: %1").arg(error));
+        return;
+    }
+
+    QString text = restored.size() == 1 ? QString("Restored: %1").arg(QFileInfo(restored.first()).fileName())
+                                        : QString("Restored %1 items").arg(restored.size());
+    if (!error.isEmpty()) {
+        text += QString(" (%1)").arg(error);
+    }
+    ui->status->setText(text);
+    if (browsingResults) {
+        foldersStale = true;
+        return;
+    }
+
+    // Put folders back the way a scan would have listed them
+    QStringList changedFolders;
+    for (const QString &path : restored) {
+        const QFileInfo info(path);
+        if (info.isDir()) {
+            onFoldersAdded(scanRecursive ? FileOperations().scanFolders(path, true) : QStringList{path});
+        } else if (!changedFolders.contains(info.path())) {
+            changedFolders.append(info.path());
+        }
+    }
+
+    // Then go to the first restored item
+    const QFileInfo first(restored.first());
+    int folderIndex = folders.indexOf(pathTree.find(first.isDir() ? first.filePath() : first.path()));
+    if (folderIndex < 0) return;
+    if (folderIndex != currentFolderIndex) {
+        imageCache.cancelPending();
+        currentFolderIndex = folderIndex;
+        updateFolderDisplay();
+    } else {
+        onMediaChanged(changedFolders);
+    }
+    int index = first.isDir() ? -1 : mediaFiles.indexOf(first.fileName());
+    if (index >= 0 && index != currentMediaIndex) {
+        currentMediaIndex = index;
+        updateMediaDisplay();
+    }
+}
+
+QStringList MainWindow::selectedMediaPaths() const
+{
+    // Thumbnails selected in the grid, otherwise the media being shown
+    QStringList paths;
+    if (ui->grid_btn->isChecked()) {
+        QModelIndexList selected = ui->thumbnail_grid->selectionModel()->selectedIndexes();
+        std::sort(selected.begin(), selected.end());
+        for (const QModelIndex &index : std::as_const(selected)) {
+            paths.append(mediaPath(index.row()));
+        }
+    }
+    if (paths.isEmpty() && !mediaFiles.isEmpty()) {
+        paths.append(currentMediaPath());
+    }
+    return paths;
+}
+
+QStringList MainWindow::selectedFolderPaths() const
+{
+    if (markedFolders.isEmpty()) {
+        return folders.isEmpty() ? QStringList() : QStringList{folderPath(currentFolderIndex)};
+    }
+
+    // In list order, leaving out folders inside another marked one
+    QStringList paths;
+    PathTree::Id lastMarked = PathTree::NoId;
+    for (PathTree::Id folder : folders) {
+        if (!markedFolders.contains(folder)) continue;
+        if (lastMarked != PathTree::NoId && pathTree.contains(lastMarked, folder)) continue;
+        lastMarked = folder;
+        paths.append(pathTree.path(folder));
+    }
+    return paths;
+}
+
+void MainWindow::toggleFolderMark()
+{
+    if (folders.isEmpty() || browsingResults) return;
+
+    const PathTree::Id folder = folders[currentFolderIndex];
+    if (!markedFolders.remove(folder)) {
+        markedFolders.insert(folder);
+    }
+    updateFolderInfo();
+}
+
+void MainWindow::removeMediaFiles(const QStringList &paths, const QHash<QString, QString> &failures)
+{
+    QSet<QString> removed;
+    for (const QString &path : paths) {
+        if (!failures.contains(path)) {
+            removed.insert(path);
+        }
+    }
+    if (removed.isEmpty()) return;
+    mediaIndexStale = true;
+
+    // Stay on the media being shown, or on its successor if it went away
+    QStringList remaining;
+    int index = -1;
+    for (int i = 0; i < mediaFiles.size(); ++i) {
+        if (removed.contains(mediaPath(i))) continue;
+        if (index < 0 && i >= currentMediaIndex) {
+            index = remaining.size();
+        }
+        remaining.append(mediaFiles[i]);
+    }
+
+    mediaFiles = remaining;
+    if (browsingResults) {
+        resultGroups[currentFolderIndex] = mediaFiles;
+    }
+    thumbnailModel.setFolder(mediaFolder(), mediaFiles);
+    currentMediaIndex = index >= 0 ? index : qMax(0, int(mediaFiles.size()) - 1);
+    updateMediaDisplay();
+}
+
+void MainWindow::moveSelectedMedia()
+{
+    if (mediaFiles.isEmpty()) return;
+
+    const QStringList paths = selectedMediaPaths();
+    const QString target = QFileDialog::getExistingDirectory(this, paths.size() == 1 ? "Move File To" : QString("Move %1 Files To").arg(paths.size()),
+                                                             mainFolder);
+    if (target.isEmpty()) return;
+
+    const QHash<QString, QString> failures = fileOperations.movePaths(paths, target);
+    removeMediaFiles(paths, failures);
+    if (failures.size() < paths.size()) {
+        ui->status->setText(QString("Moved %1 file(s) to %2").arg(paths.size() - failures.size()).arg(QFileInfo(target).fileName()));
+    }
+    showFailures("move", paths, failures);
+}
+
+void MainWindow::moveSelectedFolders()
+{
+    if (folders.isEmpty() || browsingResults) return;
+
+    const QStringList paths = selectedFolderPaths();
+    const QString target = QFileDialog::getExistingDirectory(this, paths.size() == 1 ? "Move Folder To" : QString("Move %1 Folders To").arg(paths.size()),
+                                                             mainFolder);
+    if (target.isEmpty()) return;
+
+    // Moved within the library they come back at their new place through the watcher
+    const QHash<QString, QString> failures = fileOperations.movePaths(paths, target);
+    QStringList moved;
+    for (const QString &path : paths) {
+        if (!failures.contains(path)) {
+            moved.append(path);
+        }
+    }
+    removeFolders(moved);
+    if (!moved.isEmpty()) {
+        ui->status->setText(QString("Moved %1 folder(s) to %2").arg(moved.size()).arg(QFileInfo(target).fileName()));
+    }
+    showFailures("move", paths, failures);
+}
+
+void MainWindow::sendToTarget(int key)
+{
+    if (mediaFiles.isEmpty()) return;
+
+    TransferTarget target = configManager.getTransferTargets().value(key);
+    if (target.folder.isEmpty()) {
+        if (!bindTransferTarget(key)) return;
+        target = configManager.getTransferTargets().value(key);
+    }
+
+    const QString targetFolder = QDir(target.folder).absolutePath();
+    const QStringList paths = selectedMediaPaths();
+    QStringList queued;
+    for (const QString &path : paths) {
+        if (QFileInfo(path).absolutePath() != targetFolder) {
+            transferQueue.enqueue(path, targetFolder, target.copy);
+            queued.append(path);
+        }
+    }
+    if (queued.isEmpty()) {
+        ui->status->setText(QString("Already in %1").arg(QFileInfo(targetFolder).fileName()));
+        return;
+    }
+
+    QString what = queued.size() == 1 ? QFileInfo(queued.first()).fileName() : QString("%1 files").arg(queued.size());
+    ui->status->setText(QString("%1 %2 to %3").arg(target.copy ? "Copying" : "Moving", what, QFileInfo(targetFolder).fileName()));
+
+    // Move on right away; the transfer finishes in the background
+    if (!target.copy) {
+        removeMediaFiles(queued, QHash<QString, QString>());
+    } else if (currentMediaIndex < mediaFiles.size() - 1) {
+        currentMediaIndex++;
+        updateMediaDisplay();
+    }
+}
+
+bool MainWindow::bindTransferTarget(int key)
+{
+    const TransferTarget current = configManager.getTransferTargets().value(key);
+    const QString folder = QFileDialog::getExistingDirectory(this, QString("Target Folder for Key %1").arg(key),
+                                                             current.folder.isEmpty() ? mainFolder : current.folder);
+    if (folder.isEmpty()) return false;
+
+    QMessageBox box(this);
+    box.setWindowTitle(QString("Key %1").arg(key));
+    box.setText(QString("Send media to \"%1\" with key %2:").arg(folder).arg(key));
+    QPushButton *moveButton = box.addButton("Move", QMessageBox::AcceptRole);
+    QPushButton *copyButton = box.addButton("Copy", QMessageBox::AcceptRole);
+    box.addButton(QMessageBox::Cancel);
+    box.setDefaultButton(current.copy ? copyButton : moveButton);
+    box.exec();
+    if (box.clickedButton() != moveButton && box.clickedButton() != copyButton) return false;
+
+    configManager.setTransferTarget(key, {folder, box.clickedButton() == copyButton});
+    configManager.save();
+    return true;
+}
+
+QStringList MainWindow::listMediaFiles(const QString &folder)
+{
+    QStringList files;
+    if (mediaQuery.isEmpty() || ui->filter_all_cb->isChecked()) {
+        files = fileOperations.getMediaFiles(folder, supportedExtensions);
+    } else {
+        // A one-folder index answers the filter with the same code as the library
+        MediaIndex index;
+        index.addFolder(folder, fileOperations.getMediaFileInfo(folder, supportedExtensions));
+        const QVector<int> rows = index.query(mediaQuery);
+        files.reserve(rows.size());
+        for (int row : rows) {
+            files.append(index.name(row));
+        }
+    }
+
+    // Files on their way out already left the list when they were sent
+    if (transferQueue.pendingCount() > 0) {
+        files.removeIf([this, &folder](const QString &file) {
+            return transferQueue.isMovePending(folder + "/" + file);
+        });
+    }
+    return files;
+}
+
+void MainWindow::applyFilter()
+{
+    const QString text = ui->filter_entry->text().trimmed();
+    if (text.isEmpty()) {
+        clearFilter();
+        return;
+    }
+
+    MediaQuery query;
+    QString error;
+    if (!MediaQuery::parse(text, query, &error)) {
+        ui->status->setText(QString("Filter: %1").arg(error));
+        return;
+    }
+    mediaQuery = query;
+
+    if (ui->filter_all_cb->isChecked()) {
+        if (mediaIndexStale) {
+            buildMediaIndex();
+        } else {
+            runLibraryQuery();
+        }
+        return;
+    }
+
+    // Per folder: the listing of every folder visited is filtered
+    if (browsingResults) {
+        leaveResultGroups();
+    } else {
+        imageCache.cancelPending();
+        updateFolderDisplay();
+    }
+    ui->status->setText(QString("Filter: %1 matching file(s) in this folder (Esc clears)").arg(mediaFiles.size()));
+}
+
+void MainWindow::clearFilter()
+{
+    const bool wasFiltered = !mediaQuery.isEmpty();
+    mediaQuery = MediaQuery();
+    ui->filter_entry->clear();
+    if (indexBuilder) {
+        indexBuilder->requestInterruption();
+    }
+    if (!wasFiltered) return;
+
+    if (browsingResults) {
+        leaveResultGroups();
+    } else {
+        updateFolderDisplay();
+    }
+    ui->status->setText("Filter cleared");
+}
+
+void MainWindow::buildMediaIndex()
+{
+    ui->status->setText("Filter: indexing the library...");
+    // A build interrupted by clearFilter() starts over from its finished() handler
+    if (indexBuilder) return;
+
+    // Listing from the catalog brings the header metadata along
+    auto index = std::make_shared<MediaIndex>();
+    const QStringList paths = folderPaths(browsingResults ? savedFolders : folders);
+    const QStringList extensions = supportedExtensions;
+    Catalog *libraryCatalog = &catalog;
+    QThread *builder = QThread::create([index, paths, extensions, libraryCatalog]() {
+        FileOperations operations;
+        operations.setCatalog(libraryCatalog, extensions);
+        for (const QString &folder : paths) {
+            if (QThread::currentThread()->isInterruptionRequested()) return;
+            index->addFolder(folder, operations.getMediaFileInfo(folder, extensions));
+        }
+    });
+    indexBuilder = builder;
+    connect(builder, &QThread::finished, this, [this, builder, index]() {
+        builder->deleteLater();
+        indexBuilder = nullptr;
+        if (builder->isInterruptionRequested()) {
+            // The filter was cleared and set again while it wound down
+            if (!mediaQuery.isEmpty() && ui->filter_all_cb->isChecked()) {
+                buildMediaIndex();
+            }
+            return;
+        }
+        mediaIndex = std::move(*index);
+        mediaIndexStale = false;
+        if (ui->filter_all_cb->isChecked()) runLibraryQuery();
+    });
+    builder->start(QThread::LowPriority);
+}
+
+void MainWindow::runLibraryQuery()
+{
+    if (mediaQuery.isEmpty()) return;
+
+    QElapsedTimer timer;
+    timer.start();
+    const QVector<int> rows = mediaIndex.query(mediaQuery);
+    QStringList paths;
+    paths.reserve(rows.size());
+    for (int row : rows) {
+        paths.append(mediaIndex.path(row));
+    }
+    const qint64 elapsed = timer.elapsed();
+
+    if (paths.isEmpty()) {
+        ui->status->setText(QString("Filter: nothing among %1 files matches").arg(mediaIndex.size()));
+        return;
+    }
+    showResultGroups({paths}, "Filter results");
+    ui->status->setText(QString("Filter: %1 of %2 files match (%3 ms, Esc clears)")
+                            .arg(paths.size()).arg(mediaIndex.size()).arg(elapsed));
+}
+
+void MainWindow::onTransferFailed(const QString &source, bool copy, const QString &error)
 {
-    scanFolders();
+    ui->status->setText(QString("Could not %1 %2: %3").arg(copy ? "copy" : "move", QFileInfo(source).fileName(), error));
+
+    // A failed move leaves the file where it was; show it again
+    if (!copy) {
+        onMediaChanged({QFileInfo(source).path()});
+    }
 }
 
-void MainWindow::scanFolders()
+void MainWindow::onTransferProgress(int pending, qint64 bytesDone, qint64 bytesTotal)
 {
-    if (mainFolder.isEmpty()) {
-        showMessage("Please select a folder first", true);
-        return;
+    if (pending == 0) {
+        ui->transfer_info->clear();
+    } else if (bytesTotal > 0) {
+        ui->transfer_info->setText(QString("Transferring %1 file(s)... %2%").arg(pending).arg(bytesDone * 100 / bytesTotal));
+    } else {
+        ui->transfer_info->setText(QString("Transferring %1 file(s)...").arg(pending));
     }
+}
+
+QHash<QString, QString> MainWindow::deletePaths(const QStringList &paths, int *permanent)
+{
+    QStringList untrashable;
+    QHash<QString, QString> failures = fileOperations.deletePaths(paths, &untrashable);
+    *permanent = 0;
+    if (untrashable.isEmpty()) return failures;
 
-    ui->status->setText("Scanning folders...");
+    // Asked even with confirmations off: without a trash there is no undo
+    const QString question = untrashable.size() == 1
+        ? QString("\"%1\" cannot be moved to the trash. Delete it permanently? This cannot be undone.")
+              .arg(QFileInfo(untrashable.first()).fileName())
+        : QString("%1 items cannot be moved to the trash. Delete them permanently? This cannot be undone.")
+              .arg(untrashable.size());
+    QMessageBox::StandardButton reply = QMessageBox::warning(this, "Delete Permanently", question,
+                                                             QMessageBox::Yes | QMessageBox::No, QMessageBox::No);
+    if (reply != QMessageBox::Yes) return failures;
 
-    bool recursive = ui->recursive_cb->isChecked();
-    folders = fileOperations.scanFolders(mainFolder, recursive);
-    currentFolderIndex = 0;
+    const QHash<QString, QString> permanentFailures = fileOperations.deletePathsPermanently(untrashable);
+    for (const QString &path : std::as_const(untrashable)) {
+        auto it = permanentFailures.constFind(path);
+        if (it == permanentFailures.constEnd()) {
+            failures.remove(path);
+            ++*permanent;
+        } else {
+            failures.insert(path, it.value());
+        }
+    }
+    return failures;
+}
 
-    qDebug() << "Folders found:" << folders;
+void MainWindow::showFailures(const QString &action, const QStringList &paths, const QHash<QString, QString> &failures)
+{
+    if (failures.isEmpty()) return;
 
-    if (!folders.isEmpty()) {
-        ui->status->setText(QString("Found %1 folders").arg(folders.size()));
-        updateFolderDisplay();
+    QMessageBox msg(this);
+    msg.setIcon(QMessageBox::Critical);
+    msg.setWindowTitle("Error");
+    if (paths.size() == 1) {
+        msg.setText(QString("Failed to %1 %2: %3").arg(action, QFileInfo(paths.first()).fileName(), failures.value(paths.first())));
     } else {
-        ui->status->setText("No folders found");
-        ui->folder_info->setText("No folders found");
-        updateButtonStates();
+        QStringList details;
+        for (const QString &path : paths) {
+            auto it = failures.constFind(path);
+            if (it != failures.constEnd()) {
+                details.append(QString("%1: %2").arg(path, it.value()));
+            }
+        }
+        msg.setText(QString("Failed to %1 %2 of %3 items").arg(action).arg(failures.size()).arg(paths.size()));
+        msg.setDetailedText(details.join("\n"));
     }
+    msg.exec();
 }
 
 void MainWindow::updateFolderDisplay()
@@ -121,117 +967,484 @@ void MainWindow::updateFolderDisplay()
     if (folders.isEmpty()) {
         ui->folder_info->setText("No folders found");
         mediaFiles.clear();
+        thumbnailModel.setFolder(QString(), mediaFiles);
         currentMediaIndex = 0;
         updateMediaDisplay();
         updateButtonStates();
         return;
     }
 
-    QString currentFolder = folders[currentFolderIndex];
-    QString folderName = QFileInfo(currentFolder).fileName();
-    ui->folder_info->setText(QString("%1 (%2/%3)").arg(folderName).arg(currentFolderIndex + 1).arg(folders.size()));
-
-    qDebug() << "Loading media files from folder:" << currentFolder;
+    QString currentFolder = folderPath(currentFolderIndex);
+    updateFolderInfo();
 
     // Load media files
-    mediaFiles = fileOperations.getMediaFiles(currentFolder, supportedExtensions);
+    if (browsingResults) {
+        mediaFiles = resultGroups[currentFolderIndex];
+    } else {
+        mediaFiles = listMediaFiles(currentFolder);
+    }
+    thumbnailModel.setFolder(mediaFolder(), mediaFiles);
+    loadFolderMetadata();
 
-    qDebug() << "Media files found:" << mediaFiles;
+    qCDebug(lcDisplay) << "Showing" << mediaFiles.size() << "media files from" << currentFolder;
 
     currentMediaIndex = 0;
     updateMediaDisplay();
     updateButtonStates();
 }
 
+void MainWindow::extractMetadata()
+{
+    if (metadataExtractor || folders.isEmpty() || browsingResults) return;
+
+    MetadataExtractor *extractor = new MetadataExtractor(folderPaths(folders), &catalog, supportedExtensions, this);
+    metadataExtractor = extractor;
+    connect(extractor, &QThread::finished, this, [this, extractor]() {
+        if (metadataExtractor == extractor) {
+            metadataExtractor = nullptr;
+        }
+        extractor->deleteLater();
+        if (extractor->extractedCount() > 0) {
+            mediaIndexStale = true;
+        }
+        if (extractor->extractedCount() > 0 && !browsingResults) {
+            loadFolderMetadata();
+            updateMediaInfo();
+        }
+    });
+    extractor->start(QThread::LowPriority);
+}
+
+void MainWindow::stopMetadataExtraction()
+{
+    // Orphan it like a replaced scan: its finished() handler only cleans up after
+    // itself, and Catalog serializes its last write with those of the next one
+    if (!metadataExtractor) return;
+    metadataExtractor->requestInterruption();
+    metadataExtractor = nullptr;
+}
+
+void MainWindow::loadFolderMetadata()
+{
+    folderMetadata.clear();
+    sniffedTypes.clear();
+    if (browsingResults || folders.isEmpty()) return;
+
+    CatalogEntry entry;
+    if (!catalog.find(QDir(folderPath(currentFolderIndex)).path(), entry)) return;
+    for (const CatalogMediaFile &file : std::as_const(entry.mediaFiles)) {
+        if (file.hasMetadata) {
+            folderMetadata.insert(file.name, file.metadata);
+        }
+    }
+}
+
+void MainWindow::updateFolderInfo()
+{
+    if (folders.isEmpty()) return;
+
+    const PathTree::Id folder = folders[currentFolderIndex];
+    QString folderName = pathTree.name(folder);
+    QString text = QString("%1 (%2/%3)").arg(folderName).arg(currentFolderIndex + 1).arg(folders.size());
+    if (!browsingResults && folderStats.isKnown(folder)) {
+        // Counted by the scan, so showing them lists nothing
+        const MediaTotals own = folderStats.own(folder);
+        const MediaTotals subtree = folderStats.subtree(folder);
+        text += " - " + describeMedia(own);
+        if (subtree.files() > own.files()) {
+            text += QString(", %1 with subfolders").arg(describeMedia(subtree));
+        }
+    }
+    if (!markedFolders.isEmpty()) {
+        text = QString("%1%2 - %3 marked").arg(markedFolders.contains(folders[currentFolderIndex]) ? "* " : "", text)
+                   .arg(markedFolders.size());
+    }
+    ui->folder_info->setText(text);
+}
+
 void MainWindow::updateMediaDisplay()
 {
+    animationPlayer.stop();
     if (mediaFiles.isEmpty()) {
+        showZoomView(false);
         ui->media_info->setText("No media files");
-        ui->media_display->setText("No media selected");
-        ui->media_display->setPixmap(QPixmap());
+        ui->media_display->showMessage("No media selected");
         ui->play_btn->setEnabled(false);
         ui->media_display->setCursor(Qt::ArrowCursor);
-        qDebug() << "No media files to display";
         return;
     }
 
     QString currentFile = mediaFiles[currentMediaIndex];
-    QString currentFolder = folders[currentFolderIndex];
-    QString mediaPath = currentFolder + "/" + currentFile;
-
-    qDebug() << "Displaying media file:" << mediaPath;
+    QString mediaPath = currentMediaPath();
 
     // Check if video
-    QString ext = QFileInfo(currentFile).suffix().toLower();
-    bool isVideo = configManager.getVideoExtensions().contains("." + ext);
-
-    qDebug() << "File extension:" << ext << "Is video:" << isVideo;
+    bool isVideo = isVideoFile(mediaPath);
+    qCDebug(lcDisplay) << "Displaying" << (isVideo ? "video" : "image") << mediaPath;
 
     // Load media
     if (isVideo) {
-        // For video, show a placeholder or filename
-        ui->media_display->setText("Video: " + currentFile + "\n\nClick to play");
+        showZoomView(false);
+        // Show the filename until the poster frame arrives
+        ui->media_display->showMessage("Video: " + currentFile + "\n\nClick to play");
         ui->media_display->setCursor(Qt::PointingHandCursor);
+        thumbnailStore.request(mediaPath);
     } else {
-        // For images, load and display the image
-        QPixmap pixmap(mediaPath);
-        if (!pixmap.isNull()) {
-            QPixmap scaled = pixmap.scaled(ui->media_display->size(), Qt::KeepAspectRatio, Qt::SmoothTransformation);
-            ui->media_display->setPixmap(scaled);
-            ui->media_display->setText("");
-            qDebug() << "Image loaded successfully";
+        if (isZoomed() && !zoomView->setImage(mediaPath)) {
+            showZoomView(false);
+        }
+        // Images come from the decode-ahead cache; a miss is decoded in the background
+        imageCache.setTargetSize(ui->media_display->contentsRect().size());
+        QImage image;
+        if (imageCache.lookup(mediaPath, image)) {
+            showImage(image);
         } else {
-            ui->media_display->setText("Failed to load image: " + currentFile);
-            qDebug() << "Failed to load image:" << mediaPath;
+            imageCache.request(mediaPath);
+            // Until the decode arrives, our own thumbnail; the camera's embedded
+            // preview replaces it if the decode pool finds one
+            QImage preview;
+            thumbnailStore.findCurrent(mediaPath, preview);
+            if (preview.isNull()) {
+                ui->media_display->showMessage("Loading " + currentFile + "...");
+            } else {
+                showImage(preview);
+            }
         }
+        playIfAnimated(mediaPath);
         ui->media_display->setCursor(Qt::ArrowCursor);
     }
 
-    ui->media_info->setText(QString("%1 (%2/%3)").arg(currentFile).arg(currentMediaIndex + 1).arg(mediaFiles.size()));
+    prefetchAroundCurrent();
+    syncGridSelection();
+
+    updateMediaInfo();
     ui->play_btn->setEnabled(isVideo);
     updateButtonStates();
 }
 
+void MainWindow::updateMediaInfo()
+{
+    if (mediaFiles.isEmpty()) return;
+
+    QString currentFile = mediaFiles[currentMediaIndex];
+    QString text = QString("%1 (%2/%3)").arg(currentFile).arg(currentMediaIndex + 1).arg(mediaFiles.size());
+
+    // Whatever the headers told, once the background extraction got to it
+    auto it = folderMetadata.constFind(currentFile);
+    if (it != folderMetadata.constEnd()) {
+        QStringList details;
+        if (it->width > 0 && it->height > 0) {
+            details.append(QString("%1x%2").arg(it->width).arg(it->height));
+        }
+        if (it->duration > 0) {
+            const qint64 seconds = it->duration / 1000;
+            details.append(QString("%1:%2").arg(seconds / 60).arg(seconds % 60, 2, 10, QChar('0')));
+        }
+        if (it->captureTime != 0) {
+            details.append(QDateTime::fromMSecsSinceEpoch(it->captureTime, Qt::UTC).toString("yyyy-MM-dd HH:mm"));
+        }
+        if (!it->camera.isEmpty()) {
+            details.append(it->camera);
+        }
+        if (!it->codec.isEmpty()) {
+            details.append(it->codec);
+        }
+        if (!details.isEmpty()) {
+            text += " - " + details.join(", ");
+        }
+    }
+    ui->media_info->setText(text);
+}
+
+QString MainWindow::folderPath(int index) const
+{
+    return pathTree.path(folders[index]);
+}
+
+QStringList MainWindow::folderPaths(const QVector<PathTree::Id> &ids) const
+{
+    QStringList paths;
+    paths.reserve(ids.size());
+    for (PathTree::Id id : ids) {
+        paths.append(pathTree.path(id));
+    }
+    return paths;
+}
+
+void MainWindow::appendFolders(QVector<PathTree::Id> &ids, const QStringList &paths)
+{
+    ids.reserve(ids.size() + paths.size());
+    for (const QString &path : paths) {
+        ids.append(pathTree.insert(path));
+    }
+    mediaFoldersStale = true;
+}
+
+void MainWindow::onMediaCounted(const QStringList &paths, const QVector<MediaTotals> &totals)
+{
+    for (int i = 0; i < paths.size(); ++i) {
+        folderStats.set(pathTree, pathTree.insert(paths[i]), totals[i]);
+    }
+    mediaFoldersStale = true;
+    if (!browsingResults && !folders.isEmpty()) {
+        updateFolderInfo();
+        updateButtonStates();
+    }
+}
+
+// Recounts folders that changed outside of a scan
+void MainWindow::countFolderMedia(const QStringList &paths)
+{
+    for (const QString &path : paths) {
+        const PathTree::Id folder = pathTree.find(path);
+        if (folder != PathTree::NoId) {
+            folderStats.set(pathTree, folder, MediaTotals::of(fileOperations.getMediaFileInfo(path, supportedExtensions)));
+        }
+    }
+    mediaFoldersStale = true;
+}
+
+bool MainWindow::folderHasMedia(int index) const
+{
+    // Folders not counted yet are assumed to have some
+    const PathTree::Id folder = folders[index];
+    return !folderStats.isKnown(folder) || folderStats.own(folder).files() > 0;
+}
+
+int MainWindow::adjacentFolder(int step) const
+{
+    if (browsingResults || !ui->media_only_cb->isChecked()) {
+        const int index = currentFolderIndex + step;
+        return index >= 0 && index < folders.size() ? index : -1;
+    }
+
+    const int count = folders.size();
+    if (mediaFoldersStale || nextMediaFolder.size() != count + 1) {
+        nextMediaFolder.resize(count + 1);
+        previousMediaFolder.resize(count + 1);
+        nextMediaFolder[count] = -1;
+        for (int i = count - 1; i >= 0; --i) {
+            nextMediaFolder[i] = folderHasMedia(i) ? i : nextMediaFolder[i + 1];
+        }
+        previousMediaFolder[0] = -1;
+        for (int i = 1; i <= count; ++i) {
+            previousMediaFolder[i] = folderHasMedia(i - 1) ? i - 1 : previousMediaFolder[i - 1];
+        }
+        mediaFoldersStale = false;
+    }
+    return step > 0 ? nextMediaFolder[currentFolderIndex + 1] : previousMediaFolder[currentFolderIndex];
+}
+
+void MainWindow::skipToMediaFolder()
+{
+    // Leaves an empty folder for the nearest one with media, looking ahead first
+    if (browsingResults || folders.isEmpty() || !ui->media_only_cb->isChecked()
+        || folderHasMedia(currentFolderIndex)) {
+        return;
+    }
+    int index = adjacentFolder(1);
+    if (index < 0) {
+        index = adjacentFolder(-1);
+    }
+    if (index >= 0) {
+        imageCache.cancelPending();
+        currentFolderIndex = index;
+        updateFolderDisplay();
+    }
+}
+
+QString MainWindow::mediaFolder() const
+{
+    // Empty while browsing result groups, whose entries are full paths
+    return browsingResults || folders.isEmpty() ? QString() : folderPath(currentFolderIndex);
+}
+
+QString MainWindow::mediaPath(int index) const
+{
+    if (browsingResults) return mediaFiles[index];
+    return pathTree.childPath(folders[currentFolderIndex], mediaFiles[index]);
+}
+
+QString MainWindow::currentMediaPath() const
+{
+    if (mediaFiles.isEmpty() || folders.isEmpty()) return QString();
+    return mediaPath(currentMediaIndex);
+}
+
+bool MainWindow::isVideoFile(const QString &path) const
+{
+    const MediaType type = MediaClassifier::typeOf(path);
+    if (type != MediaType::Unknown) return type == MediaType::Video;
+
+    // Listed by its content; sniff once per file
+    auto sniffed = sniffedTypes.constFind(path);
+    if (sniffed == sniffedTypes.constEnd()) {
+        sniffed = sniffedTypes.insert(path, MediaClassifier::sniffFile(path));
+    }
+    return *sniffed == MediaType::Video;
+}
+
+bool MainWindow::isZoomed() const
+{
+    return ui->media_stack->currentWidget() == zoomView;
+}
+
+void MainWindow::showZoomView(bool show)
+{
+    if (show == isZoomed()) return;
+
+    if (!show) {
+        zoomView->clear();
+        ui->media_stack->setCurrentWidget(ui->single_page);
+        ui->status->setText("");
+        setFocus();
+        const QString path = currentMediaPath();
+        if (!path.isEmpty() && !isVideoFile(path)) {
+            playIfAnimated(path);
+        }
+        return;
+    }
+
+    const QString path = currentMediaPath();
+    if (path.isEmpty() || isVideoFile(path) || ui->grid_btn->isChecked()) return;
+    if (!zoomView->setImage(path)) {
+        ui->status->setText("Cannot open for zooming: " + QFileInfo(path).fileName());
+        return;
+    }
+    animationPlayer.stop();
+    ui->media_stack->setCurrentWidget(zoomView);
+    zoomView->setFocus();
+}
+
+void MainWindow::onPosterReady(const QString &path, const QImage &poster)
+{
+    if (poster.isNull() || path != currentMediaPath() || !isVideoFile(path)) return;
+
+    ui->media_display->setImage(poster, true);
+}
+
+void MainWindow::showImage(const QImage &image)
+{
+    ui->media_display->setImage(image, false);
+}
+
+void MainWindow::playIfAnimated(const QString &path)
+{
+    // Frames replace the still as they are decoded; only while the single view shows
+    if (ui->media_stack->currentWidget() != ui->single_page || !AnimationPlayer::canAnimate(path)) return;
+    animationPlayer.play(path, ui->media_display->contentsRect().size());
+}
+
+void MainWindow::prefetchAroundCurrent()
+{
+    // Nearest neighbours first, alternating forward and backward
+    const int ahead = configManager.getPrefetchAhead();
+    const int behind = configManager.getPrefetchBehind();
+    QStringList paths;
+    for (int distance = 1; distance <= qMax(ahead, behind); ++distance) {
+        int next = currentMediaIndex + distance;
+        int previous = currentMediaIndex - distance;
+        if (distance <= ahead && next < mediaFiles.size() && !isVideoFile(mediaPath(next))) {
+            paths.append(mediaPath(next));
+        }
+        if (distance <= behind && previous >= 0 && !isVideoFile(mediaPath(previous))) {
+            paths.append(mediaPath(previous));
+        }
+    }
+    imageCache.prefetch(paths);
+}
+
+void MainWindow::onImageReady(const QString &path, const QImage &image)
+{
+    if (path != currentMediaPath()) return;
+
+    if (image.isNull()) {
+        ui->media_display->showMessage("Failed to load image: " + QFileInfo(path).fileName());
+        qCWarning(lcDecode) << "Failed to load image:" << path;
+    } else {
+        showImage(image);
+    }
+}
+
+void MainWindow::syncGridSelection()
+{
+    if (!ui->grid_btn->isChecked() || mediaFiles.isEmpty()) return;
+
+    QModelIndex index = thumbnailModel.index(currentMediaIndex);
+    if (ui->thumbnail_grid->currentIndex() != index) {
+        ui->thumbnail_grid->setCurrentIndex(index);
+        ui->thumbnail_grid->scrollTo(index);
+    }
+}
+
+void MainWindow::on_grid_btn_toggled(bool checked)
+{
+    if (checked) {
+        showZoomView(false);
+        animationPlayer.stop();
+    }
+    ui->media_stack->setCurrentWidget(checked ? ui->grid_page : ui->single_page);
+    if (checked) {
+        syncGridSelection();
+        ui->thumbnail_grid->setFocus();
+    } else {
+        // The label may have been resized while hidden
+        updateMediaDisplay();
+        setFocus();
+    }
+}
+
 void MainWindow::on_prev_folder_btn_clicked()
 {
-    if (currentFolderIndex > 0) {
-        currentFolderIndex--;
+    const int index = adjacentFolder(-1);
+    if (index >= 0) {
+        imageCache.cancelPending();
+        currentFolderIndex = index;
         updateFolderDisplay();
     }
 }
 
 void MainWindow::on_next_folder_btn_clicked()
 {
-    if (currentFolderIndex < folders.size() - 1) {
-        currentFolderIndex++;
+    const int index = adjacentFolder(1);
+    if (index >= 0) {
+        imageCache.cancelPending();
+        currentFolderIndex = index;
         updateFolderDisplay();
     }
 }
 
 void MainWindow::on_delete_folder_btn_clicked()
 {
-    if (folders.isEmpty()) return;
+    if (folders.isEmpty() || browsingResults) return;
 
-    QString folderToDelete = folders[currentFolderIndex];
-    QString folderName = QFileInfo(folderToDelete).fileName();
+    const QStringList paths = selectedFolderPaths();
+    QString folderName = QFileInfo(paths.first()).fileName();
 
     if (!ui->skip_confirm_cb->isChecked()) {
-        QMessageBox::StandardButton reply = QMessageBox::question(this, "Delete Folder",
-                                                                  QString("Delete folder \"%1\" and all contents?").arg(folderName),
+        QString question = paths.size() == 1 ? QString("Delete folder \"%1\" and all contents?").arg(folderName)
+                                             : QString("Delete %1 marked folders and all their contents?").arg(paths.size());
+        QMessageBox::StandardButton reply = QMessageBox::question(this, "Delete Folder", question,
                                                                   QMessageBox::Yes | QMessageBox::No, QMessageBox::No);
         if (reply != QMessageBox::Yes) return;
     }
 
-    if (fileOperations.deleteFolder(folderToDelete)) {
-        folders.removeAt(currentFolderIndex);
-        if (currentFolderIndex >= folders.size()) {
-            currentFolderIndex = qMax(0, folders.size() - 1);
+    int permanent = 0;
+    const QHash<QString, QString> failures = deletePaths(paths, &permanent);
+    QStringList deleted;
+    for (const QString &path : paths) {
+        if (!failures.contains(path)) {
+            deleted.append(path);
         }
-        updateFolderDisplay();
-        ui->status->setText(QString("Deleted folder: %1").arg(folderName));
-    } else {
-        showMessage(QString("Failed to delete folder: %1").arg(folderName), true);
     }
+    // Drops their subfolders from the list as well
+    removeFolders(deleted);
+    const QString undoHint = deleted.size() > permanent ? " (Ctrl+Z to undo)" : "";
+    if (deleted.size() == 1) {
+        ui->status->setText(QString("Deleted folder: %1%2").arg(QFileInfo(deleted.first()).fileName(), undoHint));
+    } else if (!deleted.isEmpty()) {
+        ui->status->setText(QString("Deleted %1 folders%2").arg(deleted.size()).arg(undoHint));
+    }
+    showFailures("delete", paths, failures);
 }
 
 void MainWindow::on_prev_media_btn_clicked()
@@ -254,9 +1467,7 @@ void MainWindow::on_play_btn_clicked()
 {
     if (mediaFiles.isEmpty()) return;
 
-    QString currentFile = mediaFiles[currentMediaIndex];
-    QString currentFolder = folders[currentFolderIndex];
-    QString filePath = currentFolder + "/" + currentFile;
+    QString filePath = currentMediaPath();
 
     if (!fileOperations.openFile(filePath)) {
         showMessage("Failed to play video", true);
@@ -267,26 +1478,171 @@ void MainWindow::on_delete_media_btn_clicked()
 {
     if (mediaFiles.isEmpty()) return;
 
-    QString currentFile = mediaFiles[currentMediaIndex];
-    QString currentFolder = folders[currentFolderIndex];
-    QString filePath = currentFolder + "/" + currentFile;
+    const QStringList paths = selectedMediaPaths();
+    QString currentFile = QFileInfo(paths.first()).fileName();
 
     if (!ui->skip_confirm_cb->isChecked()) {
-        QMessageBox::StandardButton reply = QMessageBox::question(this, "Delete Media",
-                                                                  QString("Delete \"%1\"?").arg(currentFile),
+        QString question = paths.size() == 1 ? QString("Delete \"%1\"?").arg(currentFile)
+                                             : QString("Delete %1 selected files?").arg(paths.size());
+        QMessageBox::StandardButton reply = QMessageBox::question(this, "Delete Media", question,
                                                                   QMessageBox::Yes | QMessageBox::No, QMessageBox::No);
         if (reply != QMessageBox::Yes) return;
     }
 
-    if (fileOperations.deleteFile(filePath)) {
-        mediaFiles.removeAt(currentMediaIndex);
-        if (currentMediaIndex >= mediaFiles.size()) {
-            currentMediaIndex = qMax(0, mediaFiles.size() - 1);
+    int permanent = 0;
+    const QHash<QString, QString> failures = deletePaths(paths, &permanent);
+    removeMediaFiles(paths, failures);
+    const int deleted = paths.size() - failures.size();
+    const QString undoHint = deleted > permanent ? " (Ctrl+Z to undo)" : "";
+    if (deleted == 1 && paths.size() == 1) {
+        ui->status->setText(QString("Deleted: %1%2").arg(currentFile, undoHint));
+    } else if (deleted > 0) {
+        ui->status->setText(QString("Deleted %1 files%2").arg(deleted).arg(undoHint));
+    }
+    showFailures("delete", paths, failures);
+}
+
+void MainWindow::on_dupes_btn_clicked()
+{
+    if (duplicateFinder) return;
+    const QVector<PathTree::Id> &scannedFolders = browsingResults ? savedFolders : folders;
+    if (scannedFolders.isEmpty()) {
+        showMessage("Please scan folders first", true);
+        return;
+    }
+
+    duplicateFinder = new DuplicateFinder(folderPaths(scannedFolders), &catalog, supportedExtensions, this);
+    ui->dupes_btn->setEnabled(false);
+    ui->status->setText("Finding duplicates...");
+
+    DuplicateFinder *finder = duplicateFinder;
+    connect(finder, &DuplicateFinder::progress, this, [this](const QString &stage, qint64 done, qint64 total) {
+        showSearchProgress("Finding duplicates", stage, done, total);
+    });
+    connect(finder, &QThread::finished, this, [this, finder]() {
+        onDuplicatesFound(finder);
+    });
+    finder->start(QThread::LowPriority);
+}
+
+void MainWindow::onDuplicatesFound(DuplicateFinder *finder)
+{
+    duplicateFinder = nullptr;
+    finder->deleteLater();
+    ui->dupes_btn->setEnabled(true);
+
+    if (!finder->isCompleted()) {
+        ui->status->setText("Duplicate search cancelled");
+        return;
+    }
+
+    const QVector<DuplicateGroup> groups = finder->groups();
+    if (groups.isEmpty()) {
+        ui->status->setText("No duplicate files found");
+        return;
+    }
+    ui->status->setText(QString("Found %1 groups of duplicate files").arg(groups.size()));
+
+    DuplicatesDialog dialog(groups, &fileOperations, !ui->skip_confirm_cb->isChecked(), this);
+    connect(&dialog, &DuplicatesDialog::filesDeleted, this, &MainWindow::onMediaChanged);
+    dialog.exec();
+}
+
+void MainWindow::on_similar_btn_clicked()
+{
+    if (browsingResults) {
+        leaveResultGroups();
+        return;
+    }
+    if (similarityFinder) return;
+    if (folders.isEmpty()) {
+        showMessage("Please scan folders first", true);
+        return;
+    }
+
+    similarityFinder = new SimilarityFinder(folderPaths(folders), &catalog, supportedExtensions,
+                                            configManager.getSimilarityThreshold(), this);
+    ui->similar_btn->setEnabled(false);
+    ui->status->setText("Finding similar images...");
+
+    SimilarityFinder *finder = similarityFinder;
+    connect(finder, &SimilarityFinder::progress, this, [this](const QString &stage, qint64 done, qint64 total) {
+        showSearchProgress("Finding similar images", stage, done, total);
+    });
+    connect(finder, &QThread::finished, this, [this, finder]() {
+        onSimilarFound(finder);
+    });
+    finder->start(QThread::LowPriority);
+}
+
+void MainWindow::onSimilarFound(SimilarityFinder *finder)
+{
+    similarityFinder = nullptr;
+    finder->deleteLater();
+    ui->similar_btn->setEnabled(true);
+
+    if (!finder->isCompleted()) {
+        ui->status->setText("Similar image search cancelled");
+        return;
+    }
+
+    const QVector<QStringList> groups = finder->groups();
+    if (groups.isEmpty()) {
+        ui->status->setText("No similar images found");
+        return;
+    }
+    showResultGroups(groups, "Similar images");
+    ui->status->setText(QString("Found %1 groups of similar images").arg(groups.size()));
+}
+
+void MainWindow::showResultGroups(const QVector<QStringList> &groups, const QString &label)
+{
+    // Scans and folder changes while browsing apply once the folders are back
+    if (!browsingResults) {
+        savedFolders = folders;
+        savedFolderIndex = currentFolderIndex;
+    }
+    browsingResults = true;
+    resultGroups = groups;
+    mediaFoldersStale = true;
+
+    // The group labels are single-component nodes of their own
+    folders.clear();
+    for (int i = 0; i < resultGroups.size(); ++i) {
+        folders.append(pathTree.insert(resultGroups.size() == 1 ? label : QString("%1 %2").arg(label).arg(i + 1)));
+    }
+    currentFolderIndex = 0;
+    ui->similar_btn->setText("Back to Folders");
+    imageCache.cancelPending();
+    updateFolderDisplay();
+}
+
+void MainWindow::leaveResultGroups()
+{
+    browsingResults = false;
+    resultGroups.clear();
+    folders = savedFolders;
+    savedFolders.clear();
+    mediaFoldersStale = true;
+    currentFolderIndex = qMax(0, qMin(savedFolderIndex, int(folders.size()) - 1));
+    ui->similar_btn->setText("Find Similar");
+    imageCache.cancelPending();
+    updateFolderDisplay();
+
+    if (foldersStale) {
+        foldersStale = false;
+        if (!folderScanner) {
+            scanFolders(true);
         }
-        updateMediaDisplay();
-        ui->status->setText(QString("Deleted: %1").arg(currentFile));
+    }
+}
+
+void MainWindow::showSearchProgress(const QString &task, const QString &stage, qint64 done, qint64 total)
+{
+    if (total > 0) {
+        ui->status->setText(QString("%1: %2... %3% (Esc to cancel)").arg(task, stage).arg(done * 100 / total));
     } else {
-        showMessage(QString("Failed to delete: %1").arg(currentFile), true);
+        ui->status->setText(QString("%1: %2... (Esc to cancel)").arg(task, stage));
     }
 }
 
@@ -303,6 +1659,25 @@ void MainWindow::keyPressEvent(QKeyEvent *event)
 {
     bool ctrl = event->modifiers() & Qt::ControlModifier;
 
+    if (event->key() == Qt::Key_F12) {
+        if (!debugPanel) {
+            debugPanel = new DebugPanel(this);
+        }
+        debugPanel->setVisible(!debugPanel->isVisible());
+        return;
+    }
+
+    // Number keys send media to their target folder; with Ctrl they pick that folder
+    if (event->key() >= Qt::Key_1 && event->key() <= Qt::Key_9) {
+        const int key = event->key() - Qt::Key_0;
+        if (ctrl) {
+            bindTransferTarget(key);
+        } else {
+            sendToTarget(key);
+        }
+        return;
+    }
+
     // Folder navigation with Ctrl
     if (ctrl) {
         switch (event->key()) {
@@ -315,6 +1690,15 @@ void MainWindow::keyPressEvent(QKeyEvent *event)
         case Qt::Key_Delete:
             on_delete_folder_btn_clicked();
             break;
+        case Qt::Key_Z:
+            undoDelete();
+            break;
+        case Qt::Key_Space:
+            toggleFolderMark();
+            break;
+        case Qt::Key_M:
+            moveSelectedFolders();
+            break;
         default:
             QMainWindow::keyPressEvent(event);
         }
@@ -333,6 +1717,30 @@ void MainWindow::keyPressEvent(QKeyEvent *event)
         case Qt::Key_Space:
             on_play_btn_clicked();
             break;
+        case Qt::Key_M:
+            moveSelectedMedia();
+            break;
+        case Qt::Key_Z:
+            showZoomView(!isZoomed());
+            break;
+        case Qt::Key_Escape:
+            if (isZoomed()) {
+                showZoomView(false);
+            } else if (folderScanner) {
+                cancelScan();
+                onScanFinished(true);
+            } else if (duplicateFinder || similarityFinder) {
+                if (duplicateFinder) duplicateFinder->requestInterruption();
+                if (similarityFinder) similarityFinder->requestInterruption();
+            } else if (!markedFolders.isEmpty()) {
+                markedFolders.clear();
+                updateFolderInfo();
+            } else if (!mediaQuery.isEmpty()) {
+                clearFilter();
+            } else {
+                QMainWindow::keyPressEvent(event);
+            }
+            break;
         default:
             QMainWindow::keyPressEvent(event);
         }
@@ -345,9 +1753,10 @@ void MainWindow::updateButtonStates()
     bool hasMedia = !mediaFiles.isEmpty();
 
     // Folder buttons
-    ui->prev_folder_btn->setEnabled(hasFolders && currentFolderIndex > 0);
-    ui->next_folder_btn->setEnabled(hasFolders && currentFolderIndex < folders.size() - 1);
-    ui->delete_folder_btn->setEnabled(hasFolders);
+    ui->prev_folder_btn->setEnabled(hasFolders && adjacentFolder(-1) >= 0);
+    ui->next_folder_btn->setEnabled(hasFolders && adjacentFolder(1) >= 0);
+    ui->delete_folder_btn->setEnabled(hasFolders && !browsingResults);
+    ui->grid_btn->setEnabled(hasFolders);
 
     // Media buttons
     ui->prev_media_btn->setEnabled(hasMedia && currentMediaIndex > 0);
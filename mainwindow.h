@@ -4,9 +4,24 @@
 #include <QMainWindow>
 #include <QStringList>
 #include <QMap>
+#include <QSet>
 #include "configmanager.h"
 #include "fileoperations.h"
-// Remove: #include "mediadisplay.h" - we don't need it anymore
+#include "folderscanner.h"
+#include "catalog.h"
+#include "folderwatcher.h"
+#include "imagecache.h"
+#include "animationplayer.h"
+#include "thumbnailstore.h"
+#include "thumbnailmodel.h"
+#include "duplicatefinder.h"
+#include "similarityfinder.h"
+#include "metadataextractor.h"
+#include "deletequeue.h"
+#include "transferqueue.h"
+#include "pathtree.h"
+#include "mediaindex.h"
+#include "folderstats.h"
 
 QT_BEGIN_NAMESPACE
 namespace Ui {
@@ -14,6 +29,9 @@ class MainWindow;
 }
 QT_END_NAMESPACE
 
+class DebugPanel;
+class TiledImageView;
+
 class MainWindow : public QMainWindow
 {
     Q_OBJECT
@@ -35,23 +53,141 @@ private slots:
     void on_next_media_btn_clicked();
     void on_play_btn_clicked();
     void on_delete_media_btn_clicked();
+    void on_grid_btn_toggled(bool checked);
+    void on_dupes_btn_clicked();
+    void on_similar_btn_clicked();
 
 private:
     Ui::MainWindow *ui;
     ConfigManager configManager;
+    Catalog catalog;
+    ThumbnailStore thumbnailStore;
+    ThumbnailModel thumbnailModel;
+    DeleteQueue deleteQueue;
+    TransferQueue transferQueue;
     FileOperations fileOperations;
 
     QString mainFolder;
-    QStringList folders;
+    // Folder list as IDs into pathTree; folderPath() builds the full path
+    PathTree pathTree;
+    QVector<PathTree::Id> folders;
     int currentFolderIndex;
     QStringList mediaFiles;
     int currentMediaIndex;
     QStringList supportedExtensions;
 
+    // Background scan; scanGeneration lets late batches from a replaced scan be ignored
+    FolderScanner *folderScanner = nullptr;
+    int scanGeneration = 0;
+    // Set while a scan re-validates a folder list that was loaded from the catalog
+    bool refreshingFolders = false;
+    QVector<PathTree::Id> refreshedFolders;
+    // Media totals per folder, from scans and kept current by the watcher
+    FolderStats folderStats;
+    // Nearest folder with media after index i - 1 and before index i, for
+    // "Skip empty"; rebuilt on use after the folders or their totals change
+    mutable QVector<int> nextMediaFolder;
+    mutable QVector<int> previousMediaFolder;
+    mutable bool mediaFoldersStale = true;
+    bool scanRecursive = false;
+
+    DuplicateFinder *duplicateFinder = nullptr;
+
+    // Fills in the catalog's header metadata after every scan
+    MetadataExtractor *metadataExtractor = nullptr;
+    // Metadata of the current folder's files by name, from the catalog
+    QHash<QString, MediaMetadata> folderMetadata;
+    // Types of listed files without a media extension, by path
+    mutable QHash<QString, MediaType> sniffedTypes;
+
+    // Result groups (similar images, library-wide filter matches) stand in
+    // for the folder list while browsed; mediaFiles then holds full paths
+    SimilarityFinder *similarityFinder = nullptr;
+    bool browsingResults = false;
+    QVector<QStringList> resultGroups;
+    QVector<PathTree::Id> savedFolders;
+    int savedFolderIndex = 0;
+    bool foldersStale = false;
+
+    // Filter from filter_entry; applies to each folder's listing, or with
+    // "All folders" runs once over mediaIndex and shows the matches as a group
+    MediaQuery mediaQuery;
+    MediaIndex mediaIndex;
+    bool mediaIndexStale = true;
+    QThread *indexBuilder = nullptr;
+
+    // Folders marked with Ctrl+Space; folder delete and move act on these when there are any
+    QSet<PathTree::Id> markedFolders;
+
+    FolderWatcher folderWatcher;
+    ImageCache imageCache;
+    // Animated GIF and WebP in the single media view
+    AnimationPlayer animationPlayer;
+    DebugPanel *debugPanel = nullptr;
+    // Third page of media_stack: the current image at any zoom
+    TiledImageView *zoomView = nullptr;
+
     void updateFolderDisplay();
+    void updateFolderInfo();
     void updateMediaDisplay();
+    void updateMediaInfo();
+    QString folderPath(int index) const;
+    QStringList folderPaths(const QVector<PathTree::Id> &ids) const;
+    void appendFolders(QVector<PathTree::Id> &ids, const QStringList &paths);
+    void onMediaCounted(const QStringList &paths, const QVector<MediaTotals> &totals);
+    void countFolderMedia(const QStringList &paths);
+    bool folderHasMedia(int index) const;
+    // Index of the folder the previous (-1) or next (1) button goes to, or -1
+    int adjacentFolder(int step) const;
+    void skipToMediaFolder();
+    QString mediaFolder() const;
+    QString mediaPath(int index) const;
+    QString currentMediaPath() const;
+    bool isVideoFile(const QString &path) const;
+    bool isZoomed() const;
+    void showZoomView(bool show);
+    void showImage(const QImage &image);
+    void playIfAnimated(const QString &path);
+    void prefetchAroundCurrent();
+    void onImageReady(const QString &path, const QImage &image);
+    void onPosterReady(const QString &path, const QImage &poster);
+    void syncGridSelection();
     void updateButtonStates();
-    void scanFolders();
+    void scanFolders(bool refresh = false);
+    void cancelScan();
+    void onFoldersFound(const QStringList &batch);
+    void onScanFinished(bool cancelled);
+    void applyRefreshedFolders();
+    void onFoldersAdded(const QStringList &subtree);
+    void onFolderRemoved(const QString &folder);
+    void removeFolders(const QStringList &removed);
+    void onMediaChanged(const QStringList &changedFolders);
+    void undoDelete();
+    QStringList selectedMediaPaths() const;
+    QStringList selectedFolderPaths() const;
+    void toggleFolderMark();
+    void removeMediaFiles(const QStringList &paths, const QHash<QString, QString> &failures);
+    QHash<QString, QString> deletePaths(const QStringList &paths, int *permanent);
+    void moveSelectedMedia();
+    void moveSelectedFolders();
+    void sendToTarget(int key);
+    bool bindTransferTarget(int key);
+    QStringList listMediaFiles(const QString &folder);
+    void applyFilter();
+    void clearFilter();
+    void buildMediaIndex();
+    void runLibraryQuery();
+    void onTransferFailed(const QString &source, bool copy, const QString &error);
+    void onTransferProgress(int pending, qint64 bytesDone, qint64 bytesTotal);
+    void showFailures(const QString &action, const QStringList &paths, const QHash<QString, QString> &failures);
+    void onDuplicatesFound(DuplicateFinder *finder);
+    void extractMetadata();
+    void stopMetadataExtraction();
+    void loadFolderMetadata();
+    void onSimilarFound(SimilarityFinder *finder);
+    void showResultGroups(const QVector<QStringList> &groups, const QString &label);
+    void leaveResultGroups();
+    void showSearchProgress(const QString &task, const QString &stage, qint64 done, qint64 total);
     void showMessage(const QString &text, bool critical = false);
 
     // Keyboard event handling
@@ -1,6 +1,5 @@
 #include "mediadisplay.h"
-#include <QPixmap>
-#include <QPainter>
+#include "tracer.h"
 #include <QColor>
 #include <QMouseEvent>
 #include <QResizeEvent>
@@ -18,87 +17,170 @@ MediaDisplay::MediaDisplay(QWidget *parent) : QLabel(parent)
             font-size: 14px;
         }
     )");
+
+    settleTimer.setSingleShot(true);
+    settleTimer.setInterval(150);
+    connect(&settleTimer, &QTimer::timeout, this, [this]() {
+        rescale();
+        emit resizeSettled();
+    });
+    pyramids.setMaxCost(64 * 1024 * 1024);
 }
 
-void MediaDisplay::setMedia(const QString &path, bool video)
+void MediaDisplay::setImage(const QImage &image, bool video)
 {
-    isVideo = video;
-    currentPath = path;
-
-    if (path.isEmpty() || !QFile::exists(path)) {
-        setText("No media selected");
-        currentPixmap = QPixmap();
+    if (image.isNull()) {
+        showMessage("No media to display");
         return;
     }
 
-    // Only reload if path changed
-    if (currentPixmap.isNull() || currentPath != path) {
-        currentPixmap.load(path);
-        if (currentPixmap.isNull()) {
-            setText("Failed to load media");
-            return;
+    isVideo = video;
+    setText(QString());
+    if (levels.isEmpty() || image.cacheKey() != imageKey) {
+        imageKey = image.cacheKey();
+        if (const QVector<QImage> *cached = pyramids.object(imageKey)) {
+            levels = *cached;
+        } else {
+            levels = {image};
+            // A full pyramid adds a third to the image
+            pyramids.insert(imageKey, new QVector<QImage>(levels), qMax<qsizetype>(image.sizeInBytes() * 4 / 3, 1));
         }
+        scaled = QPixmap();
     }
+    rescale();
+}
 
-    updatePixmap();
+void MediaDisplay::setFrame(const QImage &frame)
+{
+    isVideo = false;
+    setText(QString());
+    imageKey = 0;
+    levels = {frame};
+    scaled = QPixmap();
+    rescale();
 }
 
-void MediaDisplay::updatePixmap()
+void MediaDisplay::showMessage(const QString &text)
 {
-    if (currentPixmap.isNull()) {
-        setText("No media to display");
-        return;
+    isVideo = false;
+    imageKey = 0;
+    levels.clear();
+    scaled = QPixmap();
+    setText(text);
+}
+
+bool MediaDisplay::isUpscaled() const
+{
+    if (levels.isEmpty()) return false;
+
+    const QSize fitted = fittedSize();
+    return fitted.width() > levels[0].width() || fitted.height() > levels[0].height();
+}
+
+QSize MediaDisplay::fittedSize() const
+{
+    return levels[0].size().scaled(contentsRect().size(), Qt::KeepAspectRatio);
+}
+
+int MediaDisplay::levelFor(const QSize &size)
+{
+    // The smallest level still covering size, halving into new levels as needed
+    int level = 0;
+    for (;;) {
+        const QSize half(levels[level].width() / 2, levels[level].height() / 2);
+        if (half.width() < size.width() || half.height() < size.height() || half.isEmpty()) break;
+
+        if (level + 1 == levels.size()) {
+            levels.append(levels[level].scaled(half, Qt::IgnoreAspectRatio, Qt::SmoothTransformation));
+            if (QVector<QImage> *cached = pyramids.object(imageKey)) {
+                *cached = levels;
+            }
+        }
+        ++level;
     }
+    return level;
+}
+
+void MediaDisplay::rescale()
+{
+    if (levels.isEmpty()) return;
+
+    const QSize target = fittedSize();
+    if (target.isEmpty() || scaled.size() == target) return;
 
-    // Scale to fit while maintaining aspect ratio
-    QPixmap scaled = currentPixmap.scaled(size(), Qt::KeepAspectRatio, Qt::SmoothTransformation);
-    setPixmap(scaled);
+    TraceSpan span("scale", "image");
+    const QImage &source = levels[levelFor(target)];
+    scaled = QPixmap::fromImage(source.size() == target
+                                ? source
+                                : source.scaled(target, Qt::IgnoreAspectRatio, Qt::SmoothTransformation));
+    update();
 }
 
 void MediaDisplay::resizeEvent(QResizeEvent *event)
 {
     QLabel::resizeEvent(event);
-    if (!currentPixmap.isNull()) {
-        updatePixmap();
+    // Resizes arrive in bursts while the window is dragged; only the last gets the smooth pass
+    if (!levels.isEmpty()) {
+        settleTimer.start();
     }
 }
 
 void MediaDisplay::paintEvent(QPaintEvent *event)
 {
     QLabel::paintEvent(event);
+    if (levels.isEmpty()) return;
 
-    if (isVideo && !pixmap().isNull()) {
-        QPainter painter(this);
-        painter.setRenderHint(QPainter::Antialiasing);
+    const QSize target = fittedSize();
+    if (target.isEmpty()) return;
 
-        // Calculate center position
-        QRect rect = this->rect();
-        int size = qMin(rect.width(), rect.height()) / 6;
-        size = qMax(size, 40);
+    QRect area(QPoint(0, 0), target);
+    area.moveCenter(contentsRect().center());
 
-        int center_x = rect.center().x() - size / 2;
-        int center_y = rect.center().y() - size / 2;
-
-        // Draw play button background
-        painter.setPen(Qt::NoPen);
-        painter.setBrush(QColor(0, 0, 0, 120));
-        painter.drawEllipse(center_x, center_y, size, size);
-
-        // Draw play triangle
-        painter.setBrush(QColor(255, 255, 255, 200));
-        int triangle_size = size / 3;
-        int offset = 2;
-
-        QPoint center = rect.center();
-        QPolygon polygon;
-        polygon << QPoint(center.x() - triangle_size/2 + offset, center.y() - triangle_size/2)
-                << QPoint(center.x() - triangle_size/2 + offset, center.y() + triangle_size/2)
-                << QPoint(center.x() + triangle_size/2 + offset, center.y());
+    QPainter painter(this);
+    if (scaled.size() == target) {
+        painter.drawPixmap(area.topLeft(), scaled);
+    } else {
+        // Still resizing: the nearest level, unfiltered, until the size settles
+        painter.drawImage(area, levels[levelFor(target)]);
+    }
 
-        painter.drawPolygon(polygon);
+    if (isVideo) {
+        drawPlayOverlay(painter, area);
     }
 }
 
+void MediaDisplay::drawPlayOverlay(QPainter &painter, const QRect &rect)
+{
+    painter.save();
+    painter.setRenderHint(QPainter::Antialiasing);
+
+    // Calculate center position
+    int size = qMin(rect.width(), rect.height()) / 6;
+    size = qMax(size, 40);
+
+    int center_x = rect.center().x() - size / 2;
+    int center_y = rect.center().y() - size / 2;
+
+    // Draw play button background
+    painter.setPen(Qt::NoPen);
+    painter.setBrush(QColor(0, 0, 0, 120));
+    painter.drawEllipse(center_x, center_y, size, size);
+
+    // Draw play triangle
+    painter.setBrush(QColor(255, 255, 255, 200));
+    int triangle_size = size / 3;
+    int offset = 2;
+
+    QPoint center = rect.center();
+    QPolygon polygon;
+    polygon << QPoint(center.x() - triangle_size/2 + offset, center.y() - triangle_size/2)
+            << QPoint(center.x() - triangle_size/2 + offset, center.y() + triangle_size/2)
+            << QPoint(center.x() + triangle_size/2 + offset, center.y());
+
+    painter.drawPolygon(polygon);
+    painter.restore();
+}
+
 void MediaDisplay::mousePressEvent(QMouseEvent *event)
 {
     if (event->button() == Qt::LeftButton && isVideo) {
@@ -2,19 +2,42 @@
 #define MEDIADISPLAY_H
 
 #include <QLabel>
-#include <QFile>
+#include <QCache>
+#include <QImage>
 #include <QMouseEvent>
+#include <QPainter>
+#include <QPixmap>
+#include <QTimer>
+#include <QVector>
 
+// The single-image view. Each image is kept as a mipmap pyramid (every level
+// half the size of the one before, built on demand), so fitting it to a new
+// size starts from the nearest larger level rather than the whole image.
+// While the widget is being resized that level is drawn unfiltered; once the
+// size has settled one smooth pass produces the pixmap that is shown.
 class MediaDisplay : public QLabel
 {
     Q_OBJECT
 
 public:
     explicit MediaDisplay(QWidget *parent = nullptr);
-    void setMedia(const QString &path, bool isVideo);
+
+    // Shows image fitted to the widget, with a play button for video frames
+    void setImage(const QImage &image, bool isVideo);
+    // Shows one frame of an animation; unlike images, frames get no cached pyramid
+    void setFrame(const QImage &frame);
+    // Shows text in place of the image
+    void showMessage(const QString &text);
+    // The image is shown larger than it was decoded
+    bool isUpscaled() const;
+
+    // The play button drawn over video frames, centered in rect
+    static void drawPlayOverlay(QPainter &painter, const QRect &rect);
 
 signals:
-    void clicked();  // Make sure this is declared as a signal
+    void clicked();
+    // The widget has stopped changing size
+    void resizeSettled();
 
 protected:
     void paintEvent(QPaintEvent *event) override;
@@ -23,9 +46,17 @@ protected:
 
 private:
     bool isVideo = false;
-    QString currentPath;
-    QPixmap currentPixmap;
-    void updatePixmap();
+    qint64 imageKey = 0;     // QImage::cacheKey() of levels[0]
+    QVector<QImage> levels;  // levels[0] is the image as given
+    QPixmap scaled;          // the smooth fit for the settled size
+    QTimer settleTimer;
+
+    // Recently shown pyramids by image key, so paging back skips the rebuild
+    QCache<qint64, QVector<QImage>> pyramids;
+
+    QSize fittedSize() const;
+    int levelFor(const QSize &size);
+    void rescale();
 };
 
 #endif // MEDIADISPLAY_H
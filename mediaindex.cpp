@@ -0,0 +1,195 @@
+#include "mediaindex.h"
+#include "fileoperations.h"
+#include "parallel.h"
+#include <QThread>
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// Below this many rows per thread, starting threads costs more than it saves
+const int minRowsPerThread = 64 * 1024;
+
+// mask[i] &= low <= column[i] < high, written so the loop has no branches
+template <typename T>
+void andRange(const T *column, quint8 *mask, int begin, int end, qint64 low, qint64 high)
+{
+    for (int i = begin; i < end; ++i) {
+        const qint64 value = qint64(column[i]);
+        mask[i] &= quint8((value >= low) & (value < high));
+    }
+}
+
+} // namespace
+
+void MediaIndex::clear()
+{
+    folders.clear();
+    folderColumn.clear();
+    names.clear();
+    kinds.clear();
+    sizes.clear();
+    dates.clear();
+    durations.clear();
+    widths.clear();
+    heights.clear();
+}
+
+void MediaIndex::addFolder(const QString &folder, const QVector<CatalogMediaFile> &files)
+{
+    if (files.isEmpty()) return;
+
+    const quint32 folderIndex = quint32(folders.size());
+    folders.append(folder);
+    for (const CatalogMediaFile &file : files) {
+        const bool video = file.type == MediaType::Video;
+        folderColumn.append(folderIndex);
+        names.append(file.name);
+        kinds.append(quint8(video ? MediaQuery::Video : MediaQuery::Image));
+        sizes.append(file.size);
+        dates.append(file.hasMetadata && file.metadata.captureTime != 0 ? file.metadata.captureTime
+                                                                        : file.mtime / 1000000);
+        durations.append(file.hasMetadata ? file.metadata.duration : 0);
+        widths.append(file.hasMetadata ? file.metadata.width : 0);
+        heights.append(file.hasMetadata ? file.metadata.height : 0);
+    }
+}
+
+QString MediaIndex::path(int row) const
+{
+    const QString &folder = folders[int(folderColumn[row])];
+    return folder.endsWith('/') ? folder + names[row] : folder + "/" + names[row];
+}
+
+qint64 MediaIndex::value(MediaQuery::Field field, int row) const
+{
+    switch (field) {
+    case MediaQuery::Kind: return kinds[row];
+    case MediaQuery::Size: return sizes[row];
+    case MediaQuery::Date: return dates[row];
+    case MediaQuery::Width: return widths[row];
+    case MediaQuery::Height: return heights[row];
+    case MediaQuery::Pixels: return qMax(widths[row], heights[row]);
+    case MediaQuery::Duration: return durations[row];
+    case MediaQuery::Name: break;
+    }
+    return 0;
+}
+
+QVector<int> MediaIndex::query(const MediaQuery &query) const
+{
+    const int count = size();
+    std::vector<quint8> mask(size_t(count), 1);
+    std::vector<std::vector<int>> matches(size_t(qMax(1, QThread::idealThreadCount())));
+
+    // Each slice applies every term to its rows, then collects its matches
+    const int slices = forEachSlice(count, minRowsPerThread, [&](int begin, int end, int slice) {
+        quint8 *m = mask.data();
+        for (const MediaQuery::Range &range : query.ranges) {
+            // Header fields that are unknown (zero) never match
+            const bool needsValue = range.field == MediaQuery::Width || range.field == MediaQuery::Height
+                                    || range.field == MediaQuery::Pixels || range.field == MediaQuery::Duration;
+            const qint64 low = needsValue ? qMax<qint64>(range.low, 1) : range.low;
+            switch (range.field) {
+            case MediaQuery::Kind: andRange(kinds.constData(), m, begin, end, low, range.high); break;
+            case MediaQuery::Size: andRange(sizes.constData(), m, begin, end, low, range.high); break;
+            case MediaQuery::Date: andRange(dates.constData(), m, begin, end, low, range.high); break;
+            case MediaQuery::Width: andRange(widths.constData(), m, begin, end, low, range.high); break;
+            case MediaQuery::Height: andRange(heights.constData(), m, begin, end, low, range.high); break;
+            case MediaQuery::Duration: andRange(durations.constData(), m, begin, end, low, range.high); break;
+            case MediaQuery::Pixels:
+                for (int i = begin; i < end; ++i) {
+                    const qint64 longest = qMax(widths[i], heights[i]);
+                    m[i] &= quint8((longest >= low) & (longest < range.high));
+                }
+                break;
+            case MediaQuery::Name:
+                break;
+            }
+        }
+        for (const QString &part : query.nameParts) {
+            for (int i = begin; i < end; ++i) {
+                if (m[i] && !names[i].contains(part, Qt::CaseInsensitive)) {
+                    m[i] = 0;
+                }
+            }
+        }
+
+        std::vector<int> &rows = matches[size_t(slice)];
+        for (int i = begin; i < end; ++i) {
+            if (m[i]) rows.push_back(i);
+        }
+    });
+
+    QVector<int> rows;
+    size_t total = 0;
+    for (int slice = 0; slice < slices; ++slice) {
+        total += matches[size_t(slice)].size();
+    }
+    rows.reserve(int(total));
+    for (int slice = 0; slice < slices; ++slice) {
+        for (int row : matches[size_t(slice)]) {
+            rows.append(row);
+        }
+    }
+
+    if (query.sorted) {
+        sort(rows, query.sortField, query.sortDescending);
+    }
+    return rows;
+}
+
+void MediaIndex::sort(QVector<int> &rows, MediaQuery::Field field, bool descending) const
+{
+    const int count = rows.size();
+
+    if (field == MediaQuery::Name) {
+        // Names compare as strings; ties keep folder order
+        std::stable_sort(rows.begin(), rows.end(), [this, descending](int a, int b) {
+            return descending ? FileOperations::fileNameLessThan(names[b], names[a])
+                              : FileOperations::fileNameLessThan(names[a], names[b]);
+        });
+        return;
+    }
+
+    // Sorting the keys next to their rows keeps the comparisons in cache.
+    // Each slice sorts a run; runs are then merged pairwise, in parallel too.
+    std::vector<std::pair<qint64, int>> keyed(size_t(count));
+    for (int i = 0; i < count; ++i) {
+        const qint64 key = value(field, rows[i]);
+        keyed[size_t(i)] = {descending ? -key : key, rows[i]};
+    }
+    std::vector<int> runStarts;
+    const int runs = forEachSlice(count, minRowsPerThread, [&keyed](int begin, int end, int) {
+        std::sort(keyed.begin() + begin, keyed.begin() + end);
+    });
+    for (int run = 0; run <= runs; ++run) {
+        runStarts.push_back(int(qint64(count) * run / runs));
+    }
+    while (runStarts.size() > 2) {
+        std::vector<int> merged;
+        std::vector<std::thread> threads;
+        for (size_t run = 0; run + 2 < runStarts.size(); run += 2) {
+            const int begin = runStarts[run];
+            const int middle = runStarts[run + 1];
+            const int end = runStarts[run + 2];
+            threads.emplace_back([&keyed, begin, middle, end]() {
+                std::inplace_merge(keyed.begin() + begin, keyed.begin() + middle, keyed.begin() + end);
+            });
+            merged.push_back(begin);
+        }
+        if (runStarts.size() % 2 == 0) {
+            merged.push_back(runStarts[runStarts.size() - 2]); // odd run out, merged next round
+        }
+        merged.push_back(runStarts.back());
+        for (std::thread &thread : threads) {
+            thread.join();
+        }
+        runStarts = merged;
+    }
+
+    for (int i = 0; i < count; ++i) {
+        rows[i] = keyed[size_t(i)].second;
+    }
+}
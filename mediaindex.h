@@ -0,0 +1,46 @@
+#ifndef MEDIAINDEX_H
+#define MEDIAINDEX_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include "catalog.h"
+#include "mediaquery.h"
+
+// Struct-of-arrays snapshot of media files and their metadata, one column
+// per attribute, for sorting and filtering whole libraries. Queries scan
+// only the columns they test, in parallel slices, with a branch-free range
+// test per item that compilers vectorize; sorts run on (key, row) pairs
+// sorted in parallel runs and then merged.
+class MediaIndex
+{
+public:
+    void clear();
+    // Appends the files of one folder, as FileOperations::getMediaFileInfo() lists them
+    void addFolder(const QString &folder, const QVector<CatalogMediaFile> &files);
+
+    int size() const { return names.size(); }
+    QString folder(int row) const { return folders[int(folderColumn[row])]; }
+    QString name(int row) const { return names[row]; }
+    QString path(int row) const;
+
+    // Matching rows, in index order unless the query sorts
+    QVector<int> query(const MediaQuery &query) const;
+
+private:
+    QStringList folders;
+
+    QVector<quint32> folderColumn;
+    QStringList names;
+    QVector<quint8> kinds;
+    QVector<qint64> sizes;
+    QVector<qint64> dates; // capture time, or the mtime where there is none; ms since the epoch
+    QVector<qint64> durations;
+    QVector<quint32> widths;
+    QVector<quint32> heights;
+
+    qint64 value(MediaQuery::Field field, int row) const;
+    void sort(QVector<int> &rows, MediaQuery::Field field, bool descending) const;
+};
+
+#endif // MEDIAINDEX_H
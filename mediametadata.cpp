@@ -0,0 +1,680 @@
+#include "mediametadata.h"
+#include <QDate>
+#include <QFile>
+#include <QImageReader>
+#include <cstring>
+
+namespace {
+
+// Largest header structure read in one piece (an MP4 moov box)
+const qint64 maxHeaderSize = 32 * 1024 * 1024;
+// How much of a Matroska or AVI file is searched for its headers
+const qint64 leadingBytes = 1024 * 1024;
+
+QByteArray readAt(QFile &file, qint64 pos, qint64 size)
+{
+    if (pos < 0 || size <= 0 || size > maxHeaderSize || !file.seek(pos)) return QByteArray();
+    return file.read(size);
+}
+
+quint16 be16(const uchar *p) { return quint16(p[0] << 8 | p[1]); }
+quint32 be32(const uchar *p) { return quint32(p[0]) << 24 | quint32(p[1]) << 16 | quint32(p[2]) << 8 | p[3]; }
+quint64 be64(const uchar *p) { return quint64(be32(p)) << 32 | be32(p + 4); }
+quint16 le16(const uchar *p) { return quint16(p[0] | p[1] << 8); }
+quint32 le24(const uchar *p) { return quint32(p[0]) | quint32(p[1]) << 8 | quint32(p[2]) << 16; }
+quint32 le32(const uchar *p) { return le24(p) | quint32(p[3]) << 24; }
+
+const uchar *bytes(const QByteArray &data)
+{
+    return reinterpret_cast<const uchar *>(data.constData());
+}
+
+qint64 epochMs(int year, int month, int day, int hour, int minute, int second)
+{
+    const QDate date(year, month, day);
+    if (!date.isValid() || hour > 23 || minute > 59 || second > 60) return 0;
+    return (date.toJulianDay() - QDate(1970, 1, 1).toJulianDay()) * 86400000LL
+           + (hour * 3600LL + minute * 60 + second) * 1000;
+}
+
+// "YYYY:MM:DD HH:MM:SS"; cameras that never had their clock set write zeros
+qint64 parseExifTime(const QByteArray &text)
+{
+    if (text.size() < 19) return 0;
+    auto field = [&text](int from, int length) { return text.mid(from, length).toInt(); };
+    return epochMs(field(0, 4), field(5, 2), field(8, 2), field(11, 2), field(14, 2), field(17, 2));
+}
+
+QString trimmed(const QByteArray &text)
+{
+    int end = text.indexOf('\0');
+    return QString::fromUtf8(end < 0 ? text : text.left(end)).trimmed();
+}
+
+// --- TIFF / EXIF ---
+
+// Offsets come from the file, so they are widened to 64 bits before any
+// arithmetic; a corrupt pointer near 4 GB must not wrap back into range
+class Tiff
+{
+public:
+    explicit Tiff(const QByteArray &data)
+        : data(data)
+        , size(quint64(data.size()))
+        , little(data.startsWith("II*"))
+        , big(data.startsWith(QByteArray("MM\0*", 4)))
+    {
+    }
+
+    bool isValid() const { return size >= 8 && (little || big); }
+    quint32 firstIfd() const { return u32(4); }
+
+    quint16 u16(quint64 offset) const
+    {
+        if (offset + 2 > size) return 0;
+        return little ? le16(bytes(data) + offset) : be16(bytes(data) + offset);
+    }
+    quint32 u32(quint64 offset) const
+    {
+        if (offset + 4 > size) return 0;
+        return little ? le32(bytes(data) + offset) : be32(bytes(data) + offset);
+    }
+
+    // Calls visit(tag, entryOffset) for every entry of the IFD at offset
+    template <typename Visit>
+    void forEachEntry(quint64 offset, Visit visit) const
+    {
+        const quint16 count = u16(offset);
+        for (quint64 i = 0; i < count; ++i) {
+            const quint64 entry = offset + 2 + i * 12;
+            if (entry + 12 > size) return;
+            visit(u16(entry), entry);
+        }
+    }
+
+    quint32 number(quint64 entry) const
+    {
+        // SHORT values sit in the first two bytes of the value field
+        return u16(entry + 2) == 3 ? u16(entry + 8) : u32(entry + 8);
+    }
+
+    // The link to the next IFD, after the entries of the IFD at offset
+    quint32 nextIfd(quint64 offset) const { return u32(offset + 2 + quint64(u16(offset)) * 12); }
+
+    QByteArray text(quint64 entry) const
+    {
+        const quint64 count = u32(entry + 4);
+        const quint64 offset = count <= 4 ? entry + 8 : u32(entry + 8);
+        if (u16(entry + 2) != 2 || count > 1024 || offset + count > size) return QByteArray();
+        return data.mid(int(offset), int(count));
+    }
+
+private:
+    const QByteArray &data;
+    quint64 size;
+    bool little;
+    bool big;
+};
+
+void parseExif(const QByteArray &tiffData, MediaMetadata &metadata)
+{
+    const Tiff tiff(tiffData);
+    if (!tiff.isValid()) return;
+
+    QByteArray make;
+    QByteArray model;
+    QByteArray dateTime;
+    quint32 exifIfd = 0;
+    tiff.forEachEntry(tiff.firstIfd(), [&](quint16 tag, quint64 entry) {
+        switch (tag) {
+        case 0x0100: if (!metadata.width) metadata.width = tiff.number(entry); break;
+        case 0x0101: if (!metadata.height) metadata.height = tiff.number(entry); break;
+        case 0x010F: make = tiff.text(entry); break;
+        case 0x0110: model = tiff.text(entry); break;
+        case 0x0112: metadata.orientation = quint16(tiff.number(entry)); break;
+        case 0x0132: dateTime = tiff.text(entry); break;
+        case 0x8769: exifIfd = tiff.number(entry); break;
+        }
+    });
+
+    quint32 pixelWidth = 0;
+    quint32 pixelHeight = 0;
+    if (exifIfd) {
+        tiff.forEachEntry(exifIfd, [&](quint16 tag, quint64 entry) {
+            switch (tag) {
+            case 0x9003: dateTime = tiff.text(entry); break; // DateTimeOriginal wins over DateTime
+            case 0xA002: pixelWidth = tiff.number(entry); break;
+            case 0xA003: pixelHeight = tiff.number(entry); break;
+            }
+        });
+    }
+    if (!metadata.width && !metadata.height) {
+        metadata.width = pixelWidth;
+        metadata.height = pixelHeight;
+    }
+    if (metadata.orientation > 8) {
+        metadata.orientation = 0;
+    }
+    metadata.captureTime = parseExifTime(dateTime);
+
+    // Most cameras repeat the maker in the model name
+    const QString makeText = trimmed(make);
+    const QString modelText = trimmed(model);
+    metadata.camera = modelText.startsWith(makeText, Qt::CaseInsensitive) ? modelText
+                      : QString("%1 %2").arg(makeText, modelText).trimmed();
+}
+
+// The largest JPEG that IFD0 or IFD1 points at (JPEGInterchangeFormat), as an
+// offset into tiffData and a length. IFD1 holds the EXIF thumbnail; some RAW
+// formats keep a bigger preview in IFD0.
+bool findExifPreview(const QByteArray &tiffData, quint32 &offset, quint32 &length, quint16 &orientation)
+{
+    const Tiff tiff(tiffData);
+    if (!tiff.isValid()) return false;
+
+    offset = 0;
+    length = 0;
+    const quint32 ifd0 = tiff.firstIfd();
+    const quint32 ifd1 = tiff.nextIfd(ifd0);
+    for (quint32 ifd : {ifd0, ifd1}) {
+        if (!ifd) continue;
+        quint32 ifdOffset = 0;
+        quint32 ifdLength = 0;
+        tiff.forEachEntry(ifd, [&](quint16 tag, quint64 entry) {
+            switch (tag) {
+            case 0x0112: if (ifd == ifd0) orientation = quint16(tiff.number(entry)); break;
+            case 0x0201: ifdOffset = tiff.number(entry); break;
+            case 0x0202: ifdLength = tiff.number(entry); break;
+            }
+        });
+        if (ifdOffset && ifdLength > length) {
+            offset = ifdOffset;
+            length = ifdLength;
+        }
+    }
+    if (orientation > 8) {
+        orientation = 0;
+    }
+    return length > 0;
+}
+
+// --- Images ---
+
+// Calls visit(marker, contentPos, contentLength) for the header segments of a
+// JPEG until visit returns false or the image data starts
+template <typename Visit>
+void forEachJpegSegment(QFile &file, Visit visit)
+{
+    qint64 pos = 2;
+    for (int segments = 0; segments < 64; ++segments) {
+        const QByteArray header = readAt(file, pos, 4);
+        if (header.size() < 4 || quint8(header[0]) != 0xFF) return;
+        const quint8 marker = quint8(header[1]);
+        if (marker == 0xFF) {
+            ++pos; // fill byte
+            continue;
+        }
+        if (marker == 0xDA || marker == 0xD9) return; // image data follows; no headers after it
+
+        const quint16 length = be16(bytes(header) + 2);
+        if (length < 2 || !visit(marker, pos + 4, qint64(length) - 2)) return;
+        pos += 2 + length;
+    }
+}
+
+bool readJpeg(QFile &file, MediaMetadata &metadata)
+{
+    bool haveExif = false;
+    bool haveFrame = false;
+    forEachJpegSegment(file, [&](quint8 marker, qint64 pos, qint64 length) {
+        if (marker == 0xE1 && !haveExif) {
+            const QByteArray segment = readAt(file, pos, length);
+            if (segment.startsWith(QByteArray("Exif\0\0", 6))) {
+                parseExif(segment.mid(6), metadata);
+                haveExif = true;
+            }
+        } else if (marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC) {
+            // Start of frame: the real pixel size, whatever EXIF claims
+            const QByteArray frame = readAt(file, pos, 5);
+            if (frame.size() == 5) {
+                metadata.height = be16(bytes(frame) + 1);
+                metadata.width = be16(bytes(frame) + 3);
+            }
+            haveFrame = true;
+            return false;
+        }
+        return true;
+    });
+    return haveFrame || metadata.width > 0;
+}
+
+bool readWebp(const QByteArray &head, MediaMetadata &metadata)
+{
+    if (head.size() < 30) return false;
+    const uchar *p = bytes(head);
+    if (head.mid(12, 4) == "VP8X") {
+        metadata.width = le24(p + 24) + 1;
+        metadata.height = le24(p + 27) + 1;
+    } else if (head.mid(12, 4) == "VP8L" && p[20] == 0x2F) {
+        const quint32 bits = le32(p + 21);
+        metadata.width = (bits & 0x3FFF) + 1;
+        metadata.height = ((bits >> 14) & 0x3FFF) + 1;
+    } else if (head.mid(12, 4) == "VP8 " && p[23] == 0x9D && p[24] == 0x01 && p[25] == 0x2A) {
+        metadata.width = le16(p + 26) & 0x3FFF;
+        metadata.height = le16(p + 28) & 0x3FFF;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// --- ISO base media (MP4, MOV, M4V, 3GP) ---
+
+QString codecName(const QByteArray &id)
+{
+    static const struct { const char *id; const char *name; } names[] = {
+        {"avc1", "H.264"}, {"avc3", "H.264"}, {"V_MPEG4/ISO/AVC", "H.264"},
+        {"hvc1", "HEVC"}, {"hev1", "HEVC"}, {"V_MPEGH/ISO/HEVC", "HEVC"},
+        {"av01", "AV1"}, {"V_AV1", "AV1"},
+        {"vp08", "VP8"}, {"V_VP8", "VP8"}, {"vp09", "VP9"}, {"V_VP9", "VP9"},
+        {"mp4v", "MPEG-4"}, {"XVID", "MPEG-4"}, {"DIVX", "MPEG-4"}, {"DX50", "MPEG-4"}, {"FMP4", "MPEG-4"},
+        {"H264", "H.264"}, {"h264", "H.264"}, {"MJPG", "MJPEG"}, {"jpeg", "MJPEG"},
+        {"apch", "ProRes"}, {"apcn", "ProRes"}, {"apcs", "ProRes"}, {"apco", "ProRes"}, {"ap4h", "ProRes"},
+    };
+    for (const auto &entry : names) {
+        if (id == entry.id) return QString::fromLatin1(entry.name);
+    }
+    return trimmed(id);
+}
+
+// Finds the first child box of type within data[begin, end)
+bool findBox(const QByteArray &data, quint32 begin, quint32 end, const char *type, quint32 &contentBegin,
+             quint32 &contentEnd)
+{
+    const uchar *p = bytes(data);
+    quint32 pos = begin;
+    while (pos + 8 <= end) {
+        quint64 size = be32(p + pos);
+        quint32 headerSize = 8;
+        if (size == 1) {
+            if (pos + 16 > end) return false;
+            size = be64(p + pos + 8);
+            headerSize = 16;
+        } else if (size == 0) {
+            size = end - pos;
+        }
+        if (size < headerSize || size > end - pos) return false;
+        if (std::memcmp(p + pos + 4, type, 4) == 0) {
+            contentBegin = pos + headerSize;
+            contentEnd = pos + quint32(size);
+            return true;
+        }
+        pos += quint32(size);
+    }
+    return false;
+}
+
+// Boxes reached through a path of nested types, such as "mdia/minf/stbl/stsd"
+bool findPath(const QByteArray &data, quint32 begin, quint32 end, const char *path, quint32 &contentBegin,
+              quint32 &contentEnd)
+{
+    contentBegin = begin;
+    contentEnd = end;
+    for (const char *type = path; *type; type += type[4] == '/' ? 5 : 4) {
+        if (!findBox(data, contentBegin, contentEnd, type, contentBegin, contentEnd)) return false;
+        if (type[4] == '\0') break;
+    }
+    return true;
+}
+
+void parseMoov(const QByteArray &moov, MediaMetadata &metadata)
+{
+    const uchar *p = bytes(moov);
+    const quint32 size = quint32(moov.size());
+    quint32 begin = 0;
+    quint32 end = 0;
+
+    if (findBox(moov, 0, size, "mvhd", begin, end) && end - begin >= 32) {
+        const bool wide = p[begin] == 1;
+        const quint64 created = wide ? be64(p + begin + 4) : be32(p + begin + 4);
+        const quint32 timescale = be32(p + begin + (wide ? 20 : 12));
+        const quint64 duration = wide ? be64(p + begin + 24) : be32(p + begin + 16);
+        // Seconds since 1904; zero when the muxer left it unset
+        const qint64 secondsTo1970 = 2082844800LL;
+        if (created > quint64(secondsTo1970)) {
+            metadata.captureTime = (qint64(created) - secondsTo1970) * 1000;
+        }
+        const quint64 unknown = wide ? ~quint64(0) : 0xFFFFFFFFu;
+        if (timescale > 0 && duration != unknown) {
+            metadata.duration = qint64(duration * 1000 / timescale);
+        }
+    }
+
+    // The first video track gives size and codec
+    quint32 pos = 0;
+    quint32 trakBegin = 0;
+    quint32 trakEnd = 0;
+    while (findBox(moov, pos, size, "trak", trakBegin, trakEnd)) {
+        pos = trakEnd;
+        if (!findPath(moov, trakBegin, trakEnd, "mdia/hdlr", begin, end) || end - begin < 12
+            || std::memcmp(p + begin + 8, "vide", 4) != 0) {
+            continue;
+        }
+        if (findBox(moov, trakBegin, trakEnd, "tkhd", begin, end)) {
+            const quint32 offset = begin + (p[begin] == 1 ? 88 : 76);
+            if (offset + 8 <= end) {
+                metadata.width = be32(p + offset) >> 16;
+                metadata.height = be32(p + offset + 4) >> 16;
+            }
+        }
+        if (findPath(moov, trakBegin, trakEnd, "mdia/minf/stbl/stsd", begin, end) && end - begin >= 16) {
+            metadata.codec = codecName(moov.mid(int(begin + 12), 4));
+        }
+        return;
+    }
+}
+
+bool readIsoMedia(QFile &file, MediaMetadata &metadata)
+{
+    // Top-level boxes only; moov sits at either end of the file
+    const qint64 fileSize = file.size();
+    qint64 pos = 0;
+    while (pos + 8 <= fileSize) {
+        const QByteArray header = readAt(file, pos, 16);
+        if (header.size() < 8) break;
+        quint64 size = be32(bytes(header));
+        qint64 headerSize = 8;
+        if (size == 1 && header.size() == 16) {
+            size = be64(bytes(header) + 8);
+            headerSize = 16;
+        } else if (size == 0) {
+            size = quint64(fileSize - pos);
+        }
+        if (size < quint64(headerSize)) break;
+        if (header.mid(4, 4) == "moov") {
+            const QByteArray moov = readAt(file, pos + headerSize, qint64(size) - headerSize);
+            if (moov.isEmpty()) return false;
+            parseMoov(moov, metadata);
+            return true;
+        }
+        pos += qint64(size);
+    }
+    return false;
+}
+
+// --- Matroska (MKV, WebM) ---
+
+class Ebml
+{
+public:
+    explicit Ebml(const QByteArray &data)
+        : p(bytes(data))
+        , size(quint32(data.size()))
+    {
+    }
+
+    // Element IDs keep their length marker bits; sizes drop them. An
+    // all-ones size means unknown and is read as "to the end".
+    bool element(quint32 &pos, quint32 &id, quint32 &contentBegin, quint32 &contentEnd, quint32 end) const
+    {
+        int idLength = 0;
+        quint64 value = 0;
+        if (!vint(pos, end, idLength, value, true) || idLength > 4) return false;
+        id = quint32(value);
+        int sizeLength = 0;
+        quint64 contentSize = 0;
+        quint32 sizePos = pos + quint32(idLength);
+        if (!vint(sizePos, end, sizeLength, contentSize, false)) return false;
+        contentBegin = sizePos + quint32(sizeLength);
+        const bool unknown = contentSize == (quint64(1) << (7 * sizeLength)) - 1;
+        contentEnd = unknown || contentSize > end - contentBegin ? end : contentBegin + quint32(contentSize);
+        pos = contentEnd;
+        return true;
+    }
+
+    quint64 unsignedValue(quint32 begin, quint32 end) const
+    {
+        quint64 value = 0;
+        for (quint32 i = begin; i < end && i < begin + 8; ++i) {
+            value = value << 8 | p[i];
+        }
+        return value;
+    }
+
+    double floatValue(quint32 begin, quint32 end) const
+    {
+        if (end - begin == 4) {
+            quint32 bits = be32(p + begin);
+            float value;
+            std::memcpy(&value, &bits, 4);
+            return value;
+        }
+        if (end - begin == 8) {
+            quint64 bits = be64(p + begin);
+            double value;
+            std::memcpy(&value, &bits, 8);
+            return value;
+        }
+        return 0;
+    }
+
+private:
+    const uchar *p;
+    quint32 size;
+
+    bool vint(quint32 pos, quint32 end, int &length, quint64 &value, bool keepMarker) const
+    {
+        if (pos >= end || pos >= size || p[pos] == 0) return false;
+        length = 1;
+        while (!(p[pos] & (0x80 >> (length - 1)))) {
+            ++length;
+        }
+        if (pos + quint32(length) > end) return false;
+        value = keepMarker ? p[pos] : p[pos] & (0xFF >> length);
+        for (int i = 1; i < length; ++i) {
+            value = value << 8 | p[pos + quint32(i)];
+        }
+        return true;
+    }
+};
+
+bool readMatroska(QFile &file, MediaMetadata &metadata)
+{
+    const QByteArray data = readAt(file, 0, qMin(file.size(), leadingBytes));
+    const Ebml ebml(data);
+    const quint32 size = quint32(data.size());
+    const quint32 segmentId = 0x18538067;
+    const quint32 infoId = 0x1549A966;
+    const quint32 tracksId = 0x1654AE6B;
+    const quint32 clusterId = 0x1F43B675;
+
+    quint32 pos = 0;
+    quint32 id = 0;
+    quint32 begin = 0;
+    quint32 end = 0;
+    // The EBML header, then the segment
+    if (!ebml.element(pos, id, begin, end, size) || id != 0x1A45DFA3) return false;
+    if (!ebml.element(pos, id, begin, end, size) || id != segmentId) return false;
+
+    quint64 timecodeScale = 1000000;
+    double duration = 0;
+    pos = begin;
+    const quint32 segmentEnd = end;
+    while (pos < segmentEnd && ebml.element(pos, id, begin, end, segmentEnd)) {
+        if (id == clusterId) break;
+        if (id == infoId) {
+            quint32 child = begin;
+            quint32 childId = 0;
+            quint32 childBegin = 0;
+            quint32 childEnd = 0;
+            while (child < end && ebml.element(child, childId, childBegin, childEnd, end)) {
+                if (childId == 0x2AD7B1) {
+                    timecodeScale = ebml.unsignedValue(childBegin, childEnd);
+                } else if (childId == 0x4489) {
+                    duration = ebml.floatValue(childBegin, childEnd);
+                } else if (childId == 0x4461 && childEnd - childBegin == 8) {
+                    // Nanoseconds since 2001-01-01
+                    const qint64 since2001 = qint64(ebml.unsignedValue(childBegin, childEnd)) / 1000000;
+                    metadata.captureTime = epochMs(2001, 1, 1, 0, 0, 0) + since2001;
+                }
+            }
+        } else if (id == tracksId && metadata.codec.isEmpty()) {
+            quint32 track = begin;
+            quint32 trackId = 0;
+            quint32 trackBegin = 0;
+            quint32 trackEnd = 0;
+            while (track < end && ebml.element(track, trackId, trackBegin, trackEnd, end)) {
+                if (trackId != 0xAE) continue;
+                quint64 type = 0;
+                QByteArray codec;
+                quint32 width = 0;
+                quint32 height = 0;
+                quint32 child = trackBegin;
+                quint32 childId = 0;
+                quint32 childBegin = 0;
+                quint32 childEnd = 0;
+                while (child < trackEnd && ebml.element(child, childId, childBegin, childEnd, trackEnd)) {
+                    if (childId == 0x83) {
+                        type = ebml.unsignedValue(childBegin, childEnd);
+                    } else if (childId == 0x86) {
+                        codec = data.mid(int(childBegin), int(childEnd - childBegin));
+                    } else if (childId == 0xE0) {
+                        quint32 video = childBegin;
+                        quint32 videoId = 0;
+                        quint32 videoBegin = 0;
+                        quint32 videoEnd = 0;
+                        while (video < childEnd && ebml.element(video, videoId, videoBegin, videoEnd, childEnd)) {
+                            if (videoId == 0xB0) width = quint32(ebml.unsignedValue(videoBegin, videoEnd));
+                            if (videoId == 0xBA) height = quint32(ebml.unsignedValue(videoBegin, videoEnd));
+                        }
+                    }
+                }
+                if (type == 1) {
+                    metadata.codec = codecName(codec);
+                    metadata.width = width;
+                    metadata.height = height;
+                    break;
+                }
+            }
+        }
+    }
+    metadata.duration = qint64(duration * double(timecodeScale) / 1e6);
+    return true;
+}
+
+// --- AVI ---
+
+bool readAvi(QFile &file, MediaMetadata &metadata)
+{
+    const QByteArray data = readAt(file, 0, qMin(file.size(), leadingBytes));
+    const uchar *p = bytes(data);
+
+    // The main header and the video stream headers are plain chunks in hdrl
+    int avih = data.indexOf("avih");
+    if (avih < 0 || avih + 48 > data.size()) return false;
+    const uchar *header = p + avih + 8;
+    const quint64 microsPerFrame = le32(header);
+    const quint64 frames = le32(header + 16);
+    metadata.duration = qint64(microsPerFrame * frames / 1000);
+    metadata.width = le32(header + 32);
+    metadata.height = le32(header + 36);
+
+    for (int strh = data.indexOf("strh"); strh >= 0 && strh + 16 <= data.size(); strh = data.indexOf("strh", strh + 4)) {
+        if (data.mid(strh + 8, 4) != "vids") continue;
+        // BITMAPINFOHEADER biCompression beats the often empty handler field
+        int strf = data.indexOf("strf", strh);
+        if (strf >= 0 && strf + 28 <= data.size() && le32(p + strf + 24) != 0) {
+            metadata.codec = codecName(data.mid(strf + 24, 4));
+        } else {
+            metadata.codec = codecName(data.mid(strh + 12, 4));
+        }
+        break;
+    }
+    return true;
+}
+
+} // namespace
+
+bool MetadataReader::read(const QString &path, MediaMetadata &metadata)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    metadata = MediaMetadata();
+
+    const QByteArray head = file.read(32);
+    const uchar *p = bytes(head);
+    bool recognised = false;
+    if (head.startsWith("\xFF\xD8\xFF")) {
+        recognised = readJpeg(file, metadata);
+    } else if (head.startsWith("\x89PNG\r\n\x1A\n") && head.size() >= 24) {
+        metadata.width = be32(p + 16);
+        metadata.height = be32(p + 20);
+        recognised = true;
+    } else if ((head.startsWith("GIF87a") || head.startsWith("GIF89a")) && head.size() >= 10) {
+        metadata.width = le16(p + 6);
+        metadata.height = le16(p + 8);
+        recognised = true;
+    } else if (head.startsWith("BM") && head.size() >= 26) {
+        metadata.width = le32(p + 18);
+        metadata.height = quint32(qAbs(qint32(le32(p + 22)))); // negative for top-down bitmaps
+        recognised = true;
+    } else if (head.startsWith("RIFF") && head.mid(8, 4) == "WEBP") {
+        recognised = readWebp(head, metadata);
+    } else if (head.startsWith("RIFF") && head.mid(8, 4) == "AVI ") {
+        recognised = readAvi(file, metadata);
+    } else if (head.startsWith("\x1A\x45\xDF\xA3")) {
+        recognised = readMatroska(file, metadata);
+    } else if (head.startsWith("II*") || head.startsWith(QByteArray("MM\0*", 4))) {
+        parseExif(readAt(file, 0, qMin(file.size(), leadingBytes)), metadata);
+        recognised = true;
+    } else if (head.mid(4, 4) == "ftyp" || head.mid(4, 4) == "moov" || head.mid(4, 4) == "mdat"
+               || head.mid(4, 4) == "wide" || head.mid(4, 4) == "free") {
+        recognised = readIsoMedia(file, metadata);
+    }
+
+    if (!recognised) {
+        file.close();
+        QImageReader reader(path);
+        const QSize size = reader.size();
+        if (size.isValid()) {
+            metadata.width = quint32(size.width());
+            metadata.height = quint32(size.height());
+        }
+    }
+    return true;
+}
+
+QByteArray MetadataReader::readPreview(const QString &path, quint16 &orientation)
+{
+    orientation = 0;
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QByteArray();
+    }
+
+    const QByteArray head = file.read(4);
+    qint64 tiffStart = 0;
+    QByteArray tiffData;
+    if (head.startsWith("\xFF\xD8\xFF")) {
+        forEachJpegSegment(file, [&](quint8 marker, qint64 pos, qint64 length) {
+            if (marker != 0xE1) return true;
+            const QByteArray segment = readAt(file, pos, length);
+            if (!segment.startsWith(QByteArray("Exif\0\0", 6))) return true;
+            tiffStart = pos + 6;
+            tiffData = segment.mid(6);
+            return false;
+        });
+    } else if (head.startsWith("II*") || head.startsWith(QByteArray("MM\0*", 4))) {
+        tiffData = readAt(file, 0, qMin(file.size(), leadingBytes));
+    }
+
+    quint32 offset;
+    quint32 length;
+    if (!findExifPreview(tiffData, offset, length, orientation)) {
+        return QByteArray();
+    }
+    const QByteArray jpeg = readAt(file, tiffStart + offset, length);
+    return jpeg.size() == qsizetype(length) && jpeg.startsWith("\xFF\xD8") ? jpeg : QByteArray();
+}
@@ -0,0 +1,35 @@
+#ifndef MEDIAMETADATA_H
+#define MEDIAMETADATA_H
+
+#include <QString>
+
+// What the headers of a media file tell without decoding it; zero or empty
+// where a header does not say
+struct MediaMetadata
+{
+    qint64 captureTime = 0; // ms since the epoch; EXIF wall-clock times are taken as UTC
+    qint64 duration = 0;    // ms, videos only
+    quint32 width = 0;      // stored pixel size, before orientation is applied
+    quint32 height = 0;
+    quint16 orientation = 0; // EXIF orientation, 1 to 8
+    QString camera;
+    QString codec;
+};
+
+// Header-only parsers for JPEG (EXIF and SOF), PNG, GIF, BMP, WebP, ISO media
+// (MP4, MOV), Matroska (MKV, WebM) and AVI, picked by magic bytes. Other
+// images fall back to QImageReader's size, which also reads headers only.
+// A file is touched at a handful of offsets, so reading stays in the page
+// cache or a few seeks on cold storage.
+class MetadataReader
+{
+public:
+    // False when the file could not be opened
+    static bool read(const QString &path, MediaMetadata &metadata);
+    // The JPEG preview embedded in the EXIF of a JPEG or TIFF-based RAW file,
+    // empty when there is none; orientation is the main image's, which the
+    // preview is stored without
+    static QByteArray readPreview(const QString &path, quint16 &orientation);
+};
+
+#endif // MEDIAMETADATA_H
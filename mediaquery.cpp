@@ -0,0 +1,184 @@
+#include "mediaquery.h"
+#include <QDate>
+#include <QRegularExpression>
+#include <limits>
+
+namespace {
+
+const qint64 lowest = std::numeric_limits<qint64>::min();
+const qint64 highest = std::numeric_limits<qint64>::max();
+
+bool fieldFromName(const QString &name, MediaQuery::Field &field)
+{
+    static const struct { const char *name; MediaQuery::Field field; } fields[] = {
+        {"size", MediaQuery::Size}, {"date", MediaQuery::Date}, {"taken", MediaQuery::Date},
+        {"width", MediaQuery::Width}, {"height", MediaQuery::Height}, {"pixels", MediaQuery::Pixels},
+        {"px", MediaQuery::Pixels}, {"duration", MediaQuery::Duration}, {"length", MediaQuery::Duration},
+        {"name", MediaQuery::Name}, {"type", MediaQuery::Kind},
+    };
+    for (const auto &entry : fields) {
+        if (name.compare(QLatin1String(entry.name), Qt::CaseInsensitive) == 0) {
+            field = entry.field;
+            return true;
+        }
+    }
+    return false;
+}
+
+qint64 epochMs(const QDate &date)
+{
+    return (date.toJulianDay() - QDate(1970, 1, 1).toJulianDay()) * 86400000LL;
+}
+
+// A value is a range too: "2021-06" covers the whole month, "1GB" a single byte count
+bool parseValue(const QString &text, bool fieldGiven, MediaQuery::Field &field, qint64 &start, qint64 &end)
+{
+    static const QRegularExpression number("^(\\d+(?:\\.\\d+)?)([a-z]*)$", QRegularExpression::CaseInsensitiveOption);
+    static const QRegularExpression date("^(\\d{4})(?:-(\\d{1,2})(?:-(\\d{1,2}))?)?$");
+
+    const QRegularExpressionMatch dateMatch = date.match(text);
+    if (dateMatch.hasMatch() && (!fieldGiven || field == MediaQuery::Date)) {
+        const int year = dateMatch.captured(1).toInt();
+        const int month = dateMatch.captured(2).isEmpty() ? 0 : dateMatch.captured(2).toInt();
+        const int day = dateMatch.captured(3).isEmpty() ? 0 : dateMatch.captured(3).toInt();
+        const QDate first(year, qMax(month, 1), qMax(day, 1));
+        if (!first.isValid()) return false;
+        const QDate next = day ? first.addDays(1) : month ? first.addMonths(1) : first.addYears(1);
+        field = MediaQuery::Date;
+        start = epochMs(first);
+        end = epochMs(next);
+        return true;
+    }
+
+    const QRegularExpressionMatch match = number.match(text);
+    if (!match.hasMatch()) return false;
+    const double value = match.captured(1).toDouble();
+    const QString unit = match.captured(2).toLower();
+
+    static const struct { const char *unit; MediaQuery::Field field; double scale; } units[] = {
+        {"b", MediaQuery::Size, 1}, {"kb", MediaQuery::Size, 1024.0}, {"mb", MediaQuery::Size, 1024.0 * 1024},
+        {"gb", MediaQuery::Size, 1024.0 * 1024 * 1024}, {"tb", MediaQuery::Size, 1024.0 * 1024 * 1024 * 1024},
+        {"px", MediaQuery::Pixels, 1},
+        {"ms", MediaQuery::Duration, 1}, {"s", MediaQuery::Duration, 1000}, {"sec", MediaQuery::Duration, 1000},
+        {"min", MediaQuery::Duration, 60000}, {"h", MediaQuery::Duration, 3600000},
+    };
+    double scale = 1;
+    if (!unit.isEmpty()) {
+        bool known = false;
+        for (const auto &entry : units) {
+            if (unit == QLatin1String(entry.unit)) {
+                if (fieldGiven && field != entry.field && !(entry.field == MediaQuery::Pixels
+                                                             && (field == MediaQuery::Width || field == MediaQuery::Height))) {
+                    return false;
+                }
+                if (!fieldGiven) field = entry.field;
+                scale = entry.scale;
+                known = true;
+                break;
+            }
+        }
+        if (!known) return false;
+    } else if (!fieldGiven) {
+        return false; // a bare number says nothing about what it measures
+    } else if (field == MediaQuery::Duration) {
+        scale = 1000; // seconds
+    }
+
+    start = qint64(value * scale);
+    end = start + 1;
+    return true;
+}
+
+bool isOperator(const QString &token)
+{
+    return token == "<" || token == "<=" || token == ">" || token == ">=" || token == "=";
+}
+
+} // namespace
+
+bool MediaQuery::parse(const QString &text, MediaQuery &query, QString *error)
+{
+    query = MediaQuery();
+    auto fail = [error](const QString &message) {
+        if (error) *error = message;
+        return false;
+    };
+
+    // Operators become tokens of their own, with or without spaces around them
+    static const QRegularExpression operators("(<=|>=|<|>|=)");
+    QStringList tokens;
+    const QStringList words = text.split(QRegularExpression("\\s+"), Qt::SkipEmptyParts);
+    for (const QString &word : words) {
+        if (word.startsWith("sort:", Qt::CaseInsensitive)) {
+            tokens.append(word);
+            continue;
+        }
+        QString spaced = word;
+        spaced.replace(operators, " \\1 ");
+        tokens.append(spaced.split(' ', Qt::SkipEmptyParts));
+    }
+
+    for (int i = 0; i < tokens.size(); ++i) {
+        const QString &token = tokens[i];
+        const QString lower = token.toLower();
+
+        if (lower.startsWith("sort:")) {
+            QString key = lower.mid(5);
+            query.sortDescending = key.startsWith('-');
+            if (query.sortDescending) key.remove(0, 1);
+            if (!fieldFromName(key, query.sortField)) {
+                return fail(QString("Unknown sort key \"%1\"").arg(key));
+            }
+            query.sorted = true;
+            continue;
+        }
+        if (lower == "image" || lower == "images" || lower == "photos" || lower == "video" || lower == "videos") {
+            const qint64 kind = lower.startsWith("video") ? Video : Image;
+            query.ranges.append({Kind, kind, kind + 1});
+            continue;
+        }
+
+        Field field = Name;
+        bool fieldGiven = false;
+        int op = i;
+        if (i + 1 < tokens.size() && isOperator(tokens[i + 1]) && fieldFromName(token, field)) {
+            fieldGiven = true;
+            op = i + 1;
+        }
+        if (!isOperator(tokens[op])) {
+            query.nameParts.append(token);
+            continue;
+        }
+        if (op + 1 >= tokens.size()) {
+            return fail(QString("\"%1\" needs a value").arg(tokens[op]));
+        }
+        if (fieldGiven && (field == Name || field == Kind)) {
+            return fail(QString("\"%1\" cannot be compared").arg(token));
+        }
+
+        const QString &value = tokens[op + 1];
+        qint64 start = 0;
+        qint64 end = 0;
+        if (!parseValue(value, fieldGiven, field, start, end)) {
+            return fail(QString("Cannot read \"%1\"; use a unit such as 1GB, 800px, 90s or a date like 2021-06").arg(value));
+        }
+
+        Range range{field, lowest, highest};
+        const QString &symbol = tokens[op];
+        if (symbol == "<") {
+            range.high = start;
+        } else if (symbol == "<=") {
+            range.high = end;
+        } else if (symbol == ">") {
+            range.low = end;
+        } else if (symbol == ">=") {
+            range.low = start;
+        } else {
+            range.low = start;
+            range.high = end;
+        }
+        query.ranges.append(range);
+        i = op + 1;
+    }
+    return true;
+}
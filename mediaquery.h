@@ -0,0 +1,44 @@
+#ifndef MEDIAQUERY_H
+#define MEDIAQUERY_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// A parsed filter expression such as "videos > 1GB", "images < 800px",
+// "date >= 2021-06 sort:-size" or "beach width>=4000". Terms are ANDed:
+//   images, videos                   media type
+//   [field] <op> value               op is <, <=, >, >=, =; without a field
+//                                    the unit picks one: B/KB/MB/GB/TB size,
+//                                    px the longer side, s/min/h duration,
+//                                    YYYY[-MM[-DD]] date
+//   size, date, width, height, pixels, duration   explicit fields
+//   sort:field, sort:-field          order, "-" for descending
+//   anything else                    part of the file name, any case
+// Every comparison becomes a half-open range, so evaluating a term is a
+// single branch-free test per item.
+struct MediaQuery
+{
+    enum Field { Kind, Size, Date, Width, Height, Pixels, Duration, Name };
+    enum Kinds { Image, Video };
+
+    struct Range
+    {
+        Field field;
+        qint64 low;  // inclusive
+        qint64 high; // exclusive
+    };
+
+    QVector<Range> ranges;
+    QStringList nameParts;
+    bool sorted = false;
+    Field sortField = Name;
+    bool sortDescending = false;
+
+    bool isEmpty() const { return ranges.isEmpty() && nameParts.isEmpty() && !sorted; }
+
+    // False with a message for the user when text does not parse
+    static bool parse(const QString &text, MediaQuery &query, QString *error = nullptr);
+};
+
+#endif // MEDIAQUERY_H
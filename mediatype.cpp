@@ -0,0 +1,229 @@
+#include "mediatype.h"
+#include <QFile>
+#include <cstring>
+
+namespace {
+
+struct Extension
+{
+    const char *name;
+    MediaType type;
+};
+
+// Everything the viewer shows; the order is that of the extension lists
+constexpr Extension extensionTable[] = {
+    {"jpg", MediaType::Image},
+    {"jpeg", MediaType::Image},
+    {"png", MediaType::Image},
+    {"gif", MediaType::Image},
+    {"bmp", MediaType::Image},
+    {"webp", MediaType::Image},
+    {"mp4", MediaType::Video},
+    {"avi", MediaType::Video},
+    {"mov", MediaType::Video},
+    {"mkv", MediaType::Video},
+    {"wmv", MediaType::Video},
+    {"flv", MediaType::Video},
+    {"m4v", MediaType::Video},
+    {"webm", MediaType::Video},
+};
+constexpr int extensionCount = int(sizeof(extensionTable) / sizeof(extensionTable[0]));
+static_assert(extensionCount <= 32, "accepted sets are 32-bit masks");
+
+// An extension is up to four ASCII characters, packed last first into a key
+const int maxExtensionLength = 4;
+
+constexpr quint32 lowerAscii(quint32 c)
+{
+    return c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c;
+}
+
+constexpr quint32 packExtension(const char *name)
+{
+    int length = 0;
+    while (name[length]) ++length;
+    quint32 key = 0;
+    for (int i = length - 1; i >= 0; --i) {
+        key = (key << 8) | lowerAscii(quint32(static_cast<unsigned char>(name[i])));
+    }
+    return key;
+}
+
+const int slotBits = 6;
+const int slotCount = 1 << slotBits;
+
+constexpr int slotOf(quint32 key, quint32 multiplier)
+{
+    return int((key * multiplier) >> (32 - slotBits));
+}
+
+// First multiplier that sends every table key to a slot of its own
+constexpr quint32 findMultiplier()
+{
+    for (quint32 multiplier = 0x9e3779b1u;; multiplier += 2) {
+        bool used[slotCount] = {};
+        bool collides = false;
+        for (int i = 0; i < extensionCount && !collides; ++i) {
+            const int slot = slotOf(packExtension(extensionTable[i].name), multiplier);
+            collides = used[slot];
+            used[slot] = true;
+        }
+        if (!collides) return multiplier;
+    }
+}
+
+constexpr quint32 multiplier = findMultiplier();
+
+struct SlotTable
+{
+    quint32 keys[slotCount] = {};
+    qint8 entries[slotCount] = {};
+};
+
+constexpr SlotTable buildSlots()
+{
+    SlotTable table;
+    for (int slot = 0; slot < slotCount; ++slot) {
+        table.entries[slot] = -1;
+    }
+    for (int i = 0; i < extensionCount; ++i) {
+        const quint32 key = packExtension(extensionTable[i].name);
+        table.keys[slotOf(key, multiplier)] = key;
+        table.entries[slotOf(key, multiplier)] = qint8(i);
+    }
+    return table;
+}
+
+constexpr SlotTable slotTable = buildSlots();
+
+inline quint32 codeOf(char c)
+{
+    return static_cast<unsigned char>(c);
+}
+
+inline quint32 codeOf(QChar c)
+{
+    return c.unicode();
+}
+
+// Table entry for the extension of name, or -1
+template <typename Char>
+int extensionEntry(const Char *name, qsizetype length)
+{
+    quint32 key = 0;
+    int chars = 0;
+    for (qsizetype i = length - 1; i >= 0; --i) {
+        const quint32 c = codeOf(name[i]);
+        if (c == '.') {
+            if (chars == 0) return -1;
+            const int slot = slotOf(key, multiplier);
+            return slotTable.keys[slot] == key ? slotTable.entries[slot] : -1;
+        }
+        if (chars == maxExtensionLength || c > 0x7f) return -1;
+        key = (key << 8) | lowerAscii(c);
+        ++chars;
+    }
+    return -1;
+}
+
+bool startsWith(const char *data, qint64 size, qint64 offset, const char *magic, qint64 length)
+{
+    return size >= offset + length && std::memcmp(data + offset, magic, size_t(length)) == 0;
+}
+
+} // namespace
+
+MediaClassifier::MediaClassifier(const QStringList &extensions)
+{
+    for (const QString &extension : extensions) {
+        if (extension == sniffMarker()) {
+            sniffing = true;
+            continue;
+        }
+        const int entry = extensionEntry(extension.constData(), extension.size());
+        if (entry >= 0) {
+            accepted |= 1u << entry;
+        }
+    }
+}
+
+MediaType MediaClassifier::classify(QStringView fileName) const
+{
+    const int entry = extensionEntry(fileName.data(), fileName.size());
+    return entry >= 0 && (accepted & (1u << entry)) ? extensionTable[entry].type : MediaType::Unknown;
+}
+
+MediaType MediaClassifier::classify(const char *fileName, qsizetype length) const
+{
+    const int entry = extensionEntry(fileName, length);
+    return entry >= 0 && (accepted & (1u << entry)) ? extensionTable[entry].type : MediaType::Unknown;
+}
+
+MediaType MediaClassifier::classifyFile(const QString &path) const
+{
+    const MediaType type = classify(path);
+    return type == MediaType::Unknown && sniffing ? sniffFile(path) : type;
+}
+
+MediaType MediaClassifier::typeOf(QStringView fileName)
+{
+    const int entry = extensionEntry(fileName.data(), fileName.size());
+    return entry >= 0 ? extensionTable[entry].type : MediaType::Unknown;
+}
+
+MediaType MediaClassifier::sniff(const char *data, qint64 size)
+{
+    if (startsWith(data, size, 0, "\xff\xd8\xff", 3)
+        || startsWith(data, size, 0, "\x89PNG\r\n\x1a\n", 8)
+        || startsWith(data, size, 0, "GIF87a", 6) || startsWith(data, size, 0, "GIF89a", 6)
+        || (startsWith(data, size, 0, "RIFF", 4) && startsWith(data, size, 8, "WEBP", 4))) {
+        return MediaType::Image;
+    }
+    if (startsWith(data, size, 0, "BM", 2) && size >= 18) {
+        // "BM" alone is too common; the DIB header size must be a known one
+        const quint32 dibSize = quint32(quint8(data[14])) | quint32(quint8(data[15])) << 8
+                                | quint32(quint8(data[16])) << 16 | quint32(quint8(data[17])) << 24;
+        if (dibSize == 12 || dibSize == 40 || dibSize == 52 || dibSize == 56 || dibSize == 108 || dibSize == 124) {
+            return MediaType::Image;
+        }
+    }
+
+    if (startsWith(data, size, 4, "ftyp", 4)) {
+        // HEIF and AVIF stills share the container but are not shown
+        const char *stills[] = {"heic", "heix", "mif1", "msf1", "avif"};
+        for (const char *brand : stills) {
+            if (startsWith(data, size, 8, brand, 4)) return MediaType::Unknown;
+        }
+        return MediaType::Video;
+    }
+    if (startsWith(data, size, 4, "moov", 4) || startsWith(data, size, 4, "mdat", 4)
+        || startsWith(data, size, 4, "wide", 4)
+        || (startsWith(data, size, 0, "RIFF", 4) && startsWith(data, size, 8, "AVI ", 4))
+        || startsWith(data, size, 0, "\x1a\x45\xdf\xa3", 4)
+        || startsWith(data, size, 0, "\x30\x26\xb2\x75\x8e\x66\xcf\x11\xa6\xd9\x00\xaa\x00\x62\xce\x6c", 16)
+        || startsWith(data, size, 0, "FLV\x01", 4)) {
+        return MediaType::Video;
+    }
+    return MediaType::Unknown;
+}
+
+MediaType MediaClassifier::sniffFile(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return MediaType::Unknown;
+    }
+    char header[sniffSize];
+    return sniff(header, file.read(header, sizeof(header)));
+}
+
+QStringList MediaClassifier::extensions(MediaType type)
+{
+    QStringList extensions;
+    for (const Extension &extension : extensionTable) {
+        if (extension.type == type) {
+            extensions.append(QString(".") + extension.name);
+        }
+    }
+    return extensions;
+}
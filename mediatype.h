@@ -0,0 +1,49 @@
+#ifndef MEDIATYPE_H
+#define MEDIATYPE_H
+
+#include <QString>
+#include <QStringList>
+#include <QStringView>
+
+enum class MediaType : quint8
+{
+    Unknown,
+    Image,
+    Video
+};
+
+// Tells media files apart by extension through a fixed perfect-hash table,
+// so classifying a name allocates nothing, and optionally by the first bytes
+// of files whose extension is missing or wrong.
+class MediaClassifier
+{
+public:
+    // Accepts the table extensions in the list (".jpg", ...); sniffMarker()
+    // in the list also accepts files whose content is a known format
+    explicit MediaClassifier(const QStringList &extensions = QStringList());
+
+    bool sniffsContent() const { return sniffing; }
+
+    // Type by an accepted extension, else Unknown; the name may be UTF-8
+    MediaType classify(QStringView fileName) const;
+    MediaType classify(const char *fileName, qsizetype length) const;
+    // Also sniffs the file when sniffing and the extension tells nothing
+    MediaType classifyFile(const QString &path) const;
+
+    // Type by any table extension, whatever the accepted list
+    static MediaType typeOf(QStringView fileName);
+    // Type from the first bytes of a file; sniffSize of them are enough
+    static MediaType sniff(const char *data, qint64 size);
+    static MediaType sniffFile(const QString &path);
+
+    static QStringList extensions(MediaType type);
+    static QString sniffMarker() { return QStringLiteral("*"); }
+
+    static const int sniffSize = 32;
+
+private:
+    quint32 accepted = 0; // one bit per table entry
+    bool sniffing = false;
+};
+
+#endif // MEDIATYPE_H
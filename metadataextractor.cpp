@@ -0,0 +1,92 @@
+#include "metadataextractor.h"
+#include "catalog.h"
+#include "fileoperations.h"
+#include "mediametadata.h"
+#include "parallel.h"
+#include "tracer.h"
+#include <QElapsedTimer>
+#include <QHash>
+#include <vector>
+
+namespace {
+
+// Enough requests in flight to keep an SSD or the page cache busy without
+// thrashing a spinning disk
+const int maxThreads = 8;
+
+} // namespace
+
+MetadataExtractor::MetadataExtractor(const QStringList &folders, Catalog *catalog, const QStringList &mediaExtensions,
+                                     QObject *parent)
+    : QThread(parent)
+    , folders(folders)
+    , catalog(catalog)
+    , mediaExtensions(mediaExtensions)
+{
+}
+
+qint64 MetadataExtractor::extractedCount() const
+{
+    return extracted;
+}
+
+bool MetadataExtractor::isCompleted() const
+{
+    return completed;
+}
+
+void MetadataExtractor::run()
+{
+    struct Media
+    {
+        QString path;
+        CatalogMediaFile file;
+    };
+
+    FileOperations fileOperations;
+    if (catalog) {
+        fileOperations.setCatalog(catalog, mediaExtensions);
+    }
+    std::vector<Media> missing;
+    QElapsedTimer sinceProgress;
+    sinceProgress.start();
+    for (int i = 0; i < folders.size() && !isInterruptionRequested(); ++i) {
+        const QVector<CatalogMediaFile> files = fileOperations.getCurrentMediaFileInfo(folders[i], mediaExtensions);
+        const QString prefix = folders[i].endsWith('/') ? folders[i] : folders[i] + "/";
+        for (const CatalogMediaFile &file : files) {
+            if (!file.hasMetadata) {
+                missing.push_back({prefix + file.name, file});
+            }
+        }
+        if (sinceProgress.elapsed() >= 100) {
+            emit progress("Listing media", i + 1, folders.size());
+            sinceProgress.restart();
+        }
+    }
+    if (isInterruptionRequested()) return;
+
+    const qint64 total = qint64(missing.size());
+    const qint64 done = forEachItem(total, qBound(2, QThread::idealThreadCount(), maxThreads),
+        [&](qint64 index) {
+            TraceSpan span("metadata", "files");
+            CatalogMediaFile &file = missing[size_t(index)].file;
+            file.hasMetadata = MetadataReader::read(missing[size_t(index)].path, file.metadata);
+        },
+        [this]() { return isInterruptionRequested(); },
+        [this, total](qint64 count) { emit progress("Reading metadata", count, total); });
+
+    // Keep whatever was read, even when cancelled, so the next run resumes from there
+    QHash<QString, CatalogMediaFile> read;
+    read.reserve(int(done));
+    for (const Media &media : missing) {
+        if (media.file.hasMetadata) {
+            read.insert(media.path, media.file);
+        }
+    }
+    extracted = read.size();
+    if (catalog && !read.isEmpty()) {
+        emit progress("Saving metadata", 0, 0);
+        catalog->storeMetadata(read);
+    }
+    completed = !isInterruptionRequested();
+}
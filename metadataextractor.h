@@ -0,0 +1,41 @@
+#ifndef METADATAEXTRACTOR_H
+#define METADATAEXTRACTOR_H
+
+#include <QThread>
+#include <QString>
+#include <QStringList>
+
+class Catalog;
+
+// Reads the header metadata of every media file in the scanned folders that
+// the catalog has none for yet, on a few threads, and writes it back to the
+// catalog, so each file version is only parsed once. The thread count is
+// capped because the work is seek-bound rather than CPU-bound. Cancel with
+// requestInterruption(); what was read so far is kept.
+class MetadataExtractor : public QThread
+{
+    Q_OBJECT
+
+public:
+    MetadataExtractor(const QStringList &folders, Catalog *catalog, const QStringList &mediaExtensions,
+                      QObject *parent = nullptr);
+
+    // Valid once the thread has finished
+    qint64 extractedCount() const;
+    bool isCompleted() const;
+
+signals:
+    void progress(const QString &stage, qint64 done, qint64 total);
+
+protected:
+    void run() override;
+
+private:
+    QStringList folders;
+    Catalog *catalog;
+    QStringList mediaExtensions;
+    qint64 extracted = 0;
+    bool completed = false;
+};
+
+#endif // METADATAEXTRACTOR_H
@@ -0,0 +1,82 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <QThread>
+#include <QtGlobal>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Runs work(begin, end, slice) over equal slices of [0, count) on up to
+// idealThreadCount() threads, the calling thread included, with at least
+// minPerSlice items each. Returns the number of slices.
+template <typename Work>
+int forEachSlice(int count, int minPerSlice, Work work)
+{
+    const int slices = qBound(1, count / qMax(1, minPerSlice), qMax(1, QThread::idealThreadCount()));
+    std::vector<std::thread> threads;
+    for (int slice = 1; slice < slices; ++slice) {
+        threads.emplace_back([&work, count, slices, slice]() {
+            work(int(qint64(count) * slice / slices), int(qint64(count) * (slice + 1) / slices), slice);
+        });
+    }
+    work(0, int(qint64(count) / slices), 0);
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    return slices;
+}
+
+// Runs work(index) for every index in [0, count) on threadCount threads,
+// each taking the next index when it finishes one, for items of uneven cost
+// such as file reads and decodes. Once stop() returns true no further index
+// is handed out. Meanwhile the calling thread calls report(done) about
+// every 100 ms, and when the last thread finishes. Returns how many items ran.
+template <typename Work, typename Stop, typename Report>
+qint64 forEachItem(qint64 count, int threadCount, Work work, Stop stop, Report report)
+{
+    std::atomic<qint64> next{0};
+    std::atomic<qint64> done{0};
+    int running = 0;
+    std::mutex runningMutex;
+    std::condition_variable allDone;
+    std::vector<std::thread> threads;
+    threadCount = int(qMin<qint64>(qMax(1, threadCount), count));
+    for (int t = 0; t < threadCount; ++t) {
+        {
+            std::lock_guard<std::mutex> lock(runningMutex);
+            ++running;
+        }
+        threads.emplace_back([&]() {
+            while (!stop()) {
+                const qint64 index = next++;
+                if (index >= count) break;
+                work(index);
+                ++done;
+            }
+            std::lock_guard<std::mutex> lock(runningMutex);
+            if (--running == 0) {
+                allDone.notify_one();
+            }
+        });
+    }
+    bool finished = false;
+    while (!finished) {
+        {
+            std::unique_lock<std::mutex> lock(runningMutex);
+            allDone.wait_for(lock, std::chrono::milliseconds(100), [&running]() { return running == 0; });
+            finished = running == 0;
+        }
+        // Outside the lock, so a slow report never holds up a finishing thread
+        report(qint64(done));
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    return done;
+}
+
+#endif // PARALLEL_H
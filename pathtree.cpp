@@ -0,0 +1,244 @@
+#include "pathtree.h"
+#include <QVarLengthArray>
+#include <cstring>
+
+namespace {
+
+quint32 hashName(const char *data, int size)
+{
+    quint32 hash = 2166136261u;
+    for (int i = 0; i < size; ++i) {
+        hash = (hash ^ quint8(data[i])) * 16777619u;
+    }
+    return hash;
+}
+
+quint32 hashChild(PathTree::Id parent, quint32 name)
+{
+    quint64 key = (quint64(parent) << 32) | name;
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    return quint32(key);
+}
+
+// Calls visit(data, size) for each component: one leading slash gives an
+// empty root name, two (a UNC path) give "/", and empty components after
+// that are skipped
+template <typename Visit>
+bool forEachComponent(const QByteArray &path, Visit visit)
+{
+    const char *data = path.constData();
+    const int size = path.size();
+    int start = 0;
+    if (size > 0 && data[0] == '/') {
+        start = size > 1 && data[1] == '/' ? 2 : 1;
+        if (!visit(data, start - 1)) return false;
+    }
+    while (start < size) {
+        const char *slash = static_cast<const char *>(std::memchr(data + start, '/', size - start));
+        const int end = slash ? int(slash - data) : size;
+        if (end > start && !visit(data + start, end - start)) return false;
+        start = end + 1;
+    }
+    return true;
+}
+
+} // namespace
+
+PathTree::Id PathTree::insert(const QString &path)
+{
+    Id id = NoId;
+    forEachComponent(path.toUtf8(), [this, &id](const char *data, int size) {
+        id = addChild(id, internName(data, size));
+        return true;
+    });
+    return id;
+}
+
+PathTree::Id PathTree::find(const QString &path) const
+{
+    Id id = NoId;
+    bool found = forEachComponent(path.toUtf8(), [this, &id](const char *data, int size) {
+        quint32 name = findName(data, size);
+        id = name == NoId ? NoId : findChild(id, name);
+        return id != NoId;
+    });
+    return found ? id : NoId;
+}
+
+QString PathTree::name(Id id) const
+{
+    const Node &node = nodes[int(id)];
+    const quint32 offset = nameOffsets[int(node.name)];
+    return QString::fromUtf8(nameData.constData() + offset, int(nameOffsets[int(node.name) + 1] - offset));
+}
+
+QString PathTree::path(Id id) const
+{
+    return QString::fromUtf8(utf8Path(id, 0));
+}
+
+QString PathTree::childPath(Id id, const QString &fileName) const
+{
+    const QByteArray name = fileName.toUtf8();
+    QByteArray path = utf8Path(id, name.size() + 1);
+    if (!path.endsWith('/')) {
+        path += '/';
+    }
+    path += name;
+    return QString::fromUtf8(path);
+}
+
+bool PathTree::contains(Id ancestor, Id id) const
+{
+    while (id != NoId) {
+        if (id == ancestor) return true;
+        id = nodes[int(id)].parent;
+    }
+    return false;
+}
+
+qint64 PathTree::memoryUsage() const
+{
+    return qint64(nodes.capacity()) * qint64(sizeof(Node)) + nameData.capacity()
+           + qint64(nameOffsets.capacity() + nameSlots.capacity() + childSlots.capacity()) * qint64(sizeof(quint32));
+}
+
+void PathTree::clear()
+{
+    nodes = QVector<Node>();
+    nameData = QByteArray();
+    nameOffsets = QVector<quint32>();
+    nameSlots = QVector<quint32>();
+    childSlots = QVector<quint32>();
+}
+
+quint32 PathTree::findName(const char *data, int size) const
+{
+    if (nameSlots.isEmpty()) return NoId;
+
+    const quint32 mask = quint32(nameSlots.size()) - 1;
+    for (quint32 slot = hashName(data, size) & mask;; slot = (slot + 1) & mask) {
+        const quint32 entry = nameSlots[int(slot)];
+        if (entry == 0) return NoId;
+        const quint32 offset = nameOffsets[int(entry - 1)];
+        if (int(nameOffsets[int(entry)] - offset) == size
+            && std::memcmp(nameData.constData() + offset, data, size_t(size)) == 0) {
+            return entry - 1;
+        }
+    }
+}
+
+quint32 PathTree::internName(const char *data, int size)
+{
+    quint32 name = findName(data, size);
+    if (name != NoId) return name;
+
+    if (nameOffsets.isEmpty()) {
+        nameOffsets.append(0);
+    }
+    if (2 * (nameCount() + 1) > quint32(nameSlots.size())) {
+        growNames();
+    }
+    name = nameCount();
+    nameData.append(data, size);
+    nameOffsets.append(quint32(nameData.size()));
+
+    const quint32 mask = quint32(nameSlots.size()) - 1;
+    quint32 slot = hashName(data, size) & mask;
+    while (nameSlots[int(slot)] != 0) {
+        slot = (slot + 1) & mask;
+    }
+    nameSlots[int(slot)] = name + 1;
+    return name;
+}
+
+PathTree::Id PathTree::findChild(Id parent, quint32 name) const
+{
+    if (childSlots.isEmpty()) return NoId;
+
+    const quint32 mask = quint32(childSlots.size()) - 1;
+    for (quint32 slot = hashChild(parent, name) & mask;; slot = (slot + 1) & mask) {
+        const quint32 entry = childSlots[int(slot)];
+        if (entry == 0) return NoId;
+        const Node &node = nodes[int(entry - 1)];
+        if (node.parent == parent && node.name == name) {
+            return entry - 1;
+        }
+    }
+}
+
+PathTree::Id PathTree::addChild(Id parent, quint32 name)
+{
+    Id id = findChild(parent, name);
+    if (id != NoId) return id;
+
+    if (2 * (nodes.size() + 1) > childSlots.size()) {
+        growChildren();
+    }
+    id = Id(nodes.size());
+    nodes.append(Node{parent, name});
+
+    const quint32 mask = quint32(childSlots.size()) - 1;
+    quint32 slot = hashChild(parent, name) & mask;
+    while (childSlots[int(slot)] != 0) {
+        slot = (slot + 1) & mask;
+    }
+    childSlots[int(slot)] = id + 1;
+    return id;
+}
+
+void PathTree::growNames()
+{
+    nameSlots = QVector<quint32>(qMax(64, nameSlots.size() * 2), 0);
+    const quint32 mask = quint32(nameSlots.size()) - 1;
+    for (quint32 name = 0; name < nameCount(); ++name) {
+        const quint32 offset = nameOffsets[int(name)];
+        quint32 slot = hashName(nameData.constData() + offset, int(nameOffsets[int(name) + 1] - offset)) & mask;
+        while (nameSlots[int(slot)] != 0) {
+            slot = (slot + 1) & mask;
+        }
+        nameSlots[int(slot)] = name + 1;
+    }
+}
+
+void PathTree::growChildren()
+{
+    childSlots = QVector<quint32>(qMax(64, childSlots.size() * 2), 0);
+    const quint32 mask = quint32(childSlots.size()) - 1;
+    for (int id = 0; id < nodes.size(); ++id) {
+        quint32 slot = hashChild(nodes[id].parent, nodes[id].name) & mask;
+        while (childSlots[int(slot)] != 0) {
+            slot = (slot + 1) & mask;
+        }
+        childSlots[int(slot)] = quint32(id) + 1;
+    }
+}
+
+QByteArray PathTree::utf8Path(Id id, int extra) const
+{
+    QVarLengthArray<quint32, 64> chain;
+    int size = 0;
+    for (Id node = id; node != NoId; node = nodes[int(node)].parent) {
+        const quint32 name = nodes[int(node)].name;
+        chain.append(name);
+        size += int(nameOffsets[int(name) + 1] - nameOffsets[int(name)]) + 1;
+    }
+
+    // A lone empty root name is the file system root
+    if (chain.size() == 1 && nameOffsets[int(chain[0]) + 1] == nameOffsets[int(chain[0])]) {
+        return QByteArray("/");
+    }
+
+    QByteArray path;
+    path.reserve(size + extra);
+    for (int i = chain.size() - 1; i >= 0; --i) {
+        const quint32 offset = nameOffsets[int(chain[i])];
+        path.append(nameData.constData() + offset, int(nameOffsets[int(chain[i]) + 1] - offset));
+        if (i > 0) {
+            path += '/';
+        }
+    }
+    return path;
+}
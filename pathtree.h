@@ -0,0 +1,63 @@
+#ifndef PATHTREE_H
+#define PATHTREE_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+// Folder paths stored as a tree of (parent, name) nodes with dense integer
+// IDs. Each distinct path component is kept once, as UTF-8 in one arena, so
+// a node costs eight bytes plus its share of two hash tables no matter how
+// deep it sits. Full paths are built on demand with path().
+//
+// Paths use '/' separators as everywhere else in Qt. A leading "/" becomes a
+// root node with an empty name, so path() gives back what was inserted.
+class PathTree
+{
+public:
+    typedef quint32 Id;
+    static const Id NoId = 0xffffffffu;
+
+    // Returns the node for path, adding it and any missing ancestors
+    Id insert(const QString &path);
+    // NoId when path was never inserted
+    Id find(const QString &path) const;
+
+    Id parent(Id id) const { return nodes[int(id)].parent; }
+    QString name(Id id) const;
+    QString path(Id id) const;
+    // path(id) + "/" + fileName, built in one go
+    QString childPath(Id id, const QString &fileName) const;
+    // True when id is ancestor itself or lies below it
+    bool contains(Id ancestor, Id id) const;
+
+    int size() const { return nodes.size(); }
+    qint64 memoryUsage() const;
+    void clear();
+
+private:
+    struct Node
+    {
+        Id parent;
+        quint32 name;
+    };
+
+    QVector<Node> nodes;
+    // Name i is nameData[nameOffsets[i], nameOffsets[i + 1])
+    QByteArray nameData;
+    QVector<quint32> nameOffsets;
+    // Open addressing tables; a slot holds index + 1 and 0 when free
+    QVector<quint32> nameSlots;
+    QVector<quint32> childSlots;
+
+    quint32 nameCount() const { return quint32(nameOffsets.size()) - 1; }
+    quint32 internName(const char *data, int size);
+    quint32 findName(const char *data, int size) const;
+    Id addChild(Id parent, quint32 name);
+    Id findChild(Id parent, quint32 name) const;
+    void growNames();
+    void growChildren();
+    QByteArray utf8Path(Id id, int extra) const;
+};
+
+#endif // PATHTREE_H
@@ -0,0 +1,28 @@
+#include "perceptualhash.h"
+#include "imageloader.h"
+
+quint64 PerceptualHash::fromImage(const QImage &image)
+{
+    QImage grey = image.convertToFormat(QImage::Format_Grayscale8)
+                      .scaled(9, 8, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+
+    quint64 hash = 0;
+    for (int y = 0; y < 8; ++y) {
+        const uchar *row = grey.constScanLine(y);
+        for (int x = 0; x < 8; ++x) {
+            hash = (hash << 1) | (row[x] > row[x + 1] ? 1 : 0);
+        }
+    }
+    return hash;
+}
+
+bool PerceptualHash::fromFile(const QString &path, quint64 &hash)
+{
+    // Decoders that can scale while decoding (JPEG) make this much cheaper than a full decode
+    QImage image = ImageLoader::load(path, QSize(64, 64));
+    if (image.isNull()) {
+        return false;
+    }
+    hash = fromImage(image);
+    return true;
+}
@@ -0,0 +1,25 @@
+#ifndef PERCEPTUALHASH_H
+#define PERCEPTUALHASH_H
+
+#include <QImage>
+#include <QString>
+#include <QtAlgorithms>
+
+// 64-bit difference hash (dHash): the image is reduced to 9x8 grey pixels and
+// each bit records whether a pixel is brighter than its right neighbour.
+// Resized, recompressed and lightly edited copies land within a few bits of
+// each other, so similarity is the Hamming distance between hashes.
+class PerceptualHash
+{
+public:
+    static quint64 fromImage(const QImage &image);
+    // Decodes path at a small size; false when it cannot be read
+    static bool fromFile(const QString &path, quint64 &hash);
+
+    static int distance(quint64 a, quint64 b)
+    {
+        return qPopulationCount(a ^ b);
+    }
+};
+
+#endif // PERCEPTUALHASH_H
@@ -0,0 +1,118 @@
+#include "similarityfinder.h"
+#include "catalog.h"
+#include "fileoperations.h"
+#include "parallel.h"
+#include "perceptualhash.h"
+#include "similarityindex.h"
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QHash>
+#include <vector>
+
+SimilarityFinder::SimilarityFinder(const QStringList &folders, Catalog *catalog, const QStringList &mediaExtensions,
+                                   int maxDistance, QObject *parent)
+    : QThread(parent)
+    , folders(folders)
+    , catalog(catalog)
+    , mediaExtensions(mediaExtensions)
+    , maxDistance(qBound(0, maxDistance, 16))
+{
+}
+
+QVector<QStringList> SimilarityFinder::groups() const
+{
+    return result;
+}
+
+bool SimilarityFinder::isCompleted() const
+{
+    return completed;
+}
+
+void SimilarityFinder::run()
+{
+    struct Image
+    {
+        QString path;
+        CatalogMediaFile file;
+    };
+
+    // Listing with the full extension list lets the catalog answer
+    FileOperations fileOperations;
+    if (catalog) {
+        fileOperations.setCatalog(catalog, mediaExtensions);
+    }
+    std::vector<Image> images;
+    std::vector<Image *> missing;
+    QElapsedTimer sinceProgress;
+    sinceProgress.start();
+    for (int i = 0; i < folders.size() && !isInterruptionRequested(); ++i) {
+        const QVector<CatalogMediaFile> files = fileOperations.getCurrentMediaFileInfo(folders[i], mediaExtensions);
+        // The root is "/" already; a second separator would not match the catalog's paths
+        const QString prefix = folders[i].endsWith('/') ? folders[i] : folders[i] + "/";
+        for (const CatalogMediaFile &file : files) {
+            if (file.type == MediaType::Image) {
+                images.push_back({prefix + file.name, file});
+            }
+        }
+        if (sinceProgress.elapsed() >= 100) {
+            emit progress("Listing images", i + 1, folders.size());
+            sinceProgress.restart();
+        }
+    }
+    if (isInterruptionRequested()) return;
+    for (Image &image : images) {
+        if (!image.file.hasPerceptualHash) {
+            missing.push_back(&image);
+        }
+    }
+
+    // Decoding dominates, so every core gets a share of the missing hashes
+    const qint64 total = qint64(missing.size());
+    const qint64 done = forEachItem(total, QThread::idealThreadCount(),
+        [&](qint64 index) {
+            CatalogMediaFile &file = missing[size_t(index)]->file;
+            file.hasPerceptualHash = PerceptualHash::fromFile(missing[size_t(index)]->path, file.perceptualHash);
+        },
+        [this]() { return isInterruptionRequested(); },
+        [this, total](qint64 count) { emit progress("Hashing images", count, total); });
+
+    // Keep whatever was hashed, even when cancelled, so the next run resumes from there
+    if (catalog && done > 0) {
+        QHash<QString, CatalogMediaFile> hashed;
+        hashed.reserve(int(done));
+        for (const Image *image : missing) {
+            if (image->file.hasPerceptualHash) {
+                hashed.insert(image->path, image->file);
+            }
+        }
+        emit progress("Saving hashes", 0, 0);
+        catalog->storePerceptualHashes(hashed);
+    }
+    if (isInterruptionRequested()) return;
+
+    emit progress("Comparing images", 0, 0);
+    QVector<quint64> hashes;
+    std::vector<const Image *> hashedImages;
+    hashes.reserve(int(images.size()));
+    for (const Image &image : images) {
+        if (image.file.hasPerceptualHash) {
+            hashes.append(image.file.perceptualHash);
+            hashedImages.push_back(&image);
+        }
+    }
+    SimilarityIndex index;
+    index.build(hashes);
+
+    result.clear();
+    const QVector<QVector<int>> groups = index.groups(maxDistance);
+    for (const QVector<int> &group : groups) {
+        QStringList paths;
+        for (int member : group) {
+            paths.append(hashedImages[size_t(member)]->path);
+        }
+        paths.sort();
+        result.append(paths);
+    }
+    completed = true;
+}
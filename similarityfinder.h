@@ -0,0 +1,43 @@
+#ifndef SIMILARITYFINDER_H
+#define SIMILARITYFINDER_H
+
+#include <QThread>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+class Catalog;
+
+// Groups visually similar images of the scanned folders on a worker thread.
+// Perceptual hashes come from the catalog where possible; missing ones are
+// computed in parallel and written back, so only new or changed images are
+// ever decoded twice. Cancel with requestInterruption().
+class SimilarityFinder : public QThread
+{
+    Q_OBJECT
+
+public:
+    SimilarityFinder(const QStringList &folders, Catalog *catalog, const QStringList &mediaExtensions,
+                     int maxDistance, QObject *parent = nullptr);
+
+    // Valid once the thread has finished; largest group first, paths sorted
+    QVector<QStringList> groups() const;
+    // False when the search was interrupted
+    bool isCompleted() const;
+
+signals:
+    void progress(const QString &stage, qint64 done, qint64 total);
+
+protected:
+    void run() override;
+
+private:
+    QStringList folders;
+    Catalog *catalog;
+    QStringList mediaExtensions;
+    int maxDistance;
+    QVector<QStringList> result;
+    bool completed = false;
+};
+
+#endif // SIMILARITYFINDER_H
@@ -0,0 +1,177 @@
+#include "similarityindex.h"
+#include <QThread>
+#include <QtAlgorithms>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <numeric>
+#include <thread>
+
+// The distance kernel is built for both POPCNT and baseline x86-64 and the
+// loader picks one, so a portable binary still gets the single-instruction popcount
+#if defined(__GNUC__) && defined(__x86_64__) && defined(Q_OS_LINUX) && defined(__has_attribute)
+#if __has_attribute(target_clones)
+#define SMARTRABBIT_POPCNT_CLONES __attribute__((target_clones("popcnt", "default")))
+#endif
+#endif
+#ifndef SMARTRABBIT_POPCNT_CLONES
+#define SMARTRABBIT_POPCNT_CLONES
+#endif
+
+namespace {
+
+const quint32 chunkMask = 0xFFFF;
+
+// Appends the ids of bucket entries within maxDistance of query. A hash whose
+// chunk before this one is within chunkRadius was already reported by that chunk.
+SMARTRABBIT_POPCNT_CLONES
+void scanBucket(const quint32 *ids, const quint64 *hashes, quint32 count, quint64 query,
+                int maxDistance, int chunk, int chunkRadius, std::vector<int> &matches)
+{
+    for (quint32 i = 0; i < count; ++i) {
+        const quint64 difference = hashes[i] ^ query;
+        if (qPopulationCount(difference) > maxDistance) {
+            continue;
+        }
+        bool reported = false;
+        for (int earlier = 0; earlier < chunk && !reported; ++earlier) {
+            reported = qPopulationCount(quint16(difference >> (earlier * 16))) <= chunkRadius;
+        }
+        if (!reported) {
+            matches.push_back(int(ids[i]));
+        }
+    }
+}
+
+// Calls visit for every 16-bit value within radius bits of value
+template <typename Visit>
+void forEachNeighbour(quint32 value, int radius, int firstBit, const Visit &visit)
+{
+    visit(value);
+    if (radius == 0) return;
+    for (int bit = firstBit; bit < 16; ++bit) {
+        forEachNeighbour(value ^ (1u << bit), radius - 1, bit + 1, visit);
+    }
+}
+
+int findRoot(std::vector<int> &parent, int i)
+{
+    while (parent[i] != i) {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+} // namespace
+
+void SimilarityIndex::build(const QVector<quint64> &hashes)
+{
+    this->hashes = hashes;
+    const quint32 count = quint32(hashes.size());
+
+    for (int chunk = 0; chunk < chunkCount; ++chunk) {
+        std::vector<quint32> &chunkOffsets = offsets[chunk];
+        chunkOffsets.assign(chunkMask + 2, 0);
+        for (quint64 hash : hashes) {
+            ++chunkOffsets[((hash >> (chunk * chunkBits)) & chunkMask) + 1];
+        }
+        std::partial_sum(chunkOffsets.begin(), chunkOffsets.end(), chunkOffsets.begin());
+
+        std::vector<quint32> fill(chunkOffsets.begin(), chunkOffsets.end() - 1);
+        std::vector<quint32> &chunkIds = ids[chunk];
+        std::vector<quint64> &chunkHashes = bucketHashes[chunk];
+        chunkIds.resize(count);
+        chunkHashes.resize(count);
+        for (quint32 i = 0; i < count; ++i) {
+            const quint32 slot = fill[(hashes[int(i)] >> (chunk * chunkBits)) & chunkMask]++;
+            chunkIds[slot] = i;
+            chunkHashes[slot] = hashes[int(i)];
+        }
+    }
+}
+
+int SimilarityIndex::size() const
+{
+    return hashes.size();
+}
+
+void SimilarityIndex::search(quint64 query, int maxDistance, std::vector<int> &matches) const
+{
+    matches.clear();
+    if (hashes.isEmpty() || maxDistance < 0) return;
+
+    const int radius = qMin(maxDistance / chunkCount, chunkBits);
+    for (int chunk = 0; chunk < chunkCount; ++chunk) {
+        const quint32 value = quint32(query >> (chunk * chunkBits)) & chunkMask;
+        const quint32 *chunkIds = ids[chunk].data();
+        const quint64 *chunkHashes = bucketHashes[chunk].data();
+        const std::vector<quint32> &chunkOffsets = offsets[chunk];
+        forEachNeighbour(value, radius, 0, [&](quint32 probe) {
+            const quint32 begin = chunkOffsets[probe];
+            scanBucket(chunkIds + begin, chunkHashes + begin, chunkOffsets[probe + 1] - begin,
+                       query, maxDistance, chunk, radius, matches);
+        });
+    }
+}
+
+QVector<QVector<int>> SimilarityIndex::groups(int maxDistance) const
+{
+    const int count = hashes.size();
+    std::vector<int> parent(static_cast<size_t>(count));
+    std::iota(parent.begin(), parent.end(), 0);
+    std::mutex parentMutex;
+
+    // Every hash is a query; pairs are merged in blocks to keep the lock cold
+    std::atomic<int> next{0};
+    const int blockSize = 1024;
+    const int threadCount = qMax(1, qMin(QThread::idealThreadCount(), (count + blockSize - 1) / blockSize));
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threadCount; ++t) {
+        threads.emplace_back([&]() {
+            std::vector<int> matches;
+            std::vector<std::pair<int, int>> pairs;
+            for (;;) {
+                const int begin = next.fetch_add(blockSize);
+                if (begin >= count) break;
+                const int end = qMin(begin + blockSize, count);
+                for (int i = begin; i < end; ++i) {
+                    search(hashes[i], maxDistance, matches);
+                    for (int j : matches) {
+                        if (j > i) {
+                            pairs.emplace_back(i, j);
+                        }
+                    }
+                }
+
+                std::lock_guard<std::mutex> lock(parentMutex);
+                for (const auto &pair : pairs) {
+                    int a = findRoot(parent, pair.first);
+                    int b = findRoot(parent, pair.second);
+                    if (a != b) {
+                        parent[size_t(qMax(a, b))] = qMin(a, b);
+                    }
+                }
+                pairs.clear();
+            }
+        });
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+
+    QVector<QVector<int>> members(count);
+    for (int i = 0; i < count; ++i) {
+        members[findRoot(parent, i)].append(i);
+    }
+    QVector<QVector<int>> result;
+    for (QVector<int> &group : members) {
+        if (group.size() > 1) {
+            result.append(std::move(group));
+        }
+    }
+    std::stable_sort(result.begin(), result.end(), [](const QVector<int> &a, const QVector<int> &b) {
+        return a.size() > b.size();
+    });
+    return result;
+}
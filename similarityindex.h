@@ -0,0 +1,34 @@
+#ifndef SIMILARITYINDEX_H
+#define SIMILARITYINDEX_H
+
+#include <QVector>
+#include <vector>
+
+// Multi-index hashing over 64-bit perceptual hashes. Each hash is split into
+// four 16-bit chunks with one bucket table per chunk; two hashes within
+// distance d must agree to within d/4 bits on at least one chunk, so a query
+// only probes the buckets near its own chunks instead of scanning everything.
+class SimilarityIndex
+{
+public:
+    void build(const QVector<quint64> &hashes);
+    int size() const;
+
+    // Indexes of all hashes within maxDistance of query, query itself included if present
+    void search(quint64 query, int maxDistance, std::vector<int> &matches) const;
+    // Connected groups of hashes that are within maxDistance of each other, largest first
+    QVector<QVector<int>> groups(int maxDistance) const;
+
+private:
+    static constexpr int chunkCount = 4;
+    static constexpr int chunkBits = 16;
+
+    QVector<quint64> hashes;
+    // Counting-sorted ids per chunk; bucket v is ids[offsets[v]..offsets[v + 1]).
+    // The hashes are stored again in bucket order so a probe reads contiguous memory.
+    std::vector<quint32> offsets[chunkCount];
+    std::vector<quint32> ids[chunkCount];
+    std::vector<quint64> bucketHashes[chunkCount];
+};
+
+#endif // SIMILARITYINDEX_H
@@ -0,0 +1,92 @@
+#include "thumbnailmodel.h"
+#include "thumbnailstore.h"
+#include "tracer.h"
+#include <QFileInfo>
+
+ThumbnailModel::ThumbnailModel(ThumbnailStore *store, QObject *parent)
+    : QAbstractListModel(parent)
+    , store(store)
+{
+    // Cost is in KiB; 64 MiB holds a few thousand grid thumbnails
+    pixmaps.setMaxCost(64 * 1024);
+    connect(store, &ThumbnailStore::thumbnailReady, this, &ThumbnailModel::onThumbnailReady);
+}
+
+void ThumbnailModel::setFolder(const QString &folder, const QStringList &files)
+{
+    beginResetModel();
+    if (folder != this->folder || folder.isEmpty()) {
+        // Rows of the old folder that were never painted don't need thumbnails any more
+        store->cancelPending();
+        pixmaps.clear();
+        this->folder = folder;
+    }
+    requested.clear();
+    failed.clear();
+    this->files = files;
+    rows.clear();
+    rows.reserve(files.size());
+    for (int i = 0; i < files.size(); ++i) {
+        rows.insert(files[i], i);
+    }
+    endResetModel();
+}
+
+int ThumbnailModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : int(files.size());
+}
+
+QVariant ThumbnailModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= files.size()) {
+        return QVariant();
+    }
+
+    const QString &file = files[index.row()];
+    switch (role) {
+    case Qt::DisplayRole:
+        return folder.isEmpty() ? QFileInfo(file).fileName() : file;
+    case Qt::ToolTipRole:
+        return file;
+    case Qt::DecorationRole:
+        if (QPixmap *pixmap = pixmaps.object(file)) {
+            return *pixmap;
+        }
+        if (!requested.contains(file) && !failed.contains(file)) {
+            requested.insert(file);
+            store->request(folder.isEmpty() ? file : folder + "/" + file);
+        }
+        return QVariant();
+    default:
+        return QVariant();
+    }
+}
+
+void ThumbnailModel::onThumbnailReady(const QString &path, const QImage &thumbnail)
+{
+    QFileInfo info(path);
+    if (!folder.isEmpty() && info.path() != folder) return;
+    const QString file = folder.isEmpty() ? path : info.fileName();
+
+    // Evicted thumbnails are requested again when their row is painted next
+    requested.remove(file);
+    int row = rows.value(file, -1);
+    if (row < 0) return;
+    if (thumbnail.isNull()) {
+        failed.insert(file);
+        return;
+    }
+
+    // Video posters are stored larger than grid thumbnails
+    QImage image = thumbnail;
+    const QSize box(ThumbnailStore::thumbnailSize, ThumbnailStore::thumbnailSize);
+    if (image.width() > box.width() || image.height() > box.height()) {
+        TraceSpan span("scale", "image");
+        image = image.scaled(box, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    }
+
+    QPixmap *pixmap = new QPixmap(QPixmap::fromImage(image));
+    pixmaps.insert(file, pixmap, qMax<qsizetype>(1, image.sizeInBytes() / 1024));
+    emit dataChanged(index(row), index(row), {Qt::DecorationRole});
+}
@@ -0,0 +1,43 @@
+#ifndef THUMBNAILMODEL_H
+#define THUMBNAILMODEL_H
+
+#include <QAbstractListModel>
+#include <QCache>
+#include <QHash>
+#include <QPixmap>
+#include <QSet>
+#include <QStringList>
+
+class ThumbnailStore;
+
+// Media files of one folder as a list model for the thumbnail grid. Rows are
+// cheap; a thumbnail is only requested when the view asks for the decoration
+// of a row it is about to paint, so only the visible part of a huge folder
+// costs any decoding.
+class ThumbnailModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    explicit ThumbnailModel(ThumbnailStore *store, QObject *parent = nullptr);
+
+    // With an empty folder, files are full paths from anywhere
+    void setFolder(const QString &folder, const QStringList &files);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+private slots:
+    void onThumbnailReady(const QString &path, const QImage &thumbnail);
+
+private:
+    ThumbnailStore *store;
+    QString folder;
+    QStringList files;
+    QHash<QString, int> rows;
+    mutable QCache<QString, QPixmap> pixmaps;
+    mutable QSet<QString> requested;
+    QSet<QString> failed;
+};
+
+#endif // THUMBNAILMODEL_H
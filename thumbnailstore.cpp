@@ -0,0 +1,293 @@
+#include "thumbnailstore.h"
+#include "imageloader.h"
+#include "mediatype.h"
+#include <QBuffer>
+#include <QDateTime>
+#include <QFileInfo>
+#include <QMetaObject>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QThread>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+const char packMagic[8] = {'S', 'R', 'T', 'H', 'U', 'M', 'B', '1'};
+const quint32 recordMagic = 0x54485242; // "BRHT"
+
+struct RecordHeader
+{
+    quint32 magic;
+    quint32 length; // of the JPEG data that follows
+    quint64 pathHash;
+    qint64 size;
+    qint64 mtime;
+};
+
+quint64 hashPath(const QString &path)
+{
+    // FNV-1a, stable across runs unlike qHash
+    quint64 hash = 14695981039346656037ULL;
+    const QByteArray bytes = path.toUtf8();
+    for (char c : bytes) {
+        hash ^= quint8(c);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+} // namespace
+
+ThumbnailStore::ThumbnailStore(const QString &filePath, QObject *parent)
+    : QObject(parent)
+    , file(filePath)
+{
+    pool.setMaxThreadCount(qMax(2, QThread::idealThreadCount()));
+    connect(&frameExtractor, &VideoFrameExtractor::frameReady, this, &ThumbnailStore::onFrameExtracted);
+    open();
+}
+
+ThumbnailStore::~ThumbnailStore()
+{
+    cancelPending();
+    pool.waitForDone();
+}
+
+bool ThumbnailStore::isVideo(const QString &path) const
+{
+    const MediaType type = MediaClassifier::typeOf(path);
+    return type == MediaType::Video || (type == MediaType::Unknown && MediaClassifier::sniffFile(path) == MediaType::Video);
+}
+
+bool ThumbnailStore::open()
+{
+    if (!file.open(QIODevice::ReadWrite)) {
+        return false;
+    }
+
+    if (file.size() < qint64(sizeof(packMagic))) {
+        file.resize(0);
+        file.write(packMagic, sizeof(packMagic));
+        file.flush();
+        return true;
+    }
+
+    const qint64 size = file.size();
+    const uchar *data = file.map(0, size);
+    if (!data || std::memcmp(data, packMagic, sizeof(packMagic)) != 0) {
+        if (data) file.unmap(const_cast<uchar *>(data));
+        file.resize(0);
+        file.write(packMagic, sizeof(packMagic));
+        file.flush();
+        return true;
+    }
+
+    // Later records for the same path replace earlier ones
+    qint64 offset = sizeof(packMagic);
+    while (offset + qint64(sizeof(RecordHeader)) <= size) {
+        RecordHeader header;
+        std::memcpy(&header, data + offset, sizeof(header));
+        qint64 end = offset + qint64(sizeof(header)) + header.length;
+        if (header.magic != recordMagic || end > size) {
+            break;
+        }
+        index.insert(header.pathHash, {offset + qint64(sizeof(header)), header.length, header.size, header.mtime});
+        offset = end;
+    }
+
+    // Every rewritten file leaves its old thumbnail behind; drop those once
+    // they outweigh the live ones
+    qint64 liveBytes = 0;
+    for (const Location &location : std::as_const(index)) {
+        liveBytes += qint64(sizeof(RecordHeader)) + location.length;
+    }
+    const qint64 deadBytes = offset - qint64(sizeof(packMagic)) - liveBytes;
+    QSaveFile compacted(file.fileName());
+    QHash<quint64, Location> moved;
+    const bool compact = deadBytes > liveBytes && compacted.open(QIODevice::WriteOnly)
+                         && writeLiveRecords(data, compacted, moved);
+    file.unmap(const_cast<uchar *>(data));
+
+    if (compact) {
+        // The old pack is closed first so the new one can replace it
+        file.close();
+        if (compacted.commit()) {
+            index = moved;
+            return file.open(QIODevice::ReadWrite);
+        }
+        if (!file.open(QIODevice::ReadWrite)) {
+            return false;
+        }
+    }
+
+    // Cut off a record left half-written by a crash
+    if (offset < size) {
+        file.resize(offset);
+    }
+    return true;
+}
+
+bool ThumbnailStore::writeLiveRecords(const uchar *data, QIODevice &out, QHash<quint64, Location> &moved) const
+{
+    // Pack order keeps the thumbnails of one folder close together
+    QVector<QPair<quint64, Location>> live;
+    live.reserve(index.size());
+    for (auto it = index.constBegin(); it != index.constEnd(); ++it) {
+        live.append({it.key(), it.value()});
+    }
+    std::sort(live.begin(), live.end(), [](const QPair<quint64, Location> &a, const QPair<quint64, Location> &b) {
+        return a.second.offset < b.second.offset;
+    });
+
+    if (out.write(packMagic, sizeof(packMagic)) != qint64(sizeof(packMagic))) {
+        return false;
+    }
+    qint64 offset = sizeof(packMagic);
+    moved.reserve(live.size());
+    for (const QPair<quint64, Location> &entry : std::as_const(live)) {
+        const Location &location = entry.second;
+        const qint64 length = qint64(sizeof(RecordHeader)) + location.length;
+        const char *record = reinterpret_cast<const char *>(data + location.offset - qint64(sizeof(RecordHeader)));
+        if (out.write(record, length) != length) {
+            return false;
+        }
+        moved.insert(entry.first, {offset + qint64(sizeof(RecordHeader)), location.length, location.size, location.mtime});
+        offset += length;
+    }
+    return true;
+}
+
+bool ThumbnailStore::find(const QString &path, qint64 size, qint64 mtime, QImage &thumbnail)
+{
+    QByteArray data;
+    {
+        QMutexLocker locker(&mutex);
+        auto it = index.constFind(hashPath(path));
+        if (it == index.constEnd() || it->size != size || it->mtime != mtime) {
+            return false;
+        }
+        if (!file.seek(it->offset)) {
+            return false;
+        }
+        data = file.read(it->length);
+    }
+    return thumbnail.loadFromData(data, "JPG");
+}
+
+void ThumbnailStore::insert(const QString &path, qint64 size, qint64 mtime, const QImage &thumbnail)
+{
+    QByteArray data;
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::WriteOnly);
+    if (!thumbnail.save(&buffer, "JPG", 85)) {
+        return;
+    }
+
+    RecordHeader header = {};
+    header.magic = recordMagic;
+    header.length = quint32(data.size());
+    header.pathHash = hashPath(path);
+    header.size = size;
+    header.mtime = mtime;
+
+    QMutexLocker locker(&mutex);
+    if (!file.isOpen()) return;
+
+    qint64 offset = file.size();
+    file.seek(offset);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(data);
+    file.flush();
+    index.insert(header.pathHash, {offset + qint64(sizeof(header)), header.length, size, mtime});
+}
+
+void ThumbnailStore::request(const QString &path)
+{
+    const int jobGeneration = generation;
+
+    // Ever-increasing priority makes the pool run the newest request first
+    pool.start([this, path, jobGeneration]() {
+        if (jobGeneration != generation) return;
+
+        if (isVideo(path)) {
+            QImage poster;
+            if (findCurrent(path, poster)) {
+                QMetaObject::invokeMethod(this, [this, path, poster, jobGeneration]() {
+                    if (jobGeneration == generation) {
+                        emit thumbnailReady(path, poster);
+                    }
+                }, Qt::QueuedConnection);
+            } else {
+                QMetaObject::invokeMethod(this, [this, path, jobGeneration]() {
+                    if (jobGeneration == generation) {
+                        frameExtractor.request(path);
+                    }
+                }, Qt::QueuedConnection);
+            }
+            return;
+        }
+
+        QImage thumbnail = generate(path);
+        QMetaObject::invokeMethod(this, [this, path, thumbnail, jobGeneration]() {
+            if (jobGeneration == generation) {
+                emit thumbnailReady(path, thumbnail);
+            }
+        }, Qt::QueuedConnection);
+    }, nextPriority++);
+}
+
+void ThumbnailStore::cancelPending()
+{
+    ++generation;
+    pool.clear();
+    frameExtractor.cancelPending();
+    nextPriority = 0;
+}
+
+bool ThumbnailStore::findCurrent(const QString &path, QImage &thumbnail)
+{
+    QFileInfo info(path);
+    return find(path, info.size(), info.lastModified().toMSecsSinceEpoch() * 1000000LL, thumbnail);
+}
+
+void ThumbnailStore::onFrameExtracted(const QString &path, const QImage &frame)
+{
+    if (frame.isNull()) {
+        emit thumbnailReady(path, frame);
+        return;
+    }
+
+    // Scaling and JPEG encoding stay off the GUI thread
+    const int jobGeneration = generation;
+    pool.start([this, path, frame, jobGeneration]() {
+        QFileInfo info(path);
+        QImage poster = frame.scaled(QSize(posterSize, posterSize).boundedTo(frame.size()),
+                                     Qt::KeepAspectRatio, Qt::SmoothTransformation);
+        insert(path, info.size(), info.lastModified().toMSecsSinceEpoch() * 1000000LL, poster);
+
+        QMetaObject::invokeMethod(this, [this, path, poster, jobGeneration]() {
+            if (jobGeneration == generation) {
+                emit thumbnailReady(path, poster);
+            }
+        }, Qt::QueuedConnection);
+    }, nextPriority++);
+}
+
+QImage ThumbnailStore::generate(const QString &path)
+{
+    QFileInfo info(path);
+    const qint64 size = info.size();
+    const qint64 mtime = info.lastModified().toMSecsSinceEpoch() * 1000000LL;
+
+    QImage thumbnail;
+    if (find(path, size, mtime, thumbnail)) {
+        return thumbnail;
+    }
+
+    thumbnail = ImageLoader::load(path, QSize(thumbnailSize, thumbnailSize));
+    if (!thumbnail.isNull()) {
+        insert(path, size, mtime, thumbnail);
+    }
+    return thumbnail;
+}
@@ -0,0 +1,75 @@
+#ifndef THUMBNAILSTORE_H
+#define THUMBNAILSTORE_H
+
+#include <QObject>
+#include <QFile>
+#include <QHash>
+#include <QImage>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+#include <atomic>
+#include "videoframeextractor.h"
+
+// Persistent thumbnails in a single append-only pack file next to the config.
+// Each record is keyed by a hash of the media path and stamped with the file's
+// size and mtime, so a thumbnail is only reused for the exact file version it
+// was made from. Thumbnails are generated on a private thread pool, newest
+// requests first, so whatever was scrolled into view last is served first.
+// Videos get a poster frame from the VideoFrameExtractor instead, stored at
+// posterSize so the single media view can show it as well. Records replaced
+// by newer ones are dropped when the pack is opened, once they take up more
+// space than the live ones.
+class ThumbnailStore : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int thumbnailSize = 160;
+    static constexpr int posterSize = 640;
+
+    explicit ThumbnailStore(const QString &filePath, QObject *parent = nullptr);
+    ~ThumbnailStore();
+
+    // Thread-safe access to the pack file
+    bool find(const QString &path, qint64 size, qint64 mtime, QImage &thumbnail);
+    void insert(const QString &path, qint64 size, qint64 mtime, const QImage &thumbnail);
+    // find() for the file as it is on disk now
+    bool findCurrent(const QString &path, QImage &thumbnail);
+
+    // Load or generate the thumbnail of path in the background; thumbnailReady() follows
+    void request(const QString &path);
+    // Drop queued requests and ignore results of ones already running
+    void cancelPending();
+
+signals:
+    // thumbnail is null when none could be made
+    void thumbnailReady(const QString &path, const QImage &thumbnail);
+
+private:
+    struct Location
+    {
+        qint64 offset;
+        quint32 length;
+        qint64 size;
+        qint64 mtime;
+    };
+
+    bool open();
+    bool writeLiveRecords(const uchar *data, QIODevice &out, QHash<quint64, Location> &moved) const;
+    bool isVideo(const QString &path) const;
+    QImage generate(const QString &path);
+    void onFrameExtracted(const QString &path, const QImage &frame);
+
+    QFile file;
+    QMutex mutex;
+    QHash<quint64, Location> index;
+
+    QThreadPool pool;
+    VideoFrameExtractor frameExtractor;
+    std::atomic<int> generation{0};
+    int nextPriority = 0;
+};
+
+#endif // THUMBNAILSTORE_H
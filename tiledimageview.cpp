@@ -0,0 +1,437 @@
+#include "tiledimageview.h"
+#include "tracer.h"
+#include <QImageIOHandler>
+#include <QImageReader>
+#include <QKeyEvent>
+#include <QLineF>
+#include <QMetaObject>
+#include <QMouseEvent>
+#include <QMutexLocker>
+#include <QPainter>
+#include <QThread>
+#include <QWheelEvent>
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace {
+
+// Stored to shown coordinates. QImageReader mirrors and flips first and
+// then turns a quarter clockwise, so the tiles are drawn the same way.
+QTransform orientationTransform(QImageIOHandler::Transformations transformation, const QSize &size)
+{
+    QTransform transform;
+    if (transformation & QImageIOHandler::TransformationMirror) {
+        transform = transform * QTransform(-1, 0, 0, 1, size.width(), 0);
+    }
+    if (transformation & QImageIOHandler::TransformationFlip) {
+        transform = transform * QTransform(1, 0, 0, -1, 0, size.height());
+    }
+    if (transformation & QImageIOHandler::TransformationRotate90) {
+        transform = transform * QTransform(0, 1, -1, 0, size.height(), 0);
+    }
+    return transform;
+}
+
+// Decodes source (all of the image when null) to size, without orientation
+QImage decodeRegion(const QString &path, const QRect &source, const QSize &size)
+{
+    TraceSpan span("decode", "tile");
+    const qint64 start = Tracer::now();
+    QImageReader reader(path);
+    reader.setAutoTransform(false);
+    if (!source.isNull()) {
+        reader.setClipRect(source);
+    }
+    reader.setScaledSize(size);
+    QImage image = reader.read();
+    Tracer::count(TraceCounter::ImagesDecoded);
+    Tracer::count(TraceCounter::DecodeNanoseconds, Tracer::now() - start);
+    return image;
+}
+
+const double maxZoom = 8.0;
+// Formats that cannot scale while decoding are read whole before they are
+// scaled; past Qt 6's default QImageReader allocation limit that read fails
+const qint64 maxFullDecodeBytes = 256LL * 1024 * 1024;
+
+} // namespace
+
+TiledImageView::TiledImageView(QWidget *parent)
+    : QWidget(parent)
+{
+    setFocusPolicy(Qt::StrongFocus);
+    setCursor(Qt::OpenHandCursor);
+    pool.setMaxThreadCount(qMax(2, QThread::idealThreadCount() / 2));
+    setMemoryBudget(128LL * 1024 * 1024);
+}
+
+TiledImageView::~TiledImageView()
+{
+    {
+        QMutexLocker locker(&queueMutex);
+        ++generation;
+        queue.clear();
+    }
+    pool.clear();
+    pool.waitForDone();
+}
+
+void TiledImageView::setMemoryBudget(qint64 bytes)
+{
+    tiles.setMaxCost(qMax<qint64>(bytes, 1));
+}
+
+bool TiledImageView::setImage(const QString &imagePath)
+{
+    clear();
+
+    QImageReader reader(imagePath);
+    const QSize size = reader.size();
+    if (!size.isValid() || size.isEmpty()) {
+        return false;
+    }
+    if (!reader.supportsOption(QImageIOHandler::ScaledSize)
+        && qint64(size.width()) * size.height() * 4 > maxFullDecodeBytes) {
+        return false;
+    }
+    {
+        QMutexLocker locker(&queueMutex);
+        path = imagePath;
+    }
+    storedSize = size;
+    orientation = orientationTransform(reader.transformation(), size);
+    imageSize = orientation.mapRect(QRectF(QPointF(0, 0), QSizeF(size))).size().toSize();
+
+    // Tiling pays off for levels still larger than the overview, and only
+    // when the format crops while decoding rather than after
+    tiled = reader.supportsOption(QImageIOHandler::ClipRect) && reader.supportsOption(QImageIOHandler::ScaledSize);
+    levels = 0;
+    QSize overviewTarget = size.scaled(overviewSize, overviewSize, Qt::KeepAspectRatio).boundedTo(size);
+    if (tiled) {
+        while ((qMax(size.width(), size.height()) >> levels) > overviewSize) {
+            ++levels;
+        }
+    } else {
+        // Then the overview is all there is, as detailed as half the budget allows
+        const double pixels = double(tiles.maxCost()) / 8;
+        const double scale = qMin(1.0, std::sqrt(pixels / (double(size.width()) * size.height())));
+        overviewTarget = QSize(qMax(1, int(size.width() * scale)), qMax(1, int(size.height() * scale)));
+    }
+
+    const QString file = imagePath;
+    const int overviewGeneration = generation;
+    pool.start([this, file, overviewTarget, overviewGeneration]() {
+        const QImage image = decodeRegion(file, QRect(), overviewTarget);
+        QMetaObject::invokeMethod(this, [this, image, overviewGeneration]() {
+            onOverviewDecoded(image, overviewGeneration);
+        }, Qt::QueuedConnection);
+    }, 1);
+
+    fitToWindow();
+    return true;
+}
+
+void TiledImageView::clear()
+{
+    {
+        QMutexLocker locker(&queueMutex);
+        ++generation;
+        queue.clear();
+        inFlight.clear();
+        path.clear();
+    }
+    tiles.clear();
+    overview = QImage();
+    storedSize = QSize();
+    imageSize = QSize();
+    orientation = QTransform();
+    tiled = false;
+    levels = 0;
+    dragging = false;
+    update();
+}
+
+void TiledImageView::fitToWindow()
+{
+    if (imageSize.isEmpty()) return;
+
+    fitZoom = qMin(double(width()) / imageSize.width(), double(height()) / imageSize.height());
+    if (fitZoom <= 0) {
+        fitZoom = 1.0;
+    }
+    setView(fitZoom, QPointF(imageSize.width() / 2.0, imageSize.height() / 2.0));
+}
+
+void TiledImageView::zoomBy(double factor, const QPointF &anchor)
+{
+    if (imageSize.isEmpty()) return;
+
+    const double newZoom = qBound(qMin(fitZoom, 1.0), zoom * factor, qMax(maxZoom, fitZoom));
+    const QPointF point = viewTransform().inverted().map(anchor);
+    const QPointF middle(width() / 2.0, height() / 2.0);
+    setView(newZoom, point - (anchor - middle) / newZoom);
+}
+
+void TiledImageView::toggleActualSize(const QPointF &anchor)
+{
+    if (zoom < 1.0) {
+        zoomBy(1.0 / zoom, anchor);
+    } else {
+        fitToWindow();
+    }
+}
+
+QRect TiledImageView::tileRect(int level, int x, int y) const
+{
+    const int span = tileSize << level;
+    return QRect(x * span, y * span, span, span) & QRect(QPoint(0, 0), storedSize);
+}
+
+QRect TiledImageView::levelTiles(int level, const QRectF &storedArea) const
+{
+    if (storedArea.isEmpty()) return QRect();
+
+    const int span = tileSize << level;
+    const int lastX = (storedSize.width() - 1) / span;
+    const int lastY = (storedSize.height() - 1) / span;
+    return QRect(QPoint(qBound(0, int(std::floor(storedArea.left() / span)), lastX),
+                        qBound(0, int(std::floor(storedArea.top() / span)), lastY)),
+                 QPoint(qBound(0, int(std::floor(storedArea.right() / span)), lastX),
+                        qBound(0, int(std::floor(storedArea.bottom() / span)), lastY)));
+}
+
+int TiledImageView::levelFor(double viewZoom) const
+{
+    // The coarsest level with at least one image pixel per screen pixel
+    return viewZoom >= 1.0 ? 0 : int(std::floor(std::log2(1.0 / viewZoom)));
+}
+
+QTransform TiledImageView::viewTransform() const
+{
+    QTransform transform;
+    transform.translate(width() / 2.0, height() / 2.0);
+    transform.scale(zoom, zoom);
+    transform.translate(-center.x(), -center.y());
+    return transform;
+}
+
+QRectF TiledImageView::visibleArea() const
+{
+    const QRectF shown = viewTransform().inverted().mapRect(QRectF(rect()))
+                         & QRectF(QPointF(0, 0), QSizeF(imageSize));
+    return orientation.inverted().mapRect(shown);
+}
+
+void TiledImageView::setView(double viewZoom, const QPointF &viewCenter)
+{
+    const double previousZoom = zoom;
+    zoom = viewZoom;
+
+    // A side smaller than the view stays centred; a larger one keeps its edges at the view's
+    const double halfWidth = width() / 2.0 / zoom;
+    const double halfHeight = height() / 2.0 / zoom;
+    center.setX(imageSize.width() <= 2 * halfWidth ? imageSize.width() / 2.0
+                                                   : qBound(halfWidth, viewCenter.x(), imageSize.width() - halfWidth));
+    center.setY(imageSize.height() <= 2 * halfHeight ? imageSize.height() / 2.0
+                                                     : qBound(halfHeight, viewCenter.y(), imageSize.height() - halfHeight));
+    update();
+    requestTiles();
+    if (zoom != previousZoom) {
+        emit zoomChanged(zoom);
+    }
+}
+
+void TiledImageView::requestTiles()
+{
+    const int level = levelFor(zoom);
+    struct Candidate
+    {
+        double distance;
+        TileJob job;
+    };
+    QVector<Candidate> candidates;
+    if (level < levels) {
+        const QRectF area = visibleArea();
+        const QRect range = levelTiles(level, area);
+        const int scale = 1 << level;
+        for (int y = range.top(); y <= range.bottom(); ++y) {
+            for (int x = range.left(); x <= range.right(); ++x) {
+                const quint64 tileKey = key(level, x, y);
+                if (tiles.contains(tileKey)) continue;
+                const QRect source = tileRect(level, x, y);
+                const QSize size((source.width() + scale - 1) / scale, (source.height() + scale - 1) / scale);
+                candidates.append({QLineF(QRectF(source).center(), area.center()).length(), {tileKey, source, size}});
+            }
+        }
+        std::sort(candidates.begin(), candidates.end(), [](const Candidate &a, const Candidate &b) {
+            return a.distance < b.distance;
+        });
+    }
+
+    // Whatever went out of view is dropped from the queue
+    QMutexLocker locker(&queueMutex);
+    queue.clear();
+    for (const Candidate &candidate : std::as_const(candidates)) {
+        if (!inFlight.contains(candidate.job.key)) {
+            queue.append(candidate.job);
+        }
+    }
+    const int wantedWorkers = qMin(pool.maxThreadCount(), int(queue.size()));
+    while (activeWorkers < wantedWorkers) {
+        ++activeWorkers;
+        pool.start([this]() {
+            runWorker();
+        });
+    }
+}
+
+void TiledImageView::runWorker()
+{
+    // Workers outlive images: whatever is queued belongs to the current one
+    for (;;) {
+        TileJob job;
+        QString file;
+        int jobGeneration;
+        {
+            QMutexLocker locker(&queueMutex);
+            if (queue.isEmpty()) {
+                --activeWorkers;
+                return;
+            }
+            job = queue.takeFirst();
+            inFlight.insert(job.key);
+            file = path;
+            jobGeneration = generation;
+        }
+
+        const QImage tile = decodeRegion(file, job.source, job.size);
+        const quint64 tileKey = job.key;
+        QMetaObject::invokeMethod(this, [this, tileKey, tile, jobGeneration]() {
+            onTileDecoded(tileKey, tile, jobGeneration);
+        }, Qt::QueuedConnection);
+    }
+}
+
+void TiledImageView::onTileDecoded(quint64 tileKey, const QImage &tile, int tileGeneration)
+{
+    {
+        QMutexLocker locker(&queueMutex);
+        if (tileGeneration != generation) return;
+        inFlight.remove(tileKey);
+    }
+    if (!tile.isNull()) {
+        tiles.insert(tileKey, new QImage(tile), qMax<qsizetype>(tile.sizeInBytes(), 1));
+        update();
+    }
+}
+
+void TiledImageView::onOverviewDecoded(const QImage &image, int overviewGeneration)
+{
+    if (overviewGeneration != generation) return;
+    overview = image;
+    update();
+}
+
+void TiledImageView::paintEvent(QPaintEvent *)
+{
+    QPainter painter(this);
+    painter.fillRect(rect(), QColor("#f8f9fa"));
+    if (path.isEmpty()) return;
+
+    painter.setRenderHint(QPainter::SmoothPixmapTransform);
+    painter.setTransform(orientation * viewTransform());
+    if (!overview.isNull()) {
+        painter.drawImage(QRectF(QPointF(0, 0), QSizeF(storedSize)), overview);
+    }
+
+    // Cached tiles of a few coarser levels first, so the finer ones cover them
+    const int level = levelFor(zoom);
+    if (level >= levels) return;
+    const QRectF area = visibleArea();
+    for (int coarser = qMin(levels - 1, level + 3); coarser >= level; --coarser) {
+        const QRect range = levelTiles(coarser, area);
+        for (int y = range.top(); y <= range.bottom(); ++y) {
+            for (int x = range.left(); x <= range.right(); ++x) {
+                if (const QImage *tile = tiles.object(key(coarser, x, y))) {
+                    painter.drawImage(QRectF(tileRect(coarser, x, y)), *tile);
+                }
+            }
+        }
+    }
+}
+
+void TiledImageView::resizeEvent(QResizeEvent *event)
+{
+    QWidget::resizeEvent(event);
+    if (imageSize.isEmpty()) return;
+
+    // Stay fitted when fitted, otherwise keep the zoom and the middle
+    const bool fitted = qFuzzyCompare(zoom, fitZoom);
+    fitZoom = qMin(double(width()) / imageSize.width(), double(height()) / imageSize.height());
+    if (fitted) {
+        fitToWindow();
+    } else {
+        setView(zoom, center);
+    }
+}
+
+void TiledImageView::wheelEvent(QWheelEvent *event)
+{
+    const double steps = event->angleDelta().y() / 120.0;
+    if (steps != 0) {
+        zoomBy(std::pow(1.25, steps), event->position());
+    }
+    event->accept();
+}
+
+void TiledImageView::mousePressEvent(QMouseEvent *event)
+{
+    if (event->button() != Qt::LeftButton) {
+        QWidget::mousePressEvent(event);
+        return;
+    }
+    dragging = true;
+    dragStart = event->pos();
+    dragCenter = center;
+    setCursor(Qt::ClosedHandCursor);
+}
+
+void TiledImageView::mouseMoveEvent(QMouseEvent *event)
+{
+    if (!dragging) return;
+    setView(zoom, dragCenter - QPointF(event->pos() - dragStart) / zoom);
+}
+
+void TiledImageView::mouseReleaseEvent(QMouseEvent *event)
+{
+    if (event->button() == Qt::LeftButton) {
+        dragging = false;
+        setCursor(Qt::OpenHandCursor);
+    }
+}
+
+void TiledImageView::mouseDoubleClickEvent(QMouseEvent *event)
+{
+    toggleActualSize(event->position());
+}
+
+void TiledImageView::keyPressEvent(QKeyEvent *event)
+{
+    const QPointF middle(width() / 2.0, height() / 2.0);
+    switch (event->key()) {
+    case Qt::Key_Plus:
+    case Qt::Key_Equal:
+        zoomBy(1.25, middle);
+        break;
+    case Qt::Key_Minus:
+        zoomBy(1 / 1.25, middle);
+        break;
+    case Qt::Key_0:
+        fitToWindow();
+        break;
+    default:
+        // Navigation and the rest are the main window's
+        QWidget::keyPressEvent(event);
+    }
+}
@@ -0,0 +1,113 @@
+#ifndef TILEDIMAGEVIEW_H
+#define TILEDIMAGEVIEW_H
+
+#include <QWidget>
+#include <QCache>
+#include <QImage>
+#include <QMutex>
+#include <QSet>
+#include <QString>
+#include <QThreadPool>
+#include <QTransform>
+#include <QVector>
+
+// Zoom and pan viewer for images far larger than the screen. The image is
+// cut into tiles per level of detail (level n is 1/2^n of full size) and
+// only tiles in view are decoded, at the coarsest level that still gives
+// one image pixel per screen pixel, with QImageReader's clip rect and
+// scaled size so a 300 MP JPEG never exists in memory whole. Tiles decode
+// on a private pool and live in an LRU cache with a byte budget; until a
+// tile arrives, cached tiles of coarser levels and a small overview of the
+// whole image stand in for it.
+//
+// Tiles are cut in stored (file) coordinates; EXIF orientation is applied
+// when drawing. Formats that cannot decode a clip rect natively fall back
+// to one image decoded as large as the budget allows.
+class TiledImageView : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit TiledImageView(QWidget *parent = nullptr);
+    ~TiledImageView();
+
+    // Opens path fitted to the view; false when it cannot be read, or is too
+    // large to decode in a format without scaled decoding
+    bool setImage(const QString &path);
+    void clear();
+    QString imagePath() const { return path; }
+
+    void setMemoryBudget(qint64 bytes);
+
+    void fitToWindow();
+    // Multiplies the zoom, keeping the image point under anchor in place
+    void zoomBy(double factor, const QPointF &anchor);
+    // Switches between fitted and 1:1 around anchor
+    void toggleActualSize(const QPointF &anchor);
+    double zoomFactor() const { return zoom; }
+
+signals:
+    void zoomChanged(double zoom);
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void wheelEvent(QWheelEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
+    void mouseMoveEvent(QMouseEvent *event) override;
+    void mouseReleaseEvent(QMouseEvent *event) override;
+    void mouseDoubleClickEvent(QMouseEvent *event) override;
+    void keyPressEvent(QKeyEvent *event) override;
+
+private:
+    static const int tileSize = 512;
+    static const int overviewSize = 1024;
+
+    QString path;
+    QSize storedSize;     // as in the file
+    QSize imageSize;      // as shown, after orientation
+    QTransform orientation; // stored to shown coordinates
+    bool tiled = false;   // the format decodes clip rects itself
+    int levels = 0;       // tiled levels, finest first; coarser views use the overview
+    QImage overview;
+
+    double zoom = 1.0;    // screen pixels per image pixel
+    double fitZoom = 1.0;
+    QPointF center;       // image point at the middle of the view
+    QPoint dragStart;
+    QPointF dragCenter;
+    bool dragging = false;
+
+    // Decoded tiles by key(); cost is their size in bytes
+    QCache<quint64, QImage> tiles;
+
+    struct TileJob
+    {
+        quint64 key;
+        QRect source; // stored coordinates
+        QSize size;   // decoded size
+    };
+
+    // Shared with the workers, along with path: tiles still to decode,
+    // nearest to the middle of the view first, and those being decoded
+    QMutex queueMutex;
+    QVector<TileJob> queue;
+    QSet<quint64> inFlight;
+    int generation = 0;
+    int activeWorkers = 0;
+    QThreadPool pool;
+
+    static quint64 key(int level, int x, int y) { return quint64(level) << 48 | quint64(y) << 24 | quint64(x); }
+    QRect tileRect(int level, int x, int y) const; // in stored coordinates
+    QRect levelTiles(int level, const QRectF &storedArea) const;
+    int levelFor(double zoom) const;
+    QTransform viewTransform() const; // shown image to widget coordinates
+    QRectF visibleArea() const;       // in stored coordinates
+    void setView(double zoom, const QPointF &center);
+    void requestTiles();
+    void runWorker();
+    void onTileDecoded(quint64 tileKey, const QImage &tile, int tileGeneration);
+    void onOverviewDecoded(const QImage &image, int overviewGeneration);
+};
+
+#endif // TILEDIMAGEVIEW_H
@@ -0,0 +1,161 @@
+#include "tracer.h"
+#include <QCoreApplication>
+#include <QFile>
+#include <QThread>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+struct Span
+{
+    const char *name;
+    const char *category;
+    qint64 start;
+    qint64 duration;
+};
+
+// Bounds memory when tracing is left on
+const size_t maxSpansPerThread = 1 << 20;
+
+struct ThreadBuffer
+{
+    std::mutex mutex; // only contended while exporting
+    std::vector<Span> spans;
+    int threadId = 0;
+    QByteArray threadName;
+    bool inUse = true;
+};
+
+const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+// Buffers outlive their threads, so spans of finished workers still export.
+// A new thread takes over the buffer of one that has ended, which keeps the
+// count bounded however many short-lived worker threads come and go.
+std::mutex registryMutex;
+std::vector<std::unique_ptr<ThreadBuffer>> registry;
+
+struct ThreadSlot
+{
+    ThreadBuffer *buffer = nullptr;
+    ~ThreadSlot()
+    {
+        if (buffer) {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            buffer->inUse = false;
+        }
+    }
+};
+
+ThreadBuffer &threadBuffer()
+{
+    thread_local ThreadSlot slot;
+    if (slot.buffer) {
+        return *slot.buffer;
+    }
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+    for (const std::unique_ptr<ThreadBuffer> &buffer : registry) {
+        if (!buffer->inUse) {
+            buffer->inUse = true;
+            slot.buffer = buffer.get();
+            return *slot.buffer;
+        }
+    }
+    registry.push_back(std::make_unique<ThreadBuffer>());
+    slot.buffer = registry.back().get();
+    slot.buffer->threadId = int(registry.size());
+    const bool mainThread = QCoreApplication::instance() && QThread::currentThread() == QCoreApplication::instance()->thread();
+    slot.buffer->threadName = mainThread ? QByteArray("main") : "worker " + QByteArray::number(slot.buffer->threadId);
+    return *slot.buffer;
+}
+
+} // namespace
+
+std::atomic<bool> Tracer::enabled{false};
+std::atomic<qint64> Tracer::counters[int(TraceCounter::Count)] = {};
+
+void Tracer::setEnabled(bool enabled)
+{
+    Tracer::enabled.store(enabled, std::memory_order_relaxed);
+}
+
+qint64 Tracer::now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+void Tracer::record(const char *name, const char *category, qint64 startNs, qint64 durationNs)
+{
+    ThreadBuffer &buffer = threadBuffer();
+    std::lock_guard<std::mutex> lock(buffer.mutex);
+    if (buffer.spans.size() < maxSpansPerThread) {
+        buffer.spans.push_back({name, category, startNs, durationNs});
+    }
+}
+
+void Tracer::clear()
+{
+    std::lock_guard<std::mutex> lock(registryMutex);
+    for (const std::unique_ptr<ThreadBuffer> &buffer : registry) {
+        std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+        buffer->spans.clear();
+        buffer->spans.shrink_to_fit();
+    }
+}
+
+qint64 Tracer::spanCount()
+{
+    qint64 count = 0;
+    std::lock_guard<std::mutex> lock(registryMutex);
+    for (const std::unique_ptr<ThreadBuffer> &buffer : registry) {
+        std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+        count += qint64(buffer->spans.size());
+    }
+    return count;
+}
+
+bool Tracer::writeChromeTrace(const QString &path, QString *error)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        if (error) *error = file.errorString();
+        return false;
+    }
+
+    // Written by hand: a trace easily holds millions of spans
+    const QByteArray pid = QByteArray::number(QCoreApplication::applicationPid());
+    QByteArray out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    std::lock_guard<std::mutex> lock(registryMutex);
+    for (const std::unique_ptr<ThreadBuffer> &buffer : registry) {
+        std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+        const QByteArray tid = QByteArray::number(buffer->threadId);
+        out += first ? "\n" : ",\n";
+        first = false;
+        out += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" + pid + ",\"tid\":" + tid
+               + ",\"args\":{\"name\":\"" + buffer->threadName + "\"}}";
+        for (const Span &span : buffer->spans) {
+            out += ",\n{\"name\":\"";
+            out += span.name;
+            out += "\",\"cat\":\"";
+            out += span.category;
+            out += "\",\"ph\":\"X\",\"ts\":" + QByteArray::number(span.start / 1000.0, 'f', 3)
+                   + ",\"dur\":" + QByteArray::number(span.duration / 1000.0, 'f', 3)
+                   + ",\"pid\":" + pid + ",\"tid\":" + tid + "}";
+            if (out.size() > (1 << 20)) {
+                file.write(out);
+                out.clear();
+            }
+        }
+    }
+    out += "\n]}\n";
+    file.write(out);
+    if (!file.flush()) {
+        if (error) *error = file.errorString();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,77 @@
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <QString>
+#include <QtGlobal>
+#include <atomic>
+
+// Always-on counters for the debug panel. Each is one relaxed atomic add.
+enum class TraceCounter {
+    FoldersScanned,
+    FilesListed,
+    ImagesDecoded,
+    DecodeNanoseconds,
+    CacheHits,
+    CacheMisses,
+    FilesDeleted,
+    Count
+};
+
+// Records timed spans of the hot paths while tracing is switched on and
+// writes them as Chrome trace-event JSON (chrome://tracing, Perfetto). Every
+// thread appends to a buffer of its own, so recording takes no shared lock;
+// while tracing is off a span costs one atomic load.
+class Tracer
+{
+public:
+    static void setEnabled(bool enabled);
+    static bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+
+    static void count(TraceCounter counter, qint64 delta = 1)
+    {
+        counters[int(counter)].fetch_add(delta, std::memory_order_relaxed);
+    }
+    static qint64 counter(TraceCounter counter)
+    {
+        return counters[int(counter)].load(std::memory_order_relaxed);
+    }
+
+    // name and category must be string literals; they are stored as pointers
+    static void record(const char *name, const char *category, qint64 startNs, qint64 durationNs);
+    static qint64 now();
+
+    // Drops the spans recorded so far
+    static void clear();
+    static qint64 spanCount();
+    static bool writeChromeTrace(const QString &path, QString *error = nullptr);
+
+private:
+    static std::atomic<bool> enabled;
+    static std::atomic<qint64> counters[int(TraceCounter::Count)];
+};
+
+// Times the enclosing scope when tracing is on
+class TraceSpan
+{
+public:
+    TraceSpan(const char *name, const char *category)
+        : name(name), category(category), start(Tracer::isEnabled() ? Tracer::now() : -1)
+    {
+    }
+    ~TraceSpan()
+    {
+        if (start >= 0) {
+            Tracer::record(name, category, start, Tracer::now() - start);
+        }
+    }
+
+    TraceSpan(const TraceSpan &) = delete;
+    TraceSpan &operator=(const TraceSpan &) = delete;
+
+private:
+    const char *name;
+    const char *category;
+    qint64 start;
+};
+
+#endif // TRACER_H
@@ -0,0 +1,292 @@
+#include "transferqueue.h"
+#include "batchfileops.h"
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMetaObject>
+#include <QVector>
+#include <cerrno>
+#include <functional>
+#include <vector>
+
+#ifdef Q_OS_LINUX
+#include <fcntl.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// How much is copied per call; also how often a large copy checks for shutdown
+const qint64 transferChunk = 8 * 1024 * 1024;
+const int progressIntervalMs = 100;
+const int maxNameAttempts = 1000;
+
+int renameNoReplace(const QString &from, const QString &to)
+{
+    QVector<FileOp> ops{BatchFileOps::rename(from, to)};
+    BatchFileOps::run(ops);
+    return ops.first().error;
+}
+
+// "name.jpg", then "name (2).jpg", "name (3).jpg" and so on
+QString candidatePath(const QString &folder, const QString &fileName, int attempt)
+{
+    if (attempt == 1) {
+        return folder + "/" + fileName;
+    }
+    const QFileInfo info(fileName);
+    const QString suffix = info.suffix().isEmpty() ? QString() : "." + info.suffix();
+    return QString("%1/%2 (%3)%4").arg(folder, info.completeBaseName()).arg(attempt).arg(suffix);
+}
+
+// Renames from to the first free name in folder; returns 0 or an errno
+int renameToFreeName(const QString &from, const QString &folder, const QString &fileName, QString *target)
+{
+    for (int attempt = 1; attempt <= maxNameAttempts; ++attempt) {
+        *target = candidatePath(folder, fileName, attempt);
+        int error = renameNoReplace(from, *target);
+        if (error != EEXIST) {
+            return error;
+        }
+    }
+    return EEXIST;
+}
+
+#ifdef Q_OS_LINUX
+// Copies size bytes between descriptors, preferring copy_file_range (the data
+// never passes through user space, and file systems that share extents clone
+// instead of copying), then sendfile, then plain read and write
+int copyContents(int in, int out, qint64 size, const std::function<void(qint64)> &copied, const std::atomic<bool> &stop)
+{
+    bool useCopyRange = true;
+    bool useSendfile = true;
+    std::vector<char> buffer;
+    qint64 done = 0;
+    while (done < size) {
+        if (stop) {
+            return ECANCELED;
+        }
+        const size_t chunk = size_t(qMin(size - done, transferChunk));
+        ssize_t n;
+        if (useCopyRange) {
+            n = ::copy_file_range(in, nullptr, out, nullptr, chunk, 0);
+            if (n < 0 && (errno == EXDEV || errno == ENOSYS || errno == EINVAL || errno == EOPNOTSUPP)) {
+                useCopyRange = false;
+                continue;
+            }
+        } else if (useSendfile) {
+            n = ::sendfile(out, in, nullptr, chunk);
+            if (n < 0 && (errno == EINVAL || errno == ENOSYS)) {
+                useSendfile = false;
+                continue;
+            }
+        } else {
+            buffer.resize(1024 * 1024);
+            n = ::read(in, buffer.data(), qMin(chunk, buffer.size()));
+            for (ssize_t written = 0; n > 0 && written < n;) {
+                ssize_t w = ::write(out, buffer.data() + written, size_t(n - written));
+                if (w < 0) {
+                    if (errno == EINTR) continue;
+                    return errno;
+                }
+                written += w;
+            }
+        }
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return errno;
+        }
+        if (n == 0) {
+            break; // the file got shorter
+        }
+        done += n;
+        copied(n);
+    }
+    return 0;
+}
+#endif
+
+} // namespace
+
+TransferQueue::TransferQueue(QObject *parent)
+    : QObject(parent)
+{
+    worker = std::thread([this]() { runWorker(); });
+}
+
+TransferQueue::~TransferQueue()
+{
+    // A copy in progress is abandoned and its temporary file removed
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        stopping = true;
+    }
+    queueChanged.notify_all();
+    worker.join();
+}
+
+void TransferQueue::enqueue(const QString &source, const QString &targetFolder, bool copy)
+{
+    Job job;
+    job.id = nextId++;
+    job.source = source;
+    job.targetFolder = QDir(targetFolder).absolutePath();
+    job.copy = copy;
+    job.size = QFileInfo(source).size();
+
+    jobs.insert(job.id, job);
+    if (!copy) {
+        ++pendingMoves[source];
+    }
+    bytesTotal += job.size;
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        queue.push_back(job);
+    }
+    queueChanged.notify_one();
+    emit progress(int(jobs.size()), bytesDone, bytesTotal);
+}
+
+void TransferQueue::runWorker()
+{
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            queueChanged.wait(lock, [this]() { return stopping || !queue.empty(); });
+            if (stopping) return;
+            job = queue.front();
+            queue.pop_front();
+        }
+
+        QString target;
+        const QString error = runJob(job, &target);
+        const quint64 id = job.id;
+        QMetaObject::invokeMethod(this, [this, id, target, error]() { onJobDone(id, target, error); }, Qt::QueuedConnection);
+    }
+}
+
+QString TransferQueue::runJob(const Job &job, QString *target)
+{
+    const QString fileName = QFileInfo(job.source).fileName();
+    if (!job.copy) {
+        int error = renameToFreeName(job.source, job.targetFolder, fileName, target);
+        if (error == 0) {
+            addBytesDone(job.size);
+            return QString();
+        }
+        // Other file system (EIO is all the Qt fallback reports)
+        if (error != EXDEV && error != EIO) {
+            return BatchFileOps::errorString(error);
+        }
+    }
+
+    // Hidden, so scans and listings pass over it until it is complete
+    const QString temporary = QString("%1/.smartrabbit-%2-%3.part").arg(job.targetFolder)
+                                  .arg(QCoreApplication::applicationPid()).arg(job.id);
+    QString error = copyToTemporary(job, temporary);
+    if (!error.isEmpty()) {
+        return error;
+    }
+    int renameError = renameToFreeName(temporary, job.targetFolder, fileName, target);
+    if (renameError != 0) {
+        QFile::remove(temporary);
+        return BatchFileOps::errorString(renameError);
+    }
+    if (!job.copy && !QFile::remove(job.source)) {
+        return "Copied, but the original could not be removed";
+    }
+    return QString();
+}
+
+QString TransferQueue::copyToTemporary(const Job &job, const QString &temporary)
+{
+#ifdef Q_OS_LINUX
+    const QByteArray temporaryName = QFile::encodeName(temporary);
+    int in = ::open(QFile::encodeName(job.source).constData(), O_RDONLY | O_CLOEXEC);
+    if (in < 0) {
+        return BatchFileOps::errorString(errno);
+    }
+    struct stat st;
+    if (::fstat(in, &st) != 0) {
+        int error = errno;
+        ::close(in);
+        return BatchFileOps::errorString(error);
+    }
+    int out = ::open(temporaryName.constData(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+    if (out < 0) {
+        int error = errno;
+        ::close(in);
+        return BatchFileOps::errorString(error);
+    }
+    ::posix_fadvise(in, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    int error = copyContents(in, out, st.st_size, [this](qint64 bytes) { addBytesDone(bytes); }, stopping);
+    if (error == 0) {
+        // Keep permissions and modification time; a move also makes sure the
+        // copy is on disk before the original goes away
+        ::fchmod(out, st.st_mode & 07777);
+        const struct timespec times[2] = {st.st_atim, st.st_mtim};
+        ::futimens(out, times);
+        if (!job.copy && ::fdatasync(out) != 0) {
+            error = errno;
+        }
+    }
+    if (::close(out) != 0 && error == 0) {
+        error = errno;
+    }
+    ::close(in);
+    if (error != 0) {
+        ::unlink(temporaryName.constData());
+        return BatchFileOps::errorString(error);
+    }
+    return QString();
+#else
+    if (!QFile::copy(job.source, temporary)) {
+        QFile::remove(temporary);
+        return "Could not copy the file";
+    }
+    addBytesDone(job.size);
+    return QString();
+#endif
+}
+
+void TransferQueue::addBytesDone(qint64 bytes)
+{
+    bytesDone += bytes;
+    const auto now = std::chrono::steady_clock::now();
+    if (now - lastProgress < std::chrono::milliseconds(progressIntervalMs)) {
+        return;
+    }
+    lastProgress = now;
+    QMetaObject::invokeMethod(this, [this]() {
+        emit progress(int(jobs.size()), bytesDone, bytesTotal);
+    }, Qt::QueuedConnection);
+}
+
+void TransferQueue::onJobDone(quint64 id, const QString &target, const QString &error)
+{
+    const Job job = jobs.take(id);
+    if (!job.copy) {
+        auto it = pendingMoves.find(job.source);
+        if (it != pendingMoves.end() && --it.value() == 0) {
+            pendingMoves.erase(it);
+        }
+    }
+
+    if (error.isEmpty()) {
+        emit transferred(job.source, target, job.copy);
+    } else {
+        emit failed(job.source, job.copy, error);
+    }
+
+    // The worker is idle once every job is done
+    if (jobs.isEmpty()) {
+        bytesDone = 0;
+        bytesTotal = 0;
+    }
+    emit progress(int(jobs.size()), bytesDone, bytesTotal);
+}
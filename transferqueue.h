@@ -0,0 +1,73 @@
+#ifndef TRANSFERQUEUE_H
+#define TRANSFERQUEUE_H
+
+#include <QHash>
+#include <QObject>
+#include <QString>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+// Moves and copies media into target folders on a background thread, one
+// file at a time so transfers to the same disk do not compete. A move within
+// a file system is a rename. Data that has to cross file systems is copied
+// by the kernel with copy_file_range (or sendfile) into a hidden temporary
+// file, which is renamed into place once complete; a move then unlinks the
+// original. Existing files are never replaced: a taken name gets " (2)" and
+// so on appended.
+class TransferQueue : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit TransferQueue(QObject *parent = nullptr);
+    ~TransferQueue();
+
+    void enqueue(const QString &source, const QString &targetFolder, bool copy);
+
+    int pendingCount() const { return int(jobs.size()); }
+    // A move of this file has been queued and has not finished yet
+    bool isMovePending(const QString &source) const { return pendingMoves.contains(source); }
+
+signals:
+    // Bytes are counted over all transfers since the queue was last empty
+    void progress(int pending, qint64 bytesDone, qint64 bytesTotal);
+    void transferred(const QString &source, const QString &target, bool copy);
+    void failed(const QString &source, bool copy, const QString &error);
+
+private:
+    struct Job
+    {
+        quint64 id = 0;
+        QString source;
+        QString targetFolder;
+        bool copy = false;
+        qint64 size = 0;
+    };
+
+    void runWorker();
+    QString runJob(const Job &job, QString *target);
+    QString copyToTemporary(const Job &job, const QString &temporary);
+    void addBytesDone(qint64 bytes);
+    void onJobDone(quint64 id, const QString &target, const QString &error);
+
+    // Owned by the GUI thread
+    QHash<quint64, Job> jobs; // queued or running
+    QHash<QString, int> pendingMoves;
+    quint64 nextId = 1;
+    qint64 bytesTotal = 0;
+
+    std::atomic<qint64> bytesDone{0};
+    std::chrono::steady_clock::time_point lastProgress; // worker only
+
+    std::mutex queueMutex;
+    std::condition_variable queueChanged;
+    std::deque<Job> queue;
+    std::atomic<bool> stopping{false};
+    std::thread worker;
+};
+
+#endif // TRANSFERQUEUE_H
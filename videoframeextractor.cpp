@@ -0,0 +1,136 @@
+#include "videoframeextractor.h"
+#include <QMetaObject>
+#include <QTimer>
+
+#ifdef SMARTRABBIT_HAVE_MULTIMEDIA
+#include <QMediaPlayer>
+#include <QUrl>
+#include <QVideoFrame>
+#include <QVideoSink>
+#endif
+
+VideoFrameWorker::~VideoFrameWorker()
+{
+    clear();
+}
+
+void VideoFrameWorker::enqueue(const QString &path)
+{
+    queue.append(path);
+    startNext();
+}
+
+void VideoFrameWorker::clear()
+{
+    queue.clear();
+    const QList<Job *> jobs = running;
+    for (Job *job : jobs) {
+        finish(job, QImage(), false);
+    }
+}
+
+void VideoFrameWorker::startNext()
+{
+    while (running.size() < maxConcurrent && !queue.isEmpty()) {
+        const QString path = queue.takeFirst();
+
+#ifdef SMARTRABBIT_HAVE_MULTIMEDIA
+        Job *job = new Job;
+        job->path = path;
+        job->player = new QMediaPlayer(this);
+        job->sink = new QVideoSink(this);
+        job->timeout = new QTimer(this);
+        job->timeout->setSingleShot(true);
+        running.append(job);
+
+        // Give up eventually, settling for any frame seen on the way
+        connect(job->timeout, &QTimer::timeout, this, [this, job]() {
+            finish(job, job->lastFrame);
+        });
+        connect(job->player, &QMediaPlayer::errorOccurred, this, [this, job]() {
+            finish(job, QImage());
+        });
+        connect(job->player, &QMediaPlayer::mediaStatusChanged, this, [this, job](QMediaPlayer::MediaStatus status) {
+            if (status == QMediaPlayer::InvalidMedia) {
+                finish(job, QImage());
+            } else if (status == QMediaPlayer::LoadedMedia) {
+                // A tenth in skips black lead-in frames, but never more than ten seconds
+                qint64 targetMs = qMin<qint64>(job->player->duration() / 10, 10000);
+                job->targetUs = targetMs * 1000;
+                if (targetMs > 0) {
+                    job->player->setPosition(targetMs);
+                }
+                job->player->play();
+            } else if (status == QMediaPlayer::EndOfMedia) {
+                finish(job, job->lastFrame);
+            }
+        });
+        connect(job->sink, &QVideoSink::videoFrameChanged, this, [this, job](const QVideoFrame &frame) {
+            if (!frame.isValid()) return;
+
+            job->lastFrame = frame.toImage();
+            // Backends that ignore the seek start from zero; keep going until the target
+            if (frame.startTime() < 0 || frame.startTime() + 1000000 >= job->targetUs) {
+                finish(job, job->lastFrame);
+            }
+        });
+
+        job->player->setVideoSink(job->sink);
+        job->player->setSource(QUrl::fromLocalFile(path));
+        job->timeout->start(timeoutMs);
+#else
+        emit frameReady(path, QImage());
+#endif
+    }
+}
+
+void VideoFrameWorker::finish(Job *job, const QImage &frame, bool report)
+{
+    if (!running.removeOne(job)) return;
+
+    // frame may refer to job->lastFrame
+    const QImage result = frame;
+
+#ifdef SMARTRABBIT_HAVE_MULTIMEDIA
+    job->player->disconnect(this);
+    job->sink->disconnect(this);
+    job->timeout->disconnect(this);
+    job->player->stop();
+    job->player->deleteLater();
+    job->sink->deleteLater();
+    job->timeout->deleteLater();
+#endif
+    const QString path = job->path;
+    delete job;
+
+    if (report) {
+        emit frameReady(path, result);
+    }
+    startNext();
+}
+
+VideoFrameExtractor::VideoFrameExtractor(QObject *parent)
+    : QObject(parent)
+    , worker(new VideoFrameWorker)
+{
+    worker->moveToThread(&thread);
+    connect(&thread, &QThread::finished, worker, &QObject::deleteLater);
+    connect(worker, &VideoFrameWorker::frameReady, this, &VideoFrameExtractor::frameReady);
+    thread.start(QThread::LowPriority);
+}
+
+VideoFrameExtractor::~VideoFrameExtractor()
+{
+    thread.quit();
+    thread.wait();
+}
+
+void VideoFrameExtractor::request(const QString &path)
+{
+    QMetaObject::invokeMethod(worker, [this, path]() { worker->enqueue(path); }, Qt::QueuedConnection);
+}
+
+void VideoFrameExtractor::cancelPending()
+{
+    QMetaObject::invokeMethod(worker, [this]() { worker->clear(); }, Qt::QueuedConnection);
+}
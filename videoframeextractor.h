@@ -0,0 +1,76 @@
+#ifndef VIDEOFRAMEEXTRACTOR_H
+#define VIDEOFRAMEEXTRACTOR_H
+
+#include <QObject>
+#include <QImage>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QThread>
+
+class QMediaPlayer;
+class QVideoSink;
+class QTimer;
+
+// Lives on the extractor thread and drives at most maxConcurrent media
+// players at a time, each grabbing one frame about a tenth into its video
+class VideoFrameWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int maxConcurrent = 2;
+    static constexpr int timeoutMs = 10000;
+
+    using QObject::QObject;
+    ~VideoFrameWorker();
+
+    void enqueue(const QString &path);
+    void clear();
+
+signals:
+    void frameReady(const QString &path, const QImage &frame);
+
+private:
+    struct Job
+    {
+        QString path;
+        QMediaPlayer *player = nullptr;
+        QVideoSink *sink = nullptr;
+        QTimer *timeout = nullptr;
+        qint64 targetUs = 0;
+        QImage lastFrame;
+    };
+
+    void startNext();
+    void finish(Job *job, const QImage &frame, bool report = true);
+
+    QStringList queue;
+    QList<Job *> running;
+};
+
+// Pulls representative frames out of videos in-process with QtMultimedia.
+// Requests are queued to a dedicated thread so extraction never blocks the
+// caller; without QtMultimedia every request fails with a null frame.
+class VideoFrameExtractor : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit VideoFrameExtractor(QObject *parent = nullptr);
+    ~VideoFrameExtractor();
+
+    void request(const QString &path);
+    // Forget queued requests and abort the ones in progress
+    void cancelPending();
+
+signals:
+    // frame is null when no frame could be extracted
+    void frameReady(const QString &path, const QImage &frame);
+
+private:
+    QThread thread;
+    VideoFrameWorker *worker;
+};
+
+#endif // VIDEOFRAMEEXTRACTOR_H